@@ -1,8 +1,14 @@
 #define CATCH_CONFIG_MAIN
 #include <algorithm>
 #include <catch2/catch.hpp>
+#include <chrono>
 #include <cstdio>  // std::remove
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
 // Filesystem fallback
@@ -14,6 +20,7 @@ namespace fs = ghc::filesystem;
 namespace fs = std::filesystem;
 #endif
 
+#include "zip_compress/cpu_dispatch.h"
 #include "zip_compress/zip_reader.h"
 #include "zip_compress/zip_writer.h"
 
@@ -42,6 +49,28 @@ static std::string zip_path(const fs::path &p)
   return s;
 }
 
+// 工具函数：CPU 具备且本构建有内核的特性的全部子集, 包括 0(标量)
+static std::vector<unsigned int> cpu_feature_subsets()
+{
+  const unsigned int usable = cpu_dispatch().detected & mz_supported_cpu_features();
+  std::vector<unsigned int> subsets;
+  for (unsigned int features = usable;; features = (features - 1) & usable)
+  {
+    subsets.push_back(features);
+    if (features == 0) break;
+  }
+  return subsets;
+}
+
+// 离开作用域时恢复 cpu_dispatch 绑定的内核, 断言失败时也不影响之后的测试
+struct CpuFeaturesGuard
+{
+  ~CpuFeaturesGuard()
+  {
+    mz_set_cpu_features(cpu_dispatch().enabled);
+  }
+};
+
 TEST_CASE("ZipWriter + ZipReader cross-platform tests")
 {
   const fs::path zip_path_file = "test.zip";
@@ -189,3 +218,1762 @@ TEST_CASE("ZipWriter + ZipReader cross-platform tests")
   std::remove((tmp_dir / "a.txt").string().c_str());
   std::remove((tmp_dir / "b.txt").string().c_str());
 }
+
+TEST_CASE("ZipReader extract_all creates each directory once")
+{
+  const fs::path zip_file = "dirs.zip";
+  const fs::path out_dir = "dirs_out";
+  fs::remove_all(out_dir);
+
+  {
+    ZipWriter writer(zip_file.string());
+    writer.add_data("top.txt", "T", 1);
+    writer.add_data("a/b/c/1.txt", "1", 1);
+    writer.add_data("a/b/c/2.txt", "2", 1);
+    writer.add_data("a/b/3.txt", "3", 1);
+    writer.add_data("a/x/4.txt", "4", 1);
+  }
+
+  ZipReader reader(zip_file.string());
+  reader.extract_all(out_dir.string());
+
+  REQUIRE(read_file(out_dir / "a" / "b" / "c" / "2.txt") == "2");
+  REQUIRE(read_file(out_dir / "a" / "x" / "4.txt") == "4");
+
+  const ExtractStats &stats = reader.last_extract_stats();
+  REQUIRE(stats.entries == 5);
+  REQUIRE(stats.files_extracted == 5);
+  REQUIRE(stats.directories == 4);          // a, a/b, a/b/c, a/x
+  REQUIRE(stats.directory_syscalls == 5);  // 输出目录 + 每个目录一次 mkdir
+
+  // 同一目录的第二次 extract_file 命中目录缓存
+  reader.extract_file("a/b/3.txt", (out_dir / "single" / "3.txt").string());
+  REQUIRE(reader.last_extract_stats().directory_syscalls == 1);
+  reader.extract_file("a/b/c/1.txt", (out_dir / "single" / "1.txt").string());
+  REQUIRE(reader.last_extract_stats().directory_syscalls == 0);
+  REQUIRE(read_file(out_dir / "single" / "1.txt") == "1");
+
+  // 目录被外部删除后仍能正确解压
+  fs::remove_all(out_dir / "single");
+  reader.extract_file("a/b/c/2.txt", (out_dir / "single" / "2.txt").string());
+  REQUIRE(read_file(out_dir / "single" / "2.txt") == "2");
+
+  // 输出目录整个被删除后再次 extract_all 会重新创建
+  fs::remove_all(out_dir);
+  reader.extract_all(out_dir.string());
+  REQUIRE(read_file(out_dir / "a" / "b" / "c" / "1.txt") == "1");
+
+  fs::remove_all(out_dir);
+  std::remove(zip_file.string().c_str());
+}
+
+TEST_CASE("ZipWriter append mode keeps existing entries")
+{
+  const fs::path zip_file = "append.zip";
+  std::remove(zip_file.string().c_str());
+
+  // 文件不存在时 append 等同于新建
+  {
+    ZipWriter writer(zip_file.string(), WriteMode::append);
+    writer.add_data("first.txt", "FIRST", 5);
+  }
+  const auto size_before = fs::file_size(zip_file);
+
+  {
+    ZipWriter writer(zip_file.string(), WriteMode::append);
+    writer.add_data("second.txt", "SECOND", 6);
+  }
+  REQUIRE(fs::file_size(zip_file) > size_before);
+
+  ZipReader reader(zip_file.string());
+  REQUIRE(reader.file_list().size() == 2);
+  auto first = reader.extract_file_to_memory("first.txt");
+  auto second = reader.extract_file_to_memory("second.txt");
+  REQUIRE(std::string(first.begin(), first.end()) == "FIRST");
+  REQUIRE(std::string(second.begin(), second.end()) == "SECOND");
+
+  std::remove(zip_file.string().c_str());
+}
+
+TEST_CASE("ZipWriter copies raw entries between archives")
+{
+  const fs::path src_zip = "merge_src.zip";
+  const fs::path dst_zip = "merge_dst.zip";
+  const std::string big(64 * 1024, 'z');
+
+  {
+    ZipWriter writer(src_zip.string());
+    writer.add_data("keep/a.txt", "AAA", 3);
+    writer.add_data("keep/big.bin", big.data(), big.size());
+    writer.add_data("skip/b.tmp", "BBB", 3);
+  }
+
+  {
+    ZipReader src(src_zip.string());
+    ZipWriter writer(dst_zip.string());
+    writer.add_data("own.txt", "OWN", 3);
+    writer.add_from_reader(src, "keep/a.txt", "renamed/a.txt");
+    writer.merge(src, [](std::string &name) {
+      if (name.compare(0, 5, "skip/") == 0) return false;
+      name = "merged/" + name;
+      return true;
+    });
+  }
+
+  ZipReader reader(dst_zip.string());
+  auto files = reader.file_list();
+  for (auto &f : files) std::replace(f.begin(), f.end(), '\\', '/');
+  REQUIRE(files.size() == 4);
+  REQUIRE(std::find(files.begin(), files.end(), "skip/b.tmp") == files.end());
+
+  auto renamed = reader.extract_file_to_memory("renamed/a.txt");
+  REQUIRE(std::string(renamed.begin(), renamed.end()) == "AAA");
+  auto merged = reader.extract_file_to_memory("merged/keep/big.bin");
+  REQUIRE(std::string(merged.begin(), merged.end()) == big);
+  REQUIRE(mz_zip_validate_file_archive(dst_zip.string().c_str(), 0, nullptr) != 0);
+
+  std::remove(src_zip.string().c_str());
+  std::remove(dst_zip.string().c_str());
+}
+
+TEST_CASE("ZipWriter deduplicates identical entries")
+{
+  const fs::path plain_zip = "dedup_plain.zip";
+  const fs::path dedup_zip = "dedup_on.zip";
+  const fs::path src_file = "dedup_src.bin";
+  std::string payload;
+  for (int i = 0; i < 20000; ++i) payload += std::to_string(i * 7919 % 10007);
+  {
+    std::ofstream ofs(src_file.string(), std::ios::binary);
+    ofs << payload;
+  }
+  // 文件比 a.txt 的添加时间早得多, 复用 a.txt 的条目时不能沿用它的修改时间
+  fs::last_write_time(src_file, fs::last_write_time(src_file) - std::chrono::hours(50));
+
+  auto build = [&](const fs::path &zip_file, bool dedup) {
+    ZipWriter writer(zip_file.string());
+    writer.set_deduplicate(dedup);
+    writer.add_data("a.txt", payload.data(), payload.size());
+    writer.add_data("b.txt", payload.data(), payload.size());
+    writer.add_data("other.txt", "OTHER", 5);
+    writer.add_file(src_file.string());
+    return writer.deduplicated_entries();
+  };
+  REQUIRE(build(plain_zip, false) == 0);
+  REQUIRE(build(dedup_zip, true) == 2);
+  REQUIRE(fs::file_size(dedup_zip) <= fs::file_size(plain_zip));
+  REQUIRE(mz_zip_validate_file_archive(dedup_zip.string().c_str(), 0, nullptr) != 0);
+
+  ZipReader reader(dedup_zip.string());
+  REQUIRE(reader.file_list().size() == 4);
+  for (const char *name : {"a.txt", "b.txt", "dedup_src.bin"})
+  {
+    auto data = reader.extract_file_to_memory(name);
+    REQUIRE(std::string(data.begin(), data.end()) == payload);
+  }
+
+  // 去重复制的 dedup_src.bin 与未去重时直接添加的一样, 中央目录与本地头都记录文件自己的修改时间
+  struct EntryMeta
+  {
+    time_t mtime;
+    mz_uint32 external_attr;
+    std::string local_time;  // 本地头中的 DOS 时间与日期
+  };
+  auto meta_of = [](const fs::path &zip_file, const char *name) {
+    mz_zip_archive zip = {};
+    REQUIRE(mz_zip_reader_init_file(&zip, zip_file.string().c_str(), 0));
+    mz_zip_archive_file_stat st;
+    REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, name, nullptr, 0), &st));
+    mz_zip_reader_end(&zip);
+    const std::string bytes = read_file(zip_file);
+    return EntryMeta{st.m_time, st.m_external_attr, bytes.substr(static_cast<size_t>(st.m_local_header_ofs) + 10, 4)};
+  };
+  const EntryMeta plain_src = meta_of(plain_zip, "dedup_src.bin");
+  const EntryMeta dedup_src = meta_of(dedup_zip, "dedup_src.bin");
+  REQUIRE(dedup_src.mtime == plain_src.mtime);
+  REQUIRE(dedup_src.local_time == plain_src.local_time);
+  REQUIRE(dedup_src.external_attr == plain_src.external_attr);
+  REQUIRE(dedup_src.mtime != meta_of(dedup_zip, "a.txt").mtime);
+
+  std::remove(plain_zip.string().c_str());
+  std::remove(dedup_zip.string().c_str());
+  std::remove(src_file.string().c_str());
+}
+
+TEST_CASE("ZipWriter rebuilds a folder incrementally")
+{
+  const fs::path folder = "rebuild_dir";
+  const fs::path old_zip = "rebuild_old.zip";
+  const fs::path new_zip = "rebuild_new.zip";
+  fs::remove_all(folder);
+  fs::create_directories(folder / "sub");
+  auto write = [&](const fs::path &rel, const std::string &content) {
+    std::ofstream ofs((folder / rel).string(), std::ios::binary);
+    ofs << content;
+  };
+  write("same.txt", "unchanged content");
+  write("touched.txt", "touched content");
+  write("sub/edit.txt", "v1");
+  write("gone.txt", "to be deleted");
+  {
+    ZipWriter writer(old_zip.string());
+    writer.add_folder(folder.string());
+  }
+
+  write("sub/edit.txt", "version 2");
+  write("new.txt", "brand new");
+  fs::remove(folder / "gone.txt");
+  const fs::path touched = folder / "touched.txt";
+  fs::last_write_time(touched, fs::last_write_time(touched) + std::chrono::hours(1));
+
+  RebuildManifest manifest;
+  {
+    ZipReader previous(old_zip.string());
+    ZipWriter writer(new_zip.string());
+    manifest = writer.add_folder_incremental(folder.string(), previous);
+  }
+  for (auto &name : manifest.changed) std::replace(name.begin(), name.end(), '\\', '/');
+  std::sort(manifest.changed.begin(), manifest.changed.end());
+
+  REQUIRE(manifest.unchanged == 2);
+  REQUIRE(manifest.changed == std::vector<std::string>{"new.txt", "sub/edit.txt"});
+  REQUIRE(manifest.removed == std::vector<std::string>{"gone.txt"});
+
+  ZipReader reader(new_zip.string());
+  REQUIRE(reader.file_list().size() == 4);
+  auto same = reader.extract_file_to_memory("same.txt");
+  REQUIRE(std::string(same.begin(), same.end()) == "unchanged content");
+  auto edit = reader.extract_file_to_memory((fs::path("sub") / "edit.txt").string());
+  REQUIRE(std::string(edit.begin(), edit.end()) == "version 2");
+
+  // 与 add_folder 相同的规则: 排除的目录/文件不写入(记为已删除), 级别规则作用于需要压缩的文件
+  fs::create_directories(folder / ".git");
+  write(".git/HEAD", "ref: refs/heads/main");
+  write("app.log", std::string(4096, 'L'));
+  const fs::path rules_zip = "rebuild_rules.zip";
+  {
+    ZipReader previous(new_zip.string());
+    ZipWriter writer(rules_zip.string());
+    manifest = writer.add_folder_incremental(folder.string(), previous,
+                                             EntryRules().exclude(".git").exclude("same.txt").level("*.log", 0));
+  }
+  REQUIRE(manifest.unchanged == 3);
+  REQUIRE(manifest.changed == std::vector<std::string>{"app.log"});
+  REQUIRE(manifest.removed == std::vector<std::string>{"same.txt"});
+  {
+    mz_zip_archive zip = {};
+    REQUIRE(mz_zip_reader_init_file(&zip, rules_zip.string().c_str(), 0));
+    REQUIRE(mz_zip_reader_get_num_files(&zip) == 4);
+    REQUIRE(mz_zip_reader_locate_file(&zip, ".git/HEAD", nullptr, 0) < 0);
+    mz_zip_archive_file_stat st;
+    REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, "app.log", nullptr, 0), &st));
+    REQUIRE(st.m_method == 0);
+    mz_zip_reader_end(&zip);
+  }
+
+  // 开启去重时, 与原样复制的旧条目内容相同的新文件复用其压缩数据(可复现模式保证 same.txt 先被复制)
+  write("z_dup.txt", "unchanged content");
+  {
+    ZipReader previous(new_zip.string());
+    ZipWriter writer(rules_zip.string());
+    writer.set_reproducible(true);
+    writer.set_deduplicate(true);
+    manifest = writer.add_folder_incremental(folder.string(), previous, EntryRules().exclude(".git"));
+    REQUIRE(writer.deduplicated_entries() == 1);
+  }
+  REQUIRE(manifest.unchanged == 4);
+  {
+    ZipReader dedup_reader(rules_zip.string());
+    auto dup = dedup_reader.extract_file_to_memory("z_dup.txt");
+    REQUIRE(std::string(dup.begin(), dup.end()) == "unchanged content");
+  }
+
+  fs::remove_all(folder);
+  std::remove(old_zip.string().c_str());
+  std::remove(new_zip.string().c_str());
+  std::remove(rules_zip.string().c_str());
+}
+
+TEST_CASE("tinfl fast loop matches the reference decoder")
+{
+  // 字面量、短距离游程与长距离匹配混合的数据
+  std::vector<uint8_t> src;
+  uint32_t seed = 1;
+  auto next = [&seed]() {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+  };
+  while (src.size() < 300000)
+  {
+    if (src.size() > 64 && next() % 2)
+    {
+      size_t dist = next() % (next() % 2 ? 8 : src.size() < 32768 ? src.size() : 32768) + 1;
+      size_t len = next() % 258 + 3;
+      for (size_t i = 0; i < len; ++i) src.push_back(src[src.size() - dist]);
+    }
+    else
+    {
+      src.push_back(static_cast<uint8_t>('a' + next() % 16));
+    }
+  }
+
+  // 以环形字典流式解压, dict_size 为 32KB 时匹配复制不能越界, 64KB 时可以
+  auto inflate_stream = [](const std::vector<uint8_t> &in, size_t dict_size, mz_uint32 flags, size_t chunk) {
+    std::vector<uint8_t> out, dict(dict_size);
+    tinfl_decompressor inflator;
+    tinfl_init(&inflator);
+    size_t in_ofs = 0, dict_ofs = 0;
+    tinfl_status status;
+    do
+    {
+      size_t in_size = std::min(chunk, in.size() - in_ofs), out_size = dict_size - dict_ofs;
+      mz_uint32 more = in_ofs + in_size < in.size() ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+      status = tinfl_decompress(&inflator, in.data() + in_ofs, &in_size, dict.data(), dict.data() + dict_ofs, &out_size,
+                                flags | more);
+      in_ofs += in_size;
+      out.insert(out.end(), dict.begin() + dict_ofs, dict.begin() + dict_ofs + out_size);
+      dict_ofs = (dict_ofs + out_size) & (dict_size - 1);
+    } while (status == TINFL_STATUS_HAS_MORE_OUTPUT || status == TINFL_STATUS_NEEDS_MORE_INPUT);
+    REQUIRE(status == TINFL_STATUS_DONE);
+    return out;
+  };
+
+  for (int level : {1, 6, 10})
+  {
+    for (bool fixed : {false, true})
+    {
+      int comp_flags = tdefl_create_comp_flags_from_zip_params(level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+      if (fixed) comp_flags |= TDEFL_FORCE_ALL_STATIC_BLOCKS;
+      size_t comp_len = 0;
+      void *comp = tdefl_compress_mem_to_heap(src.data(), src.size(), &comp_len, comp_flags);
+      REQUIRE(comp != nullptr);
+      std::vector<uint8_t> deflated(static_cast<uint8_t *>(comp), static_cast<uint8_t *>(comp) + comp_len);
+      mz_free(comp);
+
+      std::vector<uint8_t> fast(src.size()), ref(src.size());
+      REQUIRE(tinfl_decompress_mem_to_mem(fast.data(), fast.size(), deflated.data(), deflated.size(), 0) == src.size());
+      REQUIRE(tinfl_decompress_mem_to_mem(ref.data(), ref.size(), deflated.data(), deflated.size(),
+                                          TINFL_FLAG_DISABLE_FAST_LOOP) == src.size());
+      REQUIRE(fast == ref);
+      REQUIRE(fast == src);
+
+      for (size_t dict_size : {size_t(TINFL_LZ_DICT_SIZE), size_t(MZ_ZIP_READER_DICT_SIZE)})
+      {
+        for (size_t chunk : {size_t(777), deflated.size()})
+        {
+          REQUIRE(inflate_stream(deflated, dict_size, 0, chunk) == src);
+          REQUIRE(inflate_stream(deflated, dict_size, TINFL_FLAG_DISABLE_FAST_LOOP, chunk) == src);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("tdefl level 1 match finder round-trips")
+{
+  // 文本样式的重复数据 + 随机字节 + 长游程, 覆盖远距离匹配、短匹配与 258 字节上限
+  std::vector<uint8_t> src;
+  uint32_t seed = 7;
+  auto next = [&seed]() {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+  };
+  const char *words[] = {"zip", "compress", "entry", "archive", "deflate", "miniz", " ", "\n", "0x", "level"};
+  while (src.size() < 200000)
+  {
+    const char *w = words[next() % 10];
+    src.insert(src.end(), w, w + std::strlen(w));
+  }
+  for (int i = 0; i < 50000; ++i) src.push_back(static_cast<uint8_t>(next()));
+  src.insert(src.end(), 70000, 'z');
+
+  const int comp_flags = tdefl_create_comp_flags_from_zip_params(1, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+  auto deflate_stream = [&](size_t chunk, bool sync, uint8_t garbage) {
+    std::vector<uint8_t> out;
+    // 用不同的垃圾字节预填压缩器, 输出仍须一致(匹配查找不依赖未初始化的字典内容)
+    std::unique_ptr<tdefl_compressor> holder(new tdefl_compressor);
+    tdefl_compressor &comp = *holder;
+    std::memset(&comp, garbage, sizeof(comp));
+    REQUIRE(tdefl_init(&comp, nullptr, nullptr, comp_flags) == TDEFL_STATUS_OKAY);
+    size_t in_ofs = 0;
+    tdefl_status status;
+    do
+    {
+      uint8_t buf[4096];
+      size_t in_size = std::min(chunk, src.size() - in_ofs), out_size = sizeof(buf);
+      tdefl_flush flush = in_ofs + in_size == src.size() ? TDEFL_FINISH : sync ? TDEFL_SYNC_FLUSH : TDEFL_NO_FLUSH;
+      status = tdefl_compress(&comp, src.data() + in_ofs, &in_size, buf, &out_size, flush);
+      REQUIRE(status >= TDEFL_STATUS_OKAY);
+      in_ofs += in_size;
+      out.insert(out.end(), buf, buf + out_size);
+    } while (status != TDEFL_STATUS_DONE);
+    return out;
+  };
+
+  size_t comp_len = 0;
+  void *comp = tdefl_compress_mem_to_heap(src.data(), src.size(), &comp_len, comp_flags);
+  REQUIRE(comp != nullptr);
+  mz_free(comp);
+  REQUIRE(comp_len < src.size() / 3);
+
+  for (size_t chunk : {size_t(1), size_t(333), size_t(5000), src.size()})
+  {
+    for (bool sync : {false, true})
+    {
+      if (chunk == 1 && sync) continue;
+      std::vector<uint8_t> deflated = deflate_stream(chunk, sync, 0x00);
+      REQUIRE(deflate_stream(chunk, sync, 0xA5) == deflated);
+      std::vector<uint8_t> out(src.size());
+      REQUIRE(tinfl_decompress_mem_to_mem(out.data(), out.size(), deflated.data(), deflated.size(), 0) == src.size());
+      REQUIRE(out == src);
+    }
+  }
+}
+
+TEST_CASE("miniz SIMD kernels match the scalar results")
+{
+  // 0xFF 较多时 s2 最接近溢出, 覆盖 5552 字节分段边界
+  std::vector<uint8_t> data(70000);
+  uint32_t seed = 99;
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    seed = seed * 1103515245u + 12345u;
+    data[i] = (i % 3 == 0) ? 0xFF : static_cast<uint8_t>(seed >> 16);
+  }
+  auto reference_adler32 = [](uint32_t adler, const uint8_t *p, size_t len) {
+    uint32_t s1 = adler & 0xffff, s2 = adler >> 16;
+    for (size_t i = 0; i < len; ++i)
+    {
+      s1 = (s1 + p[i]) % 65521u;
+      s2 = (s2 + s1) % 65521u;
+    }
+    return (s2 << 16) | s1;
+  };
+
+  // 逐个特性子集绑定内核, 覆盖当前 CPU 上每一个可被选中的内核而不只是默认绑定的那个
+  CpuFeaturesGuard guard;
+  for (unsigned int features : cpu_feature_subsets())
+  {
+    mz_set_cpu_features(features);
+    INFO("features: " << features << ", adler32 kernel: " << mz_kernel_name(mz_adler32_kernel())
+                      << ", match kernel: " << mz_kernel_name(mz_match_len_kernel()));
+    REQUIRE(std::string(mz_kernel_name(mz_adler32_kernel())) != "unknown");
+    REQUIRE(std::string(mz_kernel_name(mz_match_len_kernel())) != "unknown");
+
+    for (size_t len : {0, 1, 15, 16, 17, 31, 32, 33, 100, 5551, 5552, 5553, 11104, 65536, 69000})
+    {
+      for (size_t offset : {0, 1, 7, 31})
+      {
+        for (uint32_t init : {1u, 0xFFF0FFF0u})
+        {
+          REQUIRE(mz_adler32(init, data.data() + offset, len) == reference_adler32(init, data.data() + offset, len));
+        }
+      }
+    }
+
+    std::vector<uint8_t> other(data.begin(), data.begin() + 400);
+    for (size_t max_len : {0, 3, 8, 15, 16, 31, 32, 33, 100, 258})
+    {
+      for (size_t diff = 0; diff <= 260; ++diff)
+      {
+        if (diff < other.size()) other[diff] ^= 0x40;
+        size_t expected = std::min(diff, max_len);
+        REQUIRE(mz_match_len(data.data(), other.data(), max_len) == expected);
+        if (diff < other.size()) other[diff] ^= 0x40;
+      }
+    }
+  }
+}
+
+TEST_CASE("cpu_dispatch binds kernels that agree with the scalar path")
+{
+  const zip_compress::CpuDispatch &dispatch = zip_compress::cpu_dispatch();
+  INFO("crc32: " << dispatch.crc32 << ", adler32: " << dispatch.adler32 << ", match: " << dispatch.match_len
+                 << ", inflate copy: " << dispatch.inflate_copy);
+  REQUIRE((dispatch.enabled & ~dispatch.detected) == 0);
+  REQUIRE((dispatch.enabled & ~mz_supported_cpu_features()) == 0);
+  REQUIRE(&zip_compress::cpu_dispatch() == &dispatch);
+  if (dispatch.force_scalar) REQUIRE(dispatch.enabled == 0);
+
+  // 长匹配(距离 >= 16)走解压复制内核, 随机段覆盖 CRC-32 的 64 字节折叠与尾部
+  std::vector<uint8_t> src;
+  uint32_t seed = 5;
+  for (int block = 0; block < 40; ++block)
+  {
+    for (int i = 0; i < 3000; ++i)
+    {
+      seed = seed * 1103515245u + 12345u;
+      src.push_back(static_cast<uint8_t>(seed >> 16));
+    }
+    std::vector<uint8_t> repeat(src.end() - 300 + block, src.end());
+    src.insert(src.end(), repeat.begin(), repeat.end());
+  }
+
+  struct Result
+  {
+    mz_ulong crc32;
+    mz_ulong adler32;
+    std::vector<uint8_t> deflated;
+    std::vector<uint8_t> inflated;
+  };
+  auto run = [&src]() {
+    Result r;
+    r.crc32 = mz_crc32(MZ_CRC32_INIT, src.data() + 3, src.size() - 3);
+    r.adler32 = mz_adler32(MZ_ADLER32_INIT, src.data() + 3, src.size() - 3);
+    mz_ulong bound = mz_compressBound(static_cast<mz_ulong>(src.size()));
+    r.deflated.resize(bound);
+    REQUIRE(mz_compress2(r.deflated.data(), &bound, src.data(), static_cast<mz_ulong>(src.size()), 6) == MZ_OK);
+    r.deflated.resize(bound);
+    mz_ulong out_len = static_cast<mz_ulong>(src.size());
+    r.inflated.resize(src.size());
+    REQUIRE(mz_uncompress(r.inflated.data(), &out_len, r.deflated.data(), bound) == MZ_OK);
+    REQUIRE(out_len == src.size());
+    return r;
+  };
+
+  CpuFeaturesGuard guard;
+  mz_set_cpu_features(0);
+  REQUIRE(mz_crc32_kernel() == MZ_KERNEL_SCALAR);
+  REQUIRE(mz_adler32_kernel() == MZ_KERNEL_SCALAR);
+  Result scalar = run();
+  REQUIRE(scalar.inflated == src);
+
+  // 默认绑定所用的特性集也是其中一个子集
+  for (unsigned int features : cpu_feature_subsets())
+  {
+    mz_set_cpu_features(features);
+    INFO("features: " << features << ", crc32: " << mz_kernel_name(mz_crc32_kernel())
+                      << ", adler32: " << mz_kernel_name(mz_adler32_kernel())
+                      << ", match: " << mz_kernel_name(mz_match_len_kernel())
+                      << ", inflate copy: " << mz_kernel_name(mz_inflate_copy_kernel()));
+    Result simd = run();
+    REQUIRE(simd.crc32 == scalar.crc32);
+    REQUIRE(simd.adler32 == scalar.adler32);
+    REQUIRE(simd.deflated == scalar.deflated);
+    REQUIRE(simd.inflated == src);
+  }
+}
+
+TEST_CASE("ZipWriter archive level writes smaller standard deflate entries")
+{
+  const fs::path uber_zip = "level_uber.zip";
+  const fs::path archive_zip = "level_archive.zip";
+  const fs::path src_file = "level_src.txt";
+
+  std::string text;
+  uint32_t seed = 3;
+  auto next = [&seed]() {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+  };
+  const char *words[] = {"archive", "level", "block", "split", "huffman", "cost", "parse", "tree", "match", "window"};
+  while (text.size() < 400000)
+  {
+    text += words[next() % 10];
+    text += next() % 7 == 0 ? "\n" : " ";
+    if (next() % 50 == 0) text += std::to_string(next());
+  }
+  std::string noise(20000, '\0');
+  for (auto &c : noise) c = static_cast<char>(next());
+  {
+    std::ofstream ofs(src_file.string(), std::ios::binary);
+    ofs << text;
+  }
+
+  auto build = [&](const fs::path &zip_file, int level) {
+    ZipWriter writer(zip_file.string());
+    writer.set_level(level);
+    REQUIRE(writer.level() == level);
+    writer.add_data("text.txt", text.data(), text.size());
+    writer.add_data("noise.bin", noise.data(), noise.size());
+    writer.add_data("empty.txt", "", 0);
+    writer.add_data("tiny.txt", "ab", 2);
+    writer.add_file(src_file.string());
+  };
+  build(uber_zip, MZ_UBER_COMPRESSION);
+  build(archive_zip, kArchiveLevel);
+  REQUIRE(fs::file_size(archive_zip) < fs::file_size(uber_zip));
+  REQUIRE(mz_zip_validate_file_archive(archive_zip.string().c_str(), 0, nullptr) != 0);
+
+  ZipReader reader(archive_zip.string());
+  auto as_string = [&reader](const char *name) {
+    auto data = reader.extract_file_to_memory(name);
+    return std::string(data.begin(), data.end());
+  };
+  REQUIRE(as_string("text.txt") == text);
+  REQUIRE(as_string("noise.bin") == noise);
+  REQUIRE(as_string("empty.txt").empty());
+  REQUIRE(as_string("tiny.txt") == "ab");
+  REQUIRE(as_string("level_src.txt") == text);
+
+  ZipWriter writer("level_invalid.zip");
+  REQUIRE_THROWS_AS(writer.set_level(-1), std::invalid_argument);
+  REQUIRE_THROWS_AS(writer.set_level(kArchiveLevel + 1), std::invalid_argument);
+  writer.finish();
+
+  std::remove(uber_zip.string().c_str());
+  std::remove(archive_zip.string().c_str());
+  std::remove(src_file.string().c_str());
+  std::remove("level_invalid.zip");
+}
+
+TEST_CASE("IoOptions buffer size and read-ahead keep archives intact")
+{
+  const fs::path src_dir = "io_src";
+  const fs::path zip_file = "io_options.zip";
+  const fs::path out_dir = "io_out";
+  fs::remove_all(src_dir);
+  fs::remove_all(out_dir);
+  fs::create_directories(src_dir / "sub");
+
+  // 条目均大于小缓冲区, 覆盖存储和 deflate 两种方式
+  std::string text;
+  while (text.size() < 300000) text += "io buffer read ahead " + std::to_string(text.size()) + "\n";
+  std::string noise(200000, '\0');
+  uint32_t seed = 11;
+  for (auto &c : noise)
+  {
+    seed = seed * 1103515245u + 12345u;
+    c = static_cast<char>(seed >> 16);
+  }
+  write_file(src_dir / "text.txt", text);
+  write_file(src_dir / "sub" / "noise.bin", noise);
+
+  IoOptions small_io;
+  small_io.buffer_size = 4096;
+  small_io.read_ahead = true;
+  {
+    ZipWriter writer(zip_file.string(), WriteMode::create, small_io);
+    writer.set_deduplicate(true);
+    writer.add_folder(src_dir.string());
+    writer.set_level(0);
+    writer.add_data("stored.txt", text.data(), text.size());
+  }
+  {
+    IoOptions large_io;
+    large_io.buffer_size = 1 << 20;
+    ZipWriter writer(zip_file.string(), WriteMode::append, large_io);
+    writer.add_data("appended.bin", noise.data(), noise.size());
+  }
+  REQUIRE(mz_zip_validate_file_archive(zip_file.string().c_str(), 0, nullptr) != 0);
+
+  for (size_t buffer_size : {size_t(0), size_t(4096), size_t(1) << 20})
+  {
+    IoOptions io;
+    io.buffer_size = buffer_size;
+    io.read_ahead = buffer_size != 0;
+    ZipReader reader(zip_file.string(), io);
+    REQUIRE(reader.file_list().size() == 4);
+
+    fs::remove_all(out_dir);
+    reader.extract_all(out_dir.string());
+    REQUIRE(read_file(out_dir / "text.txt") == text);
+    REQUIRE(read_file(out_dir / "sub" / "noise.bin") == noise);
+    REQUIRE(read_file(out_dir / "stored.txt") == text);
+    REQUIRE(read_file(out_dir / "appended.bin") == noise);
+
+    reader.extract_file("sub/noise.bin", (out_dir / "single.bin").string());
+    REQUIRE(read_file(out_dir / "single.bin") == noise);
+
+    auto data = reader.extract_file_to_memory("stored.txt");
+    REQUIRE(std::string(data.begin(), data.end()) == text);
+  }
+
+  fs::remove_all(src_dir);
+  fs::remove_all(out_dir);
+  std::remove(zip_file.string().c_str());
+}
+
+TEST_CASE("ZipReader lazy mode defers the name index until lookup")
+{
+  const fs::path zip_file = "lazy_open.zip";
+  const fs::path out_dir = "lazy_out";
+  fs::remove_all(out_dir);
+
+  // 写入顺序与名称顺序不一致, 排序结果错误时二分查找会找不到条目
+  const size_t count = 3000;
+  {
+    ZipWriter writer(zip_file.string());
+    writer.set_level(1);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const size_t k = (i * 7919) % count;
+      const std::string name = "d" + std::to_string(k % 13) + "/entry_" + std::to_string(k) + ".txt";
+      const std::string content = "content of " + std::to_string(k);
+      writer.add_data(name, content.data(), content.size());
+    }
+  }
+
+  ZipReader standard(zip_file.string());
+  ZipReader lazy(zip_file.string(), IoOptions(), ReadMode::lazy);
+  REQUIRE(lazy.file_list() == standard.file_list());
+
+  for (size_t k = 0; k < count; k += 97)
+  {
+    const std::string name = "d" + std::to_string(k % 13) + "/entry_" + std::to_string(k) + ".txt";
+    auto data = lazy.extract_file_to_memory(name);
+    REQUIRE(std::string(data.begin(), data.end()) == "content of " + std::to_string(k));
+  }
+  REQUIRE_THROWS_AS(lazy.extract_file_to_memory("d0/missing.txt"), std::runtime_error);
+
+  ZipReader lazy_all(zip_file.string(), IoOptions(), ReadMode::lazy);
+  lazy_all.extract_all(out_dir.string());
+  REQUIRE(lazy_all.last_extract_stats().files_extracted == count);
+  REQUIRE(read_file(out_dir / "d5" / "entry_5.txt") == "content of 5");
+
+  fs::remove_all(out_dir);
+  std::remove(zip_file.string().c_str());
+}
+
+TEST_CASE("ZipReader opens through a sidecar index")
+{
+  const fs::path zip_file = "sidecar.zip";
+  const fs::path index_file = "sidecar.zip.idx";
+  const fs::path copy_zip = "sidecar_copy.zip";
+  const fs::path out_dir = "sidecar_out";
+  fs::remove_all(out_dir);
+
+  std::string big;
+  while (big.size() < 200000) big += "sidecar index entry " + std::to_string(big.size()) + "\n";
+  {
+    ZipWriter writer(zip_file.string());
+    writer.add_data("docs/Readme.TXT", "hello", 5);
+    writer.add_data("docs/big.txt", big.data(), big.size());
+    writer.set_level(0);
+    writer.add_data("stored/raw.bin", big.data(), 1000);
+    writer.add_data("empty.txt", "", 0);
+  }
+
+  {
+    ZipReader reader(zip_file.string());
+    reader.write_index(index_file.string());
+  }
+  REQUIRE(ZipReader::verify_index(zip_file.string(), index_file.string()));
+
+  ZipReader plain(zip_file.string());
+  {
+    ZipReader indexed(zip_file.string(), index_file.string());
+    REQUIRE(indexed.using_index());
+    REQUIRE(indexed.file_list() == plain.file_list());
+
+    auto data = indexed.extract_file_to_memory("docs/readme.txt");  // 与 miniz 一致忽略大小写
+    REQUIRE(std::string(data.begin(), data.end()) == "hello");
+    data = indexed.extract_file_to_memory("docs/big.txt");
+    REQUIRE(std::string(data.begin(), data.end()) == big);
+    REQUIRE(indexed.extract_file_to_memory("empty.txt").empty());
+    REQUIRE_THROWS_AS(indexed.extract_file_to_memory("docs/missing.txt"), std::runtime_error);
+
+    indexed.extract_file("stored/raw.bin", (out_dir / "single" / "raw.bin").string());
+    REQUIRE(read_file(out_dir / "single" / "raw.bin") == big.substr(0, 1000));
+
+    indexed.extract_all((out_dir / "all").string());
+    REQUIRE(indexed.last_extract_stats().files_extracted == 4);
+    REQUIRE(read_file(out_dir / "all" / "docs" / "big.txt") == big);
+    REQUIRE(read_file(out_dir / "all" / "empty.txt").empty());
+
+    // 需要底层 archive 的操作在首次使用时解析中央目录
+    ZipWriter writer(copy_zip.string());
+    writer.add_from_reader(indexed, "docs/big.txt");
+  }
+  {
+    ZipReader copy(copy_zip.string());
+    auto data = copy.extract_file_to_memory("docs/big.txt");
+    REQUIRE(std::string(data.begin(), data.end()) == big);
+  }
+
+  // ZIP 被修改后索引过期, 退回正常打开
+  {
+    ZipWriter writer(zip_file.string(), WriteMode::append);
+    writer.add_data("docs/new.txt", "new", 3);
+  }
+  REQUIRE_FALSE(ZipReader::verify_index(zip_file.string(), index_file.string()));
+  {
+    ZipReader stale(zip_file.string(), index_file.string());
+    REQUIRE_FALSE(stale.using_index());
+    auto data = stale.extract_file_to_memory("docs/new.txt");
+    REQUIRE(std::string(data.begin(), data.end()) == "new");
+  }
+
+  // 损坏的索引同样被拒绝
+  write_file(index_file, "not an index");
+  {
+    ZipReader broken(zip_file.string(), index_file.string());
+    REQUIRE_FALSE(broken.using_index());
+    REQUIRE(broken.file_list().size() == 5);
+  }
+
+  fs::remove_all(out_dir);
+  std::remove(zip_file.string().c_str());
+  std::remove(index_file.string().c_str());
+  std::remove(copy_zip.string().c_str());
+}
+
+TEST_CASE("ZipReader cache returns shared buffers and evicts by bytes")
+{
+  const fs::path zip_file = "cache.zip";
+  std::vector<std::string> contents;
+  {
+    ZipWriter writer(zip_file.string());
+    for (int i = 0; i < 8; ++i)
+    {
+      contents.push_back(std::string(10000, static_cast<char>('a' + i)) + std::to_string(i));
+      writer.add_data("hot/" + std::to_string(i) + ".txt", contents[i].data(), contents[i].size());
+    }
+    const std::string huge(100000, 'z');
+    writer.add_data("huge.txt", huge.data(), huge.size());
+  }
+
+  ZipReader reader(zip_file.string());
+  REQUIRE(reader.cache_stats().hits == 0);
+
+  // 未开启缓存时每次都重新解压
+  auto first = reader.extract_file_shared("hot/0.txt");
+  REQUIRE(*first == std::vector<uint8_t>(contents[0].begin(), contents[0].end()));
+  REQUIRE(reader.extract_file_shared("hot/0.txt") != first);
+
+  // 单分片 25 KB: 最多容纳两个条目
+  reader.set_cache(25000, 1);
+  first = reader.extract_file_shared("hot/0.txt");
+  REQUIRE(reader.extract_file_shared("hot/0.txt") == first);
+  reader.extract_file_shared("hot/1.txt");
+  reader.extract_file_shared("hot/0.txt");  // 0 变为最近使用
+  reader.extract_file_shared("hot/2.txt");  // 淘汰 1
+  CacheStats stats = reader.cache_stats();
+  REQUIRE(stats.hits == 2);
+  REQUIRE(stats.misses == 3);
+  REQUIRE(stats.evictions == 1);
+  REQUIRE(stats.entries == 2);
+  REQUIRE(stats.bytes == contents[0].size() + contents[2].size());
+  REQUIRE(reader.extract_file_shared("hot/0.txt") == first);
+
+  // 超过分片容量的条目不缓存; extract_file_to_memory 从缓存复制
+  reader.extract_file_shared("huge.txt");
+  REQUIRE(reader.cache_stats().entries == 2);
+  auto copy = reader.extract_file_to_memory("hot/2.txt");
+  REQUIRE(std::string(copy.begin(), copy.end()) == contents[2]);
+  REQUIRE(reader.cache_stats().hits == 4);
+  REQUIRE_THROWS_AS(reader.extract_file_shared("missing.txt"), std::runtime_error);
+  REQUIRE_THROWS_AS(reader.set_cache(1000, 0), std::invalid_argument);
+
+  // 多线程并发读取热点条目
+  reader.set_cache(1 << 20, 4);
+  std::vector<std::thread> threads;
+  std::vector<int> mismatches(4, 0);
+  for (int t = 0; t < 4; ++t)
+  {
+    threads.emplace_back([&reader, &contents, &mismatches, t]() {
+      for (int i = 0; i < 200; ++i)
+      {
+        const int k = (i + t) % 8;
+        auto data = reader.extract_file_shared("hot/" + std::to_string(k) + ".txt");
+        if (std::string(data->begin(), data->end()) != contents[k]) ++mismatches[t];
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  for (int t = 0; t < 4; ++t) REQUIRE(mismatches[t] == 0);
+  stats = reader.cache_stats();
+  REQUIRE(stats.hits + stats.misses == 800);
+  REQUIRE(stats.entries == 8);
+
+  reader.set_cache(0);
+  REQUIRE(reader.cache_stats().entries == 0);
+  std::remove(zip_file.string().c_str());
+}
+
+TEST_CASE("ZipReader extracts into caller-provided buffers")
+{
+  const fs::path zip_file = "buffer.zip";
+  const fs::path index_file = "buffer.zip.idx";
+  std::string text;
+  while (text.size() < 150000) text += "caller buffer " + std::to_string(text.size()) + "\n";
+  {
+    ZipWriter writer(zip_file.string());
+    writer.add_data("deflated/text.txt", text.data(), text.size());
+    writer.set_level(0);
+    writer.add_data("stored/text.txt", text.data(), text.size());
+    writer.add_data("stored/empty.txt", "", 0);
+  }
+  {
+    ZipReader reader(zip_file.string());
+    reader.write_index(index_file.string());
+  }
+
+  const std::string names[] = {"deflated/text.txt", "stored/text.txt", "stored/empty.txt"};
+  std::vector<uint8_t> out(text.size());
+  std::vector<uint8_t> scratch(64 * 1024);
+  ZipReader plain(zip_file.string());
+  ZipReader indexed(zip_file.string(), index_file.string());
+  REQUIRE(indexed.using_index());
+  for (ZipReader *reader : {&plain, &indexed})
+  {
+    REQUIRE(reader->entry_size(names[0]) == text.size());
+    REQUIRE(reader->entry_size(names[2]) == 0);
+
+    for (const auto &name : names)
+    {
+      const size_t expected = name == names[2] ? 0 : text.size();
+      const size_t written = reader->extract_file_to_buffer(name, out.data(), out.size(), scratch.data(), scratch.size());
+      REQUIRE(written == expected);
+      REQUIRE(std::string(out.begin(), out.begin() + written) == text.substr(0, expected));
+    }
+
+    // 不提供 scratch 时内部临时分配, 结果相同
+    std::fill(out.begin(), out.end(), 0);
+    REQUIRE(reader->extract_file_to_buffer(names[0], out.data(), out.size()) == text.size());
+    REQUIRE(std::string(out.begin(), out.end()) == text);
+
+    REQUIRE_THROWS_AS(reader->extract_file_to_buffer(names[0], out.data(), text.size() - 1), std::invalid_argument);
+    REQUIRE_THROWS_AS(reader->extract_file_to_buffer("missing.txt", out.data(), out.size()), std::runtime_error);
+  }
+
+  // 缓存命中时直接复制
+  plain.set_cache(1 << 22);
+  plain.extract_file_shared(names[0]);
+  std::fill(out.begin(), out.end(), 0);
+  REQUIRE(plain.extract_file_to_buffer(names[0], out.data(), out.size()) == text.size());
+  REQUIRE(std::string(out.begin(), out.end()) == text);
+  REQUIRE(plain.cache_stats().hits == 1);
+
+  std::remove(zip_file.string().c_str());
+  std::remove(index_file.string().c_str());
+}
+
+TEST_CASE("ZipWriter add_folder scans directories in parallel")
+{
+  const fs::path src_dir = "scan_src";
+  fs::remove_all(src_dir);
+
+  std::vector<std::string> expected;
+  for (int a = 0; a < 6; ++a)
+  {
+    for (int b = 0; b < 5; ++b)
+    {
+      const fs::path dir = src_dir / ("a" + std::to_string(a)) / ("b" + std::to_string(b));
+      fs::create_directories(dir);
+      for (int f = 0; f < 4; ++f)
+      {
+        const std::string name = "a" + std::to_string(a) + "/b" + std::to_string(b) + "/f" + std::to_string(f) + ".txt";
+        write_file(src_dir / name, "file " + name);
+        expected.push_back(fs::path(name).make_preferred().string());
+      }
+    }
+  }
+  write_file(src_dir / "top.txt", "top");
+  expected.push_back("top.txt");
+  fs::create_directories(src_dir / "empty" / "nested");
+#ifndef _WIN32
+  // 指向文件的符号链接按普通文件打包, 指向目录的符号链接不进入
+  fs::create_symlink(fs::absolute(src_dir / "top.txt"), src_dir / "link.txt");
+  fs::create_directory_symlink(fs::absolute(src_dir / "a0"), src_dir / "link_dir");
+  expected.push_back("link.txt");
+#endif
+  std::sort(expected.begin(), expected.end());
+
+  for (size_t threads : {size_t(1), size_t(4), size_t(0)})
+  {
+    const std::string zip_name = "scan_" + std::to_string(threads) + ".zip";
+    IoOptions io;
+    io.scan_threads = threads;
+    {
+      ZipWriter writer(zip_name, WriteMode::create, io);
+      writer.add_folder(src_dir.string());
+    }
+
+    ZipReader reader(zip_name);
+    auto files = reader.file_list();
+    std::sort(files.begin(), files.end());
+    REQUIRE(files == expected);
+    auto data = reader.extract_file_to_memory("a3/b2/f1.txt");
+    REQUIRE(std::string(data.begin(), data.end()) == "file a3/b2/f1.txt");
+    std::remove(zip_name.c_str());
+  }
+
+  fs::remove_all(src_dir);
+}
+
+TEST_CASE("ZipWriter add_folder scans more files than the scanner queues at once")
+{
+  // 单个目录的文件数超过扫描队列上限(4096), 扫描线程要等打包取走文件后才能继续放入
+  const fs::path src_dir = "scan_bound_src";
+  const std::string zip_name = "scan_bound.zip";
+  fs::remove_all(src_dir);
+  fs::create_directories(src_dir / "sub");
+  const int flat_files = 6000;
+  for (int i = 0; i < flat_files; ++i) write_file(src_dir / ("f" + std::to_string(i) + ".txt"), std::to_string(i));
+  for (int i = 0; i < 100; ++i) write_file(src_dir / "sub" / ("g" + std::to_string(i) + ".txt"), "sub");
+
+  IoOptions io;
+  io.scan_threads = 4;
+  {
+    ZipWriter writer(zip_name, WriteMode::create, io);
+    writer.set_level(MZ_NO_COMPRESSION);
+    writer.add_folder(src_dir.string());
+  }
+
+  ZipReader reader(zip_name);
+  REQUIRE(reader.file_list().size() == static_cast<size_t>(flat_files + 100));
+  auto data = reader.extract_file_to_memory("f5999.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == "5999");
+
+  std::remove(zip_name.c_str());
+  fs::remove_all(src_dir);
+}
+
+TEST_CASE("ZipWriter reproducible mode writes byte-identical archives")
+{
+  const fs::path src_dir = "repro_src";
+  fs::remove_all(src_dir);
+  std::vector<std::string> expected;
+  for (int a = 0; a < 4; ++a)
+  {
+    fs::create_directories(src_dir / ("d" + std::to_string(a)));
+    for (int f = 0; f < 5; ++f)
+    {
+      const std::string name = "d" + std::to_string(a) + "/f" + std::to_string(f) + ".txt";
+      write_file(src_dir / name, std::string(100 * (f + 1), static_cast<char>('a' + a)));
+      expected.push_back(fs::path(name).make_preferred().string());
+    }
+  }
+  expected.push_back("meta.txt");
+  std::sort(expected.begin(), expected.end());
+
+  auto build = [&](const std::string &zip_name, size_t threads) {
+    IoOptions io;
+    io.scan_threads = threads;
+    ZipWriter writer(zip_name, WriteMode::create, io);
+    writer.set_reproducible(true);
+    REQUIRE(writer.reproducible());
+    writer.add_folder(src_dir.string());
+    writer.add_data("meta.txt", "build", 5);
+  };
+
+  build("repro_1.zip", 1);
+  {
+    ZipReader reader("repro_1.zip");
+    REQUIRE(reader.file_list() == expected);  // 条目按名称排序写入
+  }
+
+  // 修改所有文件的修改时间、切换时区并改用多线程扫描后重新打包, 结果应逐字节相同
+  for (const auto &entry : fs::recursive_directory_iterator(src_dir))
+  {
+    if (fs::is_regular_file(entry.path()))
+      fs::last_write_time(entry.path(), fs::last_write_time(entry.path()) - std::chrono::hours(50));
+  }
+#ifndef _WIN32
+  const char *tz = std::getenv("TZ");
+  const std::string saved_tz = tz != nullptr ? tz : "";
+  setenv("TZ", "XYZ-5:45", 1);
+  tzset();
+#endif
+  build("repro_2.zip", 4);
+#ifndef _WIN32
+  if (tz != nullptr)
+    setenv("TZ", saved_tz.c_str(), 1);
+  else
+    unsetenv("TZ");
+  tzset();
+#endif
+  REQUIRE(read_file("repro_1.zip") == read_file("repro_2.zip"));
+
+  // 增量重建: 旧条目的修改时间是固定值, 修改时间比较不再起作用, 每个文件都要读出比较 CRC-32.
+  // 因此大小不变、内容改变的文件也能发现, 结果与完整重新打包逐字节相同
+  write_file(src_dir / "d1" / "f2.txt", std::string(300, 'Z'));
+  {
+    ZipReader previous("repro_1.zip");
+    ZipWriter writer("repro_incremental.zip");
+    writer.set_reproducible(true);
+    const RebuildManifest manifest = writer.add_folder_incremental(src_dir.string(), previous);
+    REQUIRE(manifest.unchanged == 19);
+    REQUIRE(manifest.changed == std::vector<std::string>{"d1/f2.txt"});
+    REQUIRE(manifest.removed == std::vector<std::string>{"meta.txt"});
+    writer.add_data("meta.txt", "build", 5);
+  }
+  build("repro_full.zip", 3);
+  REQUIRE(read_file("repro_incremental.zip") == read_file("repro_full.zip"));
+  std::remove("repro_incremental.zip");
+  std::remove("repro_full.zip");
+
+#ifndef _WIN32
+  // SOURCE_DATE_EPOCH 改变固定时间, 非法值抛出异常
+  setenv("SOURCE_DATE_EPOCH", "1700000000", 1);
+  build("repro_3.zip", 2);
+  REQUIRE(read_file("repro_1.zip") != read_file("repro_3.zip"));
+  setenv("SOURCE_DATE_EPOCH", "yesterday", 1);
+  {
+    ZipWriter writer("repro_4.zip");
+    REQUIRE_THROWS_AS(writer.set_reproducible(true), std::invalid_argument);
+  }
+  unsetenv("SOURCE_DATE_EPOCH");
+  std::remove("repro_3.zip");
+  std::remove("repro_4.zip");
+#endif
+
+  std::remove("repro_1.zip");
+  std::remove("repro_2.zip");
+  fs::remove_all(src_dir);
+}
+
+TEST_CASE("ZipWriter add_folder applies include/exclude and level rules")
+{
+  // glob 语义
+  EntryRules globs;
+  globs.exclude("*.o").exclude("build/**/cache").exclude("[!a-c]?.bin").include("**/*.txt").include("docs/*.md");
+  REQUIRE_FALSE(globs.accepts_file("src/x.o"));
+  REQUIRE_FALSE(globs.accepts_directory("build/cache"));
+  REQUIRE_FALSE(globs.accepts_directory("build/a/b/cache"));
+  REQUIRE(globs.accepts_directory("src/build/cache"));
+  REQUIRE_FALSE(globs.accepts_file("d/x1.bin"));
+  REQUIRE(globs.accepts_file("a.txt"));
+  REQUIRE(globs.accepts_file("deep/dir/a.txt"));
+  REQUIRE(globs.accepts_file("docs/a.md"));
+  REQUIRE_FALSE(globs.accepts_file("docs/sub/a.md"));
+  REQUIRE_FALSE(globs.accepts_file("other/docs/a.md"));
+  REQUIRE_FALSE(globs.accepts_file("readme"));
+  REQUIRE_THROWS_AS(EntryRules().level("*.png", 99), std::invalid_argument);
+  REQUIRE_THROWS_AS(EntryRules().exclude_regex("(unclosed"), std::invalid_argument);
+
+  const fs::path src_dir = "rules_src";
+  fs::remove_all(src_dir);
+  fs::create_directories(src_dir / ".git" / "objects");
+  fs::create_directories(src_dir / "logs");
+  fs::create_directories(src_dir / "data");
+  const std::string text(60000, 'x');
+  write_file(src_dir / ".git" / "objects" / "pack", text);
+  write_file(src_dir / "image.png", text);
+  write_file(src_dir / "logs" / "app.log", text);
+  write_file(src_dir / "logs" / "scratch.tmp", text);
+  write_file(src_dir / "data" / "big.json", text);
+  write_file(src_dir / "data" / "small.json", "{\"small\": true, \"small\": true, \"small\": true}");
+
+  const std::string zip_name = "rules.zip";
+  {
+    EntryRules rules;
+    rules.exclude(".git").exclude_regex("\\.tmp$");
+    rules.level("*.png", 0).level("*.log", 1).level_by_size(50000, UINT64_MAX, 0);
+    ZipWriter writer(zip_name);
+    writer.add_folder(src_dir.string(), rules);
+  }
+
+  ZipReader reader(zip_name);
+  auto files = reader.file_list();
+  std::sort(files.begin(), files.end());
+  const std::vector<std::string> expected = {fs::path("data/big.json").make_preferred().string(),
+                                             fs::path("data/small.json").make_preferred().string(), "image.png",
+                                             fs::path("logs/app.log").make_preferred().string()};
+  REQUIRE(files == expected);
+
+  mz_zip_archive zip = {};
+  REQUIRE(mz_zip_reader_init_file(&zip, zip_name.c_str(), 0));
+  auto method_of = [&zip](const std::string &name) {
+    mz_zip_archive_file_stat st;
+    REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, name.c_str(), nullptr, 0), &st));
+    return st.m_method;
+  };
+  REQUIRE(method_of("image.png") == 0);                                                   // 按名称存储
+  REQUIRE(method_of(fs::path("logs/app.log").make_preferred().string()) == MZ_DEFLATED);  // *.log 先于大小规则
+  REQUIRE(method_of(fs::path("data/big.json").make_preferred().string()) == 0);           // 按大小存储
+  REQUIRE(method_of(fs::path("data/small.json").make_preferred().string()) == MZ_DEFLATED);
+  mz_zip_reader_end(&zip);
+
+  const auto image = reader.extract_file_to_memory("image.png");
+  REQUIRE(std::string(image.begin(), image.end()) == text);
+
+  std::remove(zip_name.c_str());
+  fs::remove_all(src_dir);
+}
+
+TEST_CASE("ZipReader extract_all extracts selected entries in parallel")
+{
+  const fs::path zip_file = "select.zip";
+  const fs::path index_file = "select.zip.idx";
+  {
+    ZipWriter writer(zip_file.string());
+    for (int i = 0; i < 40; ++i)
+    {
+      const std::string lib = "lib/mod" + std::to_string(i) + "/libmod" + std::to_string(i) + ".so";
+      writer.add_data(lib, lib.data(), lib.size());
+      const std::string doc = std::string(i * 100 + 1, static_cast<char>('a' + i % 26));
+      writer.add_data("doc/page" + std::to_string(i) + ".txt", doc.data(), doc.size());
+    }
+    writer.add_data(".git/HEAD", "ref", 3);
+  }
+
+  // 破坏一个不会被选中的条目的本地头, 选择性解压不应读到它
+  {
+    mz_zip_archive zip = {};
+    REQUIRE(mz_zip_reader_init_file(&zip, zip_file.string().c_str(), 0));
+    mz_zip_archive_file_stat st;
+    REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, "doc/page7.txt", nullptr, 0), &st));
+    mz_zip_reader_end(&zip);
+    std::fstream fs_zip(zip_file.string(), std::ios::in | std::ios::out | std::ios::binary);
+    fs_zip.seekp(static_cast<std::streamoff>(st.m_local_header_ofs));
+    fs_zip.write("\0\0\0\0", 4);
+  }
+
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    std::unique_ptr<ZipReader> reader;
+    if (pass == 0)
+    {
+      reader.reset(new ZipReader(zip_file.string()));
+      reader->write_index(index_file.string());
+    }
+    else
+    {
+      reader.reset(new ZipReader(zip_file.string(), index_file.string()));
+      REQUIRE(reader->using_index());
+    }
+
+    const fs::path out_dir = "select_out";
+    fs::remove_all(out_dir);
+    reader->extract_all(out_dir.string(), EntryRules().include("*.so"), 4);
+    REQUIRE(reader->last_extract_stats().files_extracted == 40);
+    REQUIRE(reader->last_extract_stats().entries_skipped == 41);
+    REQUIRE(read_file(out_dir / "lib" / "mod13" / "libmod13.so") == "lib/mod13/libmod13.so");
+    REQUIRE_FALSE(fs::exists(out_dir / "doc"));
+    REQUIRE_FALSE(fs::exists(out_dir / ".git"));
+
+    // 按中央目录元数据选择: 大于 2000 字节的 txt
+    fs::remove_all(out_dir);
+    reader->extract_all(
+        out_dir.string(),
+        [](const EntryInfo &info) { return info.name.compare(0, 4, "doc/") == 0 && info.uncomp_size > 2000; }, 3);
+    REQUIRE(reader->last_extract_stats().files_extracted == 20);
+    REQUIRE(read_file(out_dir / "doc" / "page39.txt") == std::string(3901, 'a' + 39 % 26));
+    REQUIRE_FALSE(fs::exists(out_dir / "lib"));
+
+    // 选中被破坏的条目时报错
+    REQUIRE_THROWS(reader->extract_all(out_dir.string(), EntryRules().include("doc/page7.txt"), 2));
+    fs::remove_all(out_dir);
+  }
+
+  std::remove(zip_file.string().c_str());
+  std::remove(index_file.string().c_str());
+}
+
+TEST_CASE("ZipReader extract_sync only rewrites changed files")
+{
+  const fs::path zip_file = "sync.zip";
+  const fs::path out_dir = "sync_out";
+  fs::remove_all(out_dir);
+  {
+    ZipWriter writer(zip_file.string());
+    writer.add_data("a.txt", "alpha", 5);
+    writer.add_data("d/b.txt", "bravo", 5);
+    writer.add_data("d/e/c.bin", "charlie", 7);
+  }
+
+  ZipReader reader(zip_file.string());
+  SyncOptions options;
+  options.threads = 2;
+  SyncManifest first = reader.extract_sync(out_dir.string(), options);
+  REQUIRE(first.unchanged == 0);
+  REQUIRE(first.updated.size() == 3);
+  REQUIRE(read_file(out_dir / "d" / "e" / "c.bin") == "charlie");
+
+  SyncManifest second = reader.extract_sync(out_dir.string(), options);
+  REQUIRE(second.unchanged == 3);
+  REQUIRE(second.updated.empty());
+  REQUIRE(reader.last_extract_stats().files_extracted == 0);
+
+  // 同样大小的新内容并恢复修改时间: 只比较大小与时间时发现不了, verify_crc 时重新解压
+  const auto b_time = fs::last_write_time(out_dir / "d" / "b.txt");
+  write_file(out_dir / "d" / "b.txt", "BRAVO");
+  fs::last_write_time(out_dir / "d" / "b.txt", b_time);
+  // 只改时间: verify_crc 时内容一致, 不重新解压
+  fs::last_write_time(out_dir / "a.txt", fs::last_write_time(out_dir / "a.txt") - std::chrono::hours(3));
+  fs::remove(out_dir / "d" / "e" / "c.bin");
+  write_file(out_dir / "d" / "extra.log", "stale");
+
+  SyncManifest quick = reader.extract_sync(out_dir.string(), options);
+  REQUIRE(quick.updated == std::vector<std::string>{"a.txt", "d/e/c.bin"});
+  REQUIRE(quick.extras == std::vector<std::string>{"d/extra.log"});
+  REQUIRE(read_file(out_dir / "d" / "b.txt") == "BRAVO");
+
+  fs::last_write_time(out_dir / "a.txt", fs::last_write_time(out_dir / "a.txt") - std::chrono::hours(3));
+  options.verify_crc = true;
+  options.delete_extras = true;
+  SyncManifest verified = reader.extract_sync(out_dir.string(), options);
+  REQUIRE(verified.updated == std::vector<std::string>{"d/b.txt"});
+  REQUIRE(verified.unchanged == 2);
+  REQUIRE(verified.extras == std::vector<std::string>{"d/extra.log"});
+  REQUIRE(read_file(out_dir / "d" / "b.txt") == "bravo");
+  REQUIRE_FALSE(fs::exists(out_dir / "d" / "extra.log"));
+
+  // verify_crc 已把 a.txt 的修改时间改回条目时间, 之后只比较时间即可
+  options.verify_crc = false;
+  REQUIRE(reader.extract_sync(out_dir.string(), options).unchanged == 3);
+
+  fs::remove_all(out_dir);
+  std::remove(zip_file.string().c_str());
+}
+
+TEST_CASE("ZipReader writes preallocated, sparse and direct output files")
+{
+  const fs::path zip_file = "output_modes.zip";
+  const fs::path index_file = "output_modes.zip.idx";
+
+  // 含长零段、非零段与不足一块的尾部, 以及以零结尾(末尾是空洞)的条目
+  std::string holes(300000, '\0');
+  for (size_t i = 100000; i < 150000; ++i) holes[i] = static_cast<char>('a' + i % 23);
+  holes.append("tail");
+  const std::string zero_tail = std::string(5000, 'z') + std::string(20000, '\0');
+  {
+    ZipWriter writer(zip_file.string());
+    writer.add_data("holes.bin", holes.data(), holes.size());
+    writer.add_data("zero_tail.bin", zero_tail.data(), zero_tail.size());
+    writer.add_data("empty.bin", "", 0);
+  }
+  {
+    ZipReader reader(zip_file.string());
+    reader.write_index(index_file.string());
+  }
+
+  for (int mode = 0; mode < 4; ++mode)
+  {
+    IoOptions io;
+    io.preallocate = mode != 1;
+    io.sparse = mode >= 2;
+    io.direct_io_threshold = mode == 3 ? 1 : 0;
+    io.buffer_size = mode == 3 ? 8192 : 0;  // 小缓冲, 覆盖多次写出
+
+    for (int use_index = 0; use_index < 2; ++use_index)
+    {
+      std::unique_ptr<ZipReader> reader(use_index != 0 ? new ZipReader(zip_file.string(), index_file.string(), io)
+                                                       : new ZipReader(zip_file.string(), io));
+      const fs::path out_dir = "output_modes_out";
+      fs::remove_all(out_dir);
+      reader->extract_all(out_dir.string());
+      REQUIRE(read_file(out_dir / "holes.bin") == holes);
+      REQUIRE(read_file(out_dir / "zero_tail.bin") == zero_tail);
+      REQUIRE(fs::file_size(out_dir / "zero_tail.bin") == zero_tail.size());
+      REQUIRE(fs::file_size(out_dir / "empty.bin") == 0);
+      fs::remove_all(out_dir);
+    }
+  }
+
+  std::remove(zip_file.string().c_str());
+  std::remove(index_file.string().c_str());
+}
+
+TEST_CASE("STORED entries are copied inside the kernel")
+{
+  const fs::path src_zip = "kernel_copy_src.zip";
+  const fs::path index_file = "kernel_copy_src.zip.idx";
+  const fs::path dst_zip = "kernel_copy_dst.zip";
+
+  // 大于一个读块的条目走内核拷贝, 小条目仍经过缓冲
+  std::string big(300000, '\0');
+  for (size_t i = 0; i < big.size(); ++i) big[i] = static_cast<char>('a' + (i * 7) % 26);
+  const std::string small = "small stored entry";
+  {
+    ZipWriter writer(src_zip.string());
+    writer.set_level(0);
+    writer.set_deduplicate(true);
+    writer.add_data("big.bin", big.data(), big.size());
+    writer.add_data("small.txt", small.data(), small.size());
+    writer.add_data("copy/big.bin", big.data(), big.size());  // 去重: 在同一个 ZIP 内复制
+    writer.add_data("deflated.txt", big.data(), big.size() / 2);
+    writer.set_level(6);
+    writer.add_data("compressed.bin", big.data(), big.size());
+  }
+  REQUIRE(mz_zip_validate_file_archive(src_zip.string().c_str(), 0, nullptr) != 0);
+  {
+    ZipReader reader(src_zip.string());
+    reader.write_index(index_file.string());
+  }
+
+  for (int mode = 0; mode < 3; ++mode)
+  {
+    IoOptions io;
+    io.kernel_copy = mode != 1;
+    io.sparse = mode == 2;  // 稀疏模式下经过缓冲
+
+    for (int use_index = 0; use_index < 2; ++use_index)
+    {
+      std::unique_ptr<ZipReader> reader(use_index != 0 ? new ZipReader(src_zip.string(), index_file.string(), io)
+                                                       : new ZipReader(src_zip.string(), io));
+      const fs::path out_dir = "kernel_copy_out";
+      fs::remove_all(out_dir);
+      reader->extract_all(out_dir.string());
+      REQUIRE(read_file(out_dir / "big.bin") == big);
+      REQUIRE(read_file(out_dir / "copy" / "big.bin") == big);
+      REQUIRE(read_file(out_dir / "small.txt") == small);
+      REQUIRE(read_file(out_dir / "deflated.txt") == big.substr(0, big.size() / 2));
+      REQUIRE(read_file(out_dir / "compressed.bin") == big);
+      fs::remove_all(out_dir);
+    }
+  }
+
+  // 归档间复制: 前后都有普通写入, 验证内核拷贝不打乱 stdio 的写入位置
+  {
+    ZipReader src(src_zip.string());
+    ZipWriter writer(dst_zip.string());
+    writer.add_data("before.txt", "BEFORE", 6);
+    writer.merge(src);
+    writer.add_data("after.txt", "AFTER", 5);
+  }
+  REQUIRE(mz_zip_validate_file_archive(dst_zip.string().c_str(), 0, nullptr) != 0);
+  ZipReader reader(dst_zip.string());
+  auto copied = reader.extract_file_to_memory("copy/big.bin");
+  REQUIRE(std::string(copied.begin(), copied.end()) == big);
+  auto after = reader.extract_file_to_memory("after.txt");
+  REQUIRE(std::string(after.begin(), after.end()) == "AFTER");
+
+  // 改动 STORED 条目的一个数据字节: 内核拷贝之后的 CRC-32 校验要让解压失败
+  {
+    mz_zip_archive zip = {};
+    REQUIRE(mz_zip_reader_init_file(&zip, src_zip.string().c_str(), 0));
+    mz_zip_archive_file_stat st;
+    REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, "big.bin", nullptr, 0), &st));
+    mz_zip_reader_end(&zip);
+    std::fstream fs_zip(src_zip.string(), std::ios::in | std::ios::out | std::ios::binary);
+    fs_zip.seekp(static_cast<std::streamoff>(st.m_local_header_ofs + 30 + std::strlen("big.bin") + 1000));
+    fs_zip.put('#');
+  }
+  {
+    ZipReader reader(src_zip.string());
+    reader.write_index(index_file.string());
+  }
+  for (int use_index = 0; use_index < 2; ++use_index)
+  {
+    std::unique_ptr<ZipReader> reader(use_index != 0 ? new ZipReader(src_zip.string(), index_file.string())
+                                                     : new ZipReader(src_zip.string()));
+    const fs::path out_dir = "kernel_copy_out";
+    REQUIRE_THROWS(reader->extract_file("big.bin", (out_dir / "big.bin").string()));
+    REQUIRE_THROWS(reader->extract_all(out_dir.string()));
+    reader->extract_file("copy/big.bin", (out_dir / "copy.bin").string());
+    REQUIRE(read_file(out_dir / "copy.bin") == big);
+    fs::remove_all(out_dir);
+  }
+
+  std::remove(src_zip.string().c_str());
+  std::remove(index_file.string().c_str());
+  std::remove(dst_zip.string().c_str());
+}
+
+TEST_CASE("ZipWriter add_precompressed writes raw deflate streams as is")
+{
+  const fs::path zip_file = "precompressed.zip";
+  std::string text;
+  for (int i = 0; i < 2000; ++i) text += "{\"id\":" + std::to_string(i) + ",\"status\":\"ok\"}\n";
+
+  // 上游生产者: 原始 deflate 流(窗口位数 -15, 不带 zlib 头) + CRC-32
+  size_t deflate_size = 0;
+  const int flags = tdefl_create_comp_flags_from_zip_params(MZ_BEST_COMPRESSION, -MZ_DEFAULT_WINDOW_BITS,
+                                                            MZ_DEFAULT_STRATEGY);
+  void *deflated = tdefl_compress_mem_to_heap(text.data(), text.size(), &deflate_size, flags);
+  REQUIRE(deflated != nullptr);
+  const mz_uint32 crc = static_cast<mz_uint32>(mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const mz_uint8 *>(text.data()),
+                                                        text.size()));
+  {
+    ZipWriter writer(zip_file.string());
+    writer.add_data("plain.txt", "plain", 5);
+    writer.add_precompressed("events.json", deflated, deflate_size, text.size(), crc);
+    REQUIRE_THROWS_AS(writer.add_precompressed("empty.json", deflated, 0, 0, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(writer.add_precompressed("dir/", deflated, deflate_size, text.size(), crc), std::runtime_error);
+  }
+  REQUIRE(mz_zip_validate_file_archive(zip_file.string().c_str(), 0, nullptr) != 0);
+
+  ZipReader reader(zip_file.string());
+  REQUIRE(reader.file_list().size() == 2);
+  auto events = reader.extract_file_to_memory("events.json");
+  REQUIRE(std::string(events.begin(), events.end()) == text);
+
+  // 压缩数据原样写入, 条目大小就是传入的 deflate 流大小
+  mz_zip_archive zip;
+  mz_zip_zero_struct(&zip);
+  REQUIRE(mz_zip_reader_init_file(&zip, zip_file.string().c_str(), 0) != 0);
+  mz_zip_archive_file_stat stat;
+  REQUIRE(mz_zip_reader_file_stat(&zip, 1, &stat) != 0);
+  REQUIRE(stat.m_comp_size == deflate_size);
+  REQUIRE(stat.m_uncomp_size == text.size());
+  REQUIRE(stat.m_crc32 == crc);
+  mz_zip_reader_end(&zip);
+
+  mz_free(deflated);
+  std::remove(zip_file.string().c_str());
+}
+
+TEST_CASE("ZipWriter add_data_batch compresses many small entries in parallel")
+{
+  const fs::path zip_file = "data_batch.zip";
+
+  // 大量相似的小 JSON, 另含空条目、极小条目、不可压缩条目与重复内容
+  std::vector<std::string> names;
+  std::vector<std::string> blobs;
+  for (int i = 0; i < 3000; ++i)
+  {
+    names.push_back("events/" + std::to_string(i) + ".json");
+    blobs.push_back("{\"id\":" + std::to_string(i) + ",\"status\":\"ok\",\"tags\":[\"a\",\"b\",\"c\"]}");
+  }
+  names.push_back("empty.json");
+  blobs.push_back("");
+  names.push_back("tiny.txt");
+  blobs.push_back("ab");
+  std::string noise(5000, '\0');
+  for (size_t i = 0; i < noise.size(); ++i) noise[i] = static_cast<char>((i * 2654435761u) >> 13);
+  names.push_back("noise.bin");
+  blobs.push_back(noise);
+  names.push_back("dup/0.json");
+  blobs.push_back(blobs[0]);
+
+  std::vector<DataEntry> records;
+  for (size_t i = 0; i < names.size(); ++i) records.push_back(DataEntry{names[i].c_str(), blobs[i].data(), blobs[i].size()});
+
+  const int levels[] = {MZ_DEFAULT_LEVEL, MZ_NO_COMPRESSION, kArchiveLevel};
+  for (int level : levels)
+  {
+    {
+      ZipWriter writer(zip_file.string());
+      writer.set_level(level);
+      writer.set_deduplicate(true);
+      writer.add_data("first.txt", "FIRST", 5);
+      writer.add_data_batch(records, 4);
+
+      // 空指针记录整批拒绝, 不写入任何条目
+      std::vector<DataEntry> bad = {DataEntry{"ok.txt", "x", 1}, DataEntry{nullptr, "y", 1}};
+      REQUIRE_THROWS_AS(writer.add_data_batch(bad), std::invalid_argument);
+
+      // 单线程, 内容全部与已写入的条目重复
+      std::vector<std::string> again_names;
+      for (int i = 0; i < 5; ++i) again_names.push_back("again/" + std::to_string(i) + ".json");
+      std::vector<DataEntry> again;
+      for (int i = 0; i < 5; ++i) again.push_back(DataEntry{again_names[i].c_str(), blobs[i].data(), blobs[i].size()});
+      writer.add_data_batch(again, 1);
+      writer.add_data("last.txt", "LAST", 4);
+      REQUIRE(writer.deduplicated_entries() == 6);
+    }
+    REQUIRE(mz_zip_validate_file_archive(zip_file.string().c_str(), 0, nullptr) != 0);
+
+    ZipReader reader(zip_file.string());
+    REQUIRE(reader.file_list().size() == 2 + records.size() + 5);
+    for (size_t i = 0; i < names.size(); i += 97)
+    {
+      auto data = reader.extract_file_to_memory(names[i]);
+      REQUIRE(std::string(data.begin(), data.end()) == blobs[i]);
+    }
+    for (const char *name : {"empty.json", "tiny.txt", "noise.bin", "dup/0.json"})
+    {
+      const size_t i = std::find(names.begin(), names.end(), name) - names.begin();
+      auto data = reader.extract_file_to_memory(name);
+      REQUIRE(std::string(data.begin(), data.end()) == blobs[i]);
+    }
+    auto again = reader.extract_file_to_memory("again/4.json");
+    REQUIRE(std::string(again.begin(), again.end()) == blobs[4]);
+    auto last = reader.extract_file_to_memory("last.txt");
+    REQUIRE(std::string(last.begin(), last.end()) == "LAST");
+  }
+
+  std::remove(zip_file.string().c_str());
+}
+
+TEST_CASE("ZipWriter preset dictionary shrinks many similar small entries")
+{
+  const fs::path plain_zip = "dict_plain.zip";
+  const fs::path dict_zip = "dict_primed.zip";
+  const fs::path merged_zip = "dict_merged.zip";
+  const fs::path index_file = "dict_primed.zipidx";
+  const fs::path out_dir = "dict_out";
+  fs::remove_all(out_dir);
+
+  // 字段相同、取值不同的小 JSON 记录
+  std::vector<std::string> names;
+  std::vector<std::string> blobs;
+  for (int i = 0; i < 600; ++i)
+  {
+    names.push_back("records/" + std::to_string(i) + ".json");
+    blobs.push_back("{\"id\":" + std::to_string(i * 7919) + ",\"user\":{\"name\":\"user" + std::to_string(i % 37) +
+                    "\",\"email\":\"user" + std::to_string(i % 37) +
+                    "@example.com\",\"roles\":[\"reader\",\"writer\"]},\"status\":\"" +
+                    (i % 3 == 0 ? "active" : "suspended") + "\",\"created_at\":\"2025-12-" +
+                    std::to_string(10 + i % 18) + "T08:00:00Z\",\"settings\":{\"theme\":\"dark\"," +
+                    "\"language\":\"zh-CN\",\"notifications\":{\"email\":true,\"sms\":false,\"push\":true}}," +
+                    "\"score\":" + std::to_string(i * 31 % 1000) + "}");
+  }
+  std::string big;
+  for (int i = 0; big.size() <= kDictionaryEntryLimit; ++i) big += blobs[i % blobs.size()];
+
+  const std::vector<std::string> samples(blobs.begin(), blobs.begin() + 100);
+  const std::vector<uint8_t> dict = ZipWriter::train_dictionary(samples, 4 * 1024);
+  REQUIRE(!dict.empty());
+  REQUIRE(dict.size() <= 4 * 1024);
+  REQUIRE_THROWS_AS(ZipWriter::train_dictionary(samples, 0), std::invalid_argument);
+  REQUIRE(ZipWriter::train_dictionary(std::vector<std::string>{"only one sample"}).empty());
+
+  const int levels[] = {MZ_BEST_SPEED, MZ_DEFAULT_LEVEL, kArchiveLevel};
+  for (int level : levels)
+  {
+    {
+      ZipWriter writer(plain_zip.string());
+      writer.set_level(level);
+      for (size_t i = 0; i < names.size(); ++i) writer.add_data(names[i], blobs[i].data(), blobs[i].size());
+    }
+    {
+      ZipWriter writer(dict_zip.string());
+      writer.set_level(level);
+      writer.set_dictionary(dict);
+      REQUIRE_THROWS_AS(writer.set_dictionary(dict), std::runtime_error);
+      REQUIRE_THROWS_AS(writer.set_dictionary(nullptr, 0), std::invalid_argument);
+
+      // 前一半逐条添加, 后一半批量并行压缩
+      const size_t half = names.size() / 2;
+      for (size_t i = 0; i < half; ++i) writer.add_data(names[i], blobs[i].data(), blobs[i].size());
+      std::vector<DataEntry> records;
+      for (size_t i = half; i < names.size(); ++i)
+        records.push_back(DataEntry{names[i].c_str(), blobs[i].data(), blobs[i].size()});
+      writer.add_data_batch(records, 3);
+      writer.add_data("big.json", big.data(), big.size());
+    }
+    REQUIRE(fs::file_size(dict_zip) < fs::file_size(plain_zip) - big.size() / 4);
+    REQUIRE(mz_zip_validate_file_archive(dict_zip.string().c_str(), 0, nullptr) != 0);
+
+    {
+      // 小条目使用私有方法号, 超过上限的条目保持标准 deflate
+      mz_zip_archive zip = {};
+      REQUIRE(mz_zip_reader_init_file(&zip, dict_zip.string().c_str(), 0));
+      mz_zip_archive_file_stat st;
+      REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, "records/1.json", nullptr, 0), &st));
+      REQUIRE(st.m_method == MZ_DEFLATED_PRESET_DICT);
+      REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, "records/599.json", nullptr, 0), &st));
+      REQUIRE(st.m_method == MZ_DEFLATED_PRESET_DICT);
+      REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, "big.json", nullptr, 0), &st));
+      REQUIRE(st.m_method == MZ_DEFLATED);
+      mz_zip_reader_end(&zip);
+
+      // 字典条目不出现在文件列表中, 也不会被解压
+      ZipReader reader(dict_zip.string());
+      REQUIRE(reader.file_list().size() == names.size() + 1);
+      for (size_t i = 0; i < names.size(); i += 7)
+      {
+        auto data = reader.extract_file_to_memory(names[i]);
+        REQUIRE(std::string(data.begin(), data.end()) == blobs[i]);
+      }
+      reader.extract_all(out_dir.string(), EntryRules(), 2);
+      REQUIRE(read_file(out_dir / "records" / "599.json") == blobs[599]);
+      REQUIRE(read_file(out_dir / "big.json") == big);
+      REQUIRE_FALSE(fs::exists(out_dir / MZ_ZIP_PRESET_DICT_NAME));
+      reader.write_index(index_file.string());
+    }
+    {
+      // 边车索引把私有方法的条目交给 miniz 解压
+      ZipReader indexed(dict_zip.string(), index_file.string());
+      REQUIRE(indexed.using_index());
+      auto data = indexed.extract_file_to_memory(names[42]);
+      REQUIRE(std::string(data.begin(), data.end()) == blobs[42]);
+    }
+  }
+
+  {
+    // 合并时字典条目随其他条目一起复制, 之后不能再设置另一个字典
+    ZipReader source(dict_zip.string());
+    ZipWriter writer(merged_zip.string());
+    writer.merge(source);
+    REQUIRE_THROWS_AS(writer.set_dictionary(dict), std::runtime_error);
+  }
+  {
+    ZipReader merged(merged_zip.string());
+    auto data = merged.extract_file_to_memory(names[300]);
+    REQUIRE(std::string(data.begin(), data.end()) == blobs[300]);
+  }
+
+  fs::remove_all(out_dir);
+  std::remove(plain_zip.string().c_str());
+  std::remove(dict_zip.string().c_str());
+  std::remove(merged_zip.string().c_str());
+  std::remove(index_file.string().c_str());
+}
+
+TEST_CASE("ZipWriter copies preset dictionary entries only with the same dictionary")
+{
+  const fs::path src_zip = "dict_copy_src.zip";
+  const fs::path dst_zip = "dict_copy_dst.zip";
+
+  std::vector<std::string> names;
+  std::vector<std::string> blobs;
+  for (int i = 0; i < 50; ++i)
+  {
+    names.push_back("r" + std::to_string(i) + ".json");
+    blobs.push_back("{\"id\":" + std::to_string(i) + ",\"kind\":\"record\",\"tags\":[\"alpha\",\"beta\"]," +
+                    "\"owner\":\"u" + std::to_string(i % 5) + "\"}");
+  }
+  const std::vector<uint8_t> dict = ZipWriter::train_dictionary(blobs, 1024);
+  std::vector<uint8_t> other_dict(dict.rbegin(), dict.rend());
+  REQUIRE(!dict.empty());
+  {
+    ZipWriter writer(src_zip.string());
+    writer.set_dictionary(dict);
+    for (size_t i = 0; i < names.size(); ++i) writer.add_data(names[i], blobs[i].data(), blobs[i].size());
+  }
+
+  auto method_of = [&](const std::string &name) {
+    mz_zip_archive zip = {};
+    REQUIRE(mz_zip_reader_init_file(&zip, dst_zip.string().c_str(), 0));
+    mz_zip_archive_file_stat st;
+    REQUIRE(mz_zip_reader_file_stat(&zip, mz_zip_reader_locate_file(&zip, name.c_str(), nullptr, 0), &st));
+    mz_zip_reader_end(&zip);
+    return st.m_method;
+  };
+  auto check = [&](const std::string &name, const std::string &expected) {
+    ZipReader reader(dst_zip.string());
+    auto data = reader.extract_file_to_memory(name);
+    REQUIRE(std::string(data.begin(), data.end()) == expected);
+  };
+
+  ZipReader source(src_zip.string());
+  {
+    // 目标没有字典: 单条复制时重新压缩为标准 deflate
+    ZipWriter writer(dst_zip.string());
+    writer.add_from_reader(source, names[3]);
+    writer.add_from_reader(source, names[4], "renamed.json");
+  }
+  REQUIRE(method_of(names[3]) == MZ_DEFLATED);
+  check(names[3], blobs[3]);
+  check("renamed.json", blobs[4]);
+
+  {
+    // 合并时过滤掉字典条目, 依赖它的条目同样重新压缩
+    ZipWriter writer(dst_zip.string());
+    writer.merge(source, [](std::string &name) { return name != MZ_ZIP_PRESET_DICT_NAME; });
+  }
+  REQUIRE(method_of(names[7]) == MZ_DEFLATED);
+  check(names[7], blobs[7]);
+  REQUIRE(ZipReader(dst_zip.string()).file_list().size() == names.size());
+
+  {
+    // 目标使用不同的字典: 按目标的字典重新压缩; 再复制来源的字典条目是错误
+    ZipWriter writer(dst_zip.string());
+    writer.set_dictionary(other_dict);
+    writer.add_from_reader(source, names[9]);
+    REQUIRE_THROWS_AS(writer.add_from_reader(source, MZ_ZIP_PRESET_DICT_NAME), std::runtime_error);
+    REQUIRE_THROWS_AS(writer.merge(source), std::runtime_error);
+  }
+  REQUIRE(method_of(names[9]) == MZ_DEFLATED_PRESET_DICT);
+  check(names[9], blobs[9]);
+
+  {
+    // 目标使用相同的字典: 原样复制, 重复的字典条目被跳过
+    ZipWriter writer(dst_zip.string());
+    writer.set_dictionary(dict);
+    writer.merge(source);
+    writer.add_from_reader(source, names[0], "again.json");
+  }
+  REQUIRE(method_of(names[11]) == MZ_DEFLATED_PRESET_DICT);
+  check(names[11], blobs[11]);
+  check("again.json", blobs[0]);
+  REQUIRE(ZipReader(dst_zip.string()).file_list().size() == names.size() + 1);
+  REQUIRE(mz_zip_validate_file_archive(dst_zip.string().c_str(), 0, nullptr) != 0);
+
+  {
+    // 合并来源的字典条目后, 之后复制的条目可以原样保留
+    ZipWriter writer(dst_zip.string());
+    writer.add_from_reader(source, MZ_ZIP_PRESET_DICT_NAME);
+    writer.add_from_reader(source, names[20]);
+  }
+  REQUIRE(method_of(names[20]) == MZ_DEFLATED_PRESET_DICT);
+  check(names[20], blobs[20]);
+
+  std::remove(src_zip.string().c_str());
+  std::remove(dst_zip.string().c_str());
+}
@@ -246,6 +246,49 @@ extern "C"
     /* mz_crc32() returns the initial CRC-32 value to use when called with ptr==NULL. */
     MINIZ_EXPORT mz_ulong mz_crc32(mz_ulong crc, const unsigned char *ptr, size_t buf_len);
 
+    /* mz_crc32(), mz_adler32(), the deflate match finder and the inflate match copy run SIMD kernels. mz_set_cpu_features() binds them */
+    /* to the best ones a set of MZ_CPU_* features allows; until it's called, the first use binds the kernels the compiler targets */
+    /* unconditionally (SSE2 on x64, NEON on AArch64). Define MINIZ_NO_SIMD to build the scalar kernels only. */
+    enum
+    {
+        MZ_KERNEL_SCALAR = 0,
+        MZ_KERNEL_SSE2 = 1,
+        MZ_KERNEL_AVX2 = 2,
+        MZ_KERNEL_NEON = 3,
+        MZ_KERNEL_PCLMUL = 4,
+        MZ_KERNEL_ARM_CRC32 = 5,
+        MZ_KERNEL_EXTERNAL = 6 /* mz_crc32() comes from outside (USE_EXTERNAL_MZCRC) */
+    };
+
+    enum
+    {
+        MZ_CPU_SSE2 = 1,
+        MZ_CPU_AVX2 = 2,
+        MZ_CPU_PCLMUL = 4,
+        MZ_CPU_NEON = 8,
+        MZ_CPU_ARM_CRC32 = 16
+    };
+
+    /* mz_supported_cpu_features() returns the MZ_CPU_* features this build has kernels for. */
+    MINIZ_EXPORT unsigned int mz_supported_cpu_features(void);
+
+    /* mz_set_cpu_features() binds every kernel to the fastest one the given MZ_CPU_* features allow (0 selects the scalar kernels). */
+    /* The caller is responsible for detecting the features: a kernel the CPU can't run faults with an illegal instruction. */
+    /* Call it before other threads start using miniz. */
+    MINIZ_EXPORT void mz_set_cpu_features(unsigned int features);
+
+    /* Return the MZ_KERNEL_* value bound to mz_crc32(), mz_adler32(), mz_match_len() and the inflate match copy. */
+    MINIZ_EXPORT int mz_crc32_kernel(void);
+    MINIZ_EXPORT int mz_adler32_kernel(void);
+    MINIZ_EXPORT int mz_match_len_kernel(void);
+    MINIZ_EXPORT int mz_inflate_copy_kernel(void);
+
+    /* mz_kernel_name() returns "scalar", "sse2", "avx2", "neon", "pclmul", "arm-crc32", "external", or "unknown". */
+    MINIZ_EXPORT const char *mz_kernel_name(int kernel);
+
+    /* mz_match_len() returns the length of the common prefix of pA and pB, reading at most max_len bytes from each. */
+    MINIZ_EXPORT size_t mz_match_len(const unsigned char *pA, const unsigned char *pB, size_t max_len);
+
     /* Compression strategies. */
     enum
     {
@@ -259,6 +302,12 @@ extern "C"
 /* Method */
 #define MZ_DEFLATED 8
 
+/* Private ZIP method: raw deflate primed with the archive's preset dictionary (the stored entry MZ_ZIP_PRESET_DICT_NAME). */
+/* Readers that don't know the convention report these entries as unsupported instead of producing garbage. */
+#define MZ_DEFLATED_PRESET_DICT 0x5A44
+#define MZ_ZIP_PRESET_DICT_NAME ".zip_compress.dict"
+#define MZ_ZIP_PRESET_DICT_MAX_SIZE 32768
+
     /* Heap allocation callbacks.
     Note that mz_alloc_func parameter types purposely differ from zlib's: items/size is size_t, not unsigned long. */
     typedef void *(*mz_alloc_func)(void *opaque, size_t items, size_t size);
@@ -351,7 +400,7 @@ extern "C"
     /*  pStream must point to an initialized mz_stream struct. */
     /*  level must be between [MZ_NO_COMPRESSION, MZ_BEST_COMPRESSION]. */
     /*  level 1 enables a specially optimized compression function that's been optimized purely for performance, not ratio. */
-    /*  (This special func. is currently only enabled when MINIZ_USE_UNALIGNED_LOADS_AND_STORES and MINIZ_LITTLE_ENDIAN are defined.) */
+    /*  (This special func. is currently only enabled when TDEFL_USE_FAST_MATCHER is set, see below.) */
     /* Return values: */
     /*  MZ_OK on success. */
     /*  MZ_STREAM_ERROR if the stream is bogus. */
@@ -817,6 +866,16 @@ enum
     TDEFL_LZ_HASH_SHIFT = (TDEFL_LZ_HASH_BITS + 2) / 3,
     TDEFL_LZ_HASH_SIZE = 1 << TDEFL_LZ_HASH_BITS
 };
+#endif
+
+/* TDEFL_USE_FAST_MATCHER: Set to 1 to compress level 1 (1 probe, greedy parsing) with a multiplicative hash of 4 byte loads into 2-entry */
+/* buckets and 8 bytes at a time match extension, instead of the generic 3 byte hash chain parser. Requires a little endian CPU with 64-bit registers. */
+#ifndef TDEFL_USE_FAST_MATCHER
+#if MINIZ_LITTLE_ENDIAN && MINIZ_HAS_64BIT_REGISTERS
+#define TDEFL_USE_FAST_MATCHER 1
+#else
+#define TDEFL_USE_FAST_MATCHER 0
+#endif
 #endif
 
     /* The low-level tdefl functions below may be used directly if the above helper functions aren't flexible enough. The low-level functions don't make any heap allocations, unlike the above helper functions. */
@@ -872,6 +931,11 @@ enum
     /* flags: See the above enums (TDEFL_HUFFMAN_ONLY, TDEFL_WRITE_ZLIB_HEADER, etc.) */
     MINIZ_EXPORT tdefl_status tdefl_init(tdefl_compressor *d, tdefl_put_buf_func_ptr pPut_buf_func, void *pPut_buf_user, int flags);
 
+    /* Primes the compressor's window with a preset dictionary (only the last TDEFL_LZ_DICT_SIZE bytes are used), so the first bytes of the stream can match it. */
+    /* Must be called right after tdefl_init(). The dictionary is not part of the output and the zlib FDICT bit is not written: */
+    /* the decompressor must be handed the same bytes as already decoded output (e.g. tinfl with a non-wrapping buffer that starts with them). */
+    MINIZ_EXPORT tdefl_status tdefl_set_dictionary(tdefl_compressor *d, const void *pDict, size_t dict_size);
+
     /* Compresses a block of data, consuming as much of the specified input buffer as possible, and writing as much compressed data to the specified output buffer as possible. */
     MINIZ_EXPORT tdefl_status tdefl_compress(tdefl_compressor *d, const void *pIn_buf, size_t *pIn_buf_size, void *pOut_buf, size_t *pOut_buf_size, tdefl_flush flush);
 
@@ -916,12 +980,14 @@ extern "C"
     /* TINFL_FLAG_HAS_MORE_INPUT: If set, there are more input bytes available beyond the end of the supplied input buffer. If clear, the input buffer contains all remaining input. */
     /* TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF: If set, the output buffer is large enough to hold the entire decompressed stream. If clear, the output buffer is at least the size of the dictionary (typically 32KB). */
     /* TINFL_FLAG_COMPUTE_ADLER32: Force adler-32 checksum computation of the decompressed bytes. */
+    /* TINFL_FLAG_DISABLE_FAST_LOOP: Decode every symbol with the reference loop even if TINFL_USE_FAST_LOOP is enabled (used to verify the fast loop against it). */
     enum
     {
         TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
         TINFL_FLAG_HAS_MORE_INPUT = 2,
         TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
-        TINFL_FLAG_COMPUTE_ADLER32 = 8
+        TINFL_FLAG_COMPUTE_ADLER32 = 8,
+        TINFL_FLAG_DISABLE_FAST_LOOP = 16
     };
 
     /* High level decompression functions: */
@@ -1014,7 +1080,9 @@ extern "C"
         TINFL_MAX_HUFF_SYMBOLS_1 = 32,
         TINFL_MAX_HUFF_SYMBOLS_2 = 19,
         TINFL_FAST_LOOKUP_BITS = 10,
-        TINFL_FAST_LOOKUP_SIZE = 1 << TINFL_FAST_LOOKUP_BITS
+        TINFL_FAST_LOOKUP_SIZE = 1 << TINFL_FAST_LOOKUP_BITS,
+        TINFL_FAST_LITLEN_BITS = 11,
+        TINFL_FAST_LITLEN_SIZE = 1 << TINFL_FAST_LITLEN_BITS
     };
 
 #if MINIZ_HAS_64BIT_REGISTERS
@@ -1023,6 +1091,12 @@ extern "C"
 #define TINFL_USE_64BIT_BITBUF 0
 #endif
 
+/* TINFL_USE_FAST_LOOP: Set to 1 to decode the bulk of each block with a refill-once 64-bit bit buffer loop, */
+/* wide combined literal/length tables and word-sized match copies. Requires TINFL_USE_64BIT_BITBUF. */
+#ifndef TINFL_USE_FAST_LOOP
+#define TINFL_USE_FAST_LOOP TINFL_USE_64BIT_BITBUF
+#endif
+
 #if TINFL_USE_64BIT_BITBUF
     typedef mz_uint64 tinfl_bit_buf_t;
 #define TINFL_BITBUF_SIZE (64)
@@ -1044,6 +1118,10 @@ typedef mz_uint32 tinfl_bit_buf_t;
         mz_uint8 m_code_size_1[TINFL_MAX_HUFF_SYMBOLS_1];
         mz_uint8 m_code_size_2[TINFL_MAX_HUFF_SYMBOLS_2];
         mz_uint8 m_raw_header[4], m_len_codes[TINFL_MAX_HUFF_SYMBOLS_0 + TINFL_MAX_HUFF_SYMBOLS_1 + 137];
+#if TINFL_USE_FAST_LOOP
+        mz_uint32 m_fast_litlen[TINFL_FAST_LITLEN_SIZE];
+        mz_uint32 m_fast_dist[TINFL_FAST_LOOKUP_SIZE];
+#endif
     };
 
 #ifdef __cplusplus
@@ -1068,6 +1146,8 @@ extern "C"
     {
         /* Note: These enums can be reduced as needed to save memory or stack space - they are pretty conservative. */
         MZ_ZIP_MAX_IO_BUF_SIZE = 64 * 1024,
+        /* Wrapping output buffer used when streaming entries out. Twice the deflate window, so tinfl's fast loop may copy whole words past a match. */
+        MZ_ZIP_READER_DICT_SIZE = 64 * 1024,
         MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE = 512,
         MZ_ZIP_MAX_ARCHIVE_FILE_COMMENT_SIZE = 512
     };
@@ -1158,7 +1238,12 @@ extern "C"
         /*After adding a compressed file, seek back
         to local file header and set the correct sizes*/
         MZ_ZIP_FLAG_WRITE_HEADER_SET_SIZE = 0x20000,
-        MZ_ZIP_FLAG_READ_ALLOW_WRITING = 0x40000
+        MZ_ZIP_FLAG_READ_ALLOW_WRITING = 0x40000,
+        /* Reader init: don't sort the central directory up front, sort it on the first mz_zip_reader_locate_file() that can use a binary search instead. */
+        MZ_ZIP_FLAG_DEFER_SORT_CENTRAL_DIRECTORY = 0x80000,
+        /* Writer: deflate the entry primed with the dictionary set by mz_zip_writer_set_preset_dict() and mark it MZ_DEFLATED_PRESET_DICT. */
+        /* With MZ_ZIP_FLAG_COMPRESSED_DATA the supplied raw deflate data must already have been compressed that way. */
+        MZ_ZIP_FLAG_PRESET_DICT = 0x100000
     } mz_zip_flags;
 
     typedef enum
@@ -1235,6 +1320,10 @@ extern "C"
 
         mz_zip_internal_state *m_pState;
 
+        /* Size of the buffers used to read entries and source files, and of the stdio buffer of the files miniz opens. */
+        /* Set it before the init call; 0 keeps MZ_ZIP_MAX_IO_BUF_SIZE and the default stdio buffering. */
+        size_t m_io_buf_size;
+
     } mz_zip_archive;
 
     typedef struct
@@ -1468,6 +1557,21 @@ extern "C"
     /* This function fully clones the source file's compressed data (no recompression), along with its full filename, extra data (it may add or modify the zip64 local header extra data field), and the optional descriptor following the compressed data. */
     MINIZ_EXPORT mz_bool mz_zip_writer_add_from_zip_reader(mz_zip_archive *pZip, mz_zip_archive *pSource_zip, mz_uint src_file_index);
 
+    /* Like mz_zip_writer_add_from_zip_reader(), except the entry is stored under pNew_archive_name (or the source name if NULL). The compressed data is still copied as-is. */
+    MINIZ_EXPORT mz_bool mz_zip_writer_add_from_zip_reader_v2(mz_zip_archive *pZip, mz_zip_archive *pSource_zip, mz_uint src_file_index, const char *pNew_archive_name);
+
+    /* Like mz_zip_writer_add_from_zip_reader_v2(), except the copy records pFile_time (the current time if NULL) as its modification time and ext_attributes */
+    /* as its external attributes, as if its data had just been added. Used to store duplicate content under another name without recompressing it. */
+    MINIZ_EXPORT mz_bool mz_zip_writer_add_from_zip_reader_v3(mz_zip_archive *pZip, mz_zip_archive *pSource_zip, mz_uint src_file_index, const char *pNew_archive_name,
+                                                              const MZ_TIME_T *pFile_time, mz_uint32 ext_attributes);
+
+    /* Reserves central directory room for num_files more entries whose names total name_bytes, so adding a large batch of entries grows it with a single allocation. */
+    MINIZ_EXPORT mz_bool mz_zip_writer_reserve_entries(mz_zip_archive *pZip, mz_uint num_files, mz_uint64 name_bytes);
+
+    /* Stores pDict (1 to MZ_ZIP_PRESET_DICT_MAX_SIZE bytes) uncompressed as the entry MZ_ZIP_PRESET_DICT_NAME and keeps a copy for later entries added with MZ_ZIP_FLAG_PRESET_DICT. */
+    /* An archive has at most one preset dictionary. Readers load it on the first MZ_DEFLATED_PRESET_DICT entry they extract. */
+    MINIZ_EXPORT mz_bool mz_zip_writer_add_preset_dict(mz_zip_archive *pZip, const void *pDict, size_t dict_size, MZ_TIME_T *last_modified);
+
     /* Finalizes the archive by writing the central directory records followed by the end of central directory record. */
     /* After an archive is finalized, the only valid call on the mz_zip_archive struct is mz_zip_writer_end(). */
     /* An archive must be manually finalized by calling this function for it to be valid. */
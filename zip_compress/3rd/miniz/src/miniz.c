@@ -31,19 +31,85 @@ typedef unsigned char mz_validate_uint16[sizeof(mz_uint16) == 2 ? 1 : -1];
 typedef unsigned char mz_validate_uint32[sizeof(mz_uint32) == 4 ? 1 : -1];
 typedef unsigned char mz_validate_uint64[sizeof(mz_uint64) == 8 ? 1 : -1];
 
+#if defined(_MSC_VER)
+#include <intrin.h> /* _BitScanForward */
+#endif
+
+/* SIMD kernels for CRC-32, adler-32, the deflate match length compare and the inflate match copy. x86 builds always have SSE2, plus */
+/* AVX2 and PCLMULQDQ kernels when the compiler supports per function targets; AArch64 builds have NEON, plus the CRC32 instructions */
+/* when the compiler targets them. Which ones run is decided by mz_set_cpu_features(). Define MINIZ_NO_SIMD for scalar only. */
+#if !defined(MINIZ_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define MINIZ_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5))
+#define MINIZ_SIMD_AVX2 1
+#define MINIZ_SIMD_PCLMUL 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define MZ_TARGET_AVX2 __attribute__((target("avx2")))
+#define MZ_TARGET_PCLMUL __attribute__((target("pclmul")))
+#else
+#define MZ_TARGET_AVX2
+#define MZ_TARGET_PCLMUL
+#endif
+#endif
+#elif !defined(MINIZ_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON))
+#define MINIZ_SIMD_NEON 1
+#include <arm_neon.h>
+#if defined(__ARM_FEATURE_CRC32) && MINIZ_LITTLE_ENDIAN
+#define MINIZ_SIMD_ARM_CRC32 1
+#include <arm_acle.h>
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-    /* ------------------- zlib-style API's */
+    /* ------------------- SIMD kernels */
 
-    mz_ulong mz_adler32(mz_ulong adler, const unsigned char *ptr, size_t buf_len)
+    typedef mz_uint32 (*mz_adler32_func)(mz_uint32 adler, const mz_uint8 *ptr, size_t buf_len);
+    typedef size_t (*mz_match_len_func)(const mz_uint8 *pA, const mz_uint8 *pB, size_t max_len);
+
+    /* Index of the lowest set bit of a non-zero value. */
+    static MZ_FORCEINLINE mz_uint mz_ctz32(mz_uint32 v)
     {
-        mz_uint32 i, s1 = (mz_uint32)(adler & 0xffff), s2 = (mz_uint32)(adler >> 16);
+#if defined(_MSC_VER)
+        unsigned long i;
+        _BitScanForward(&i, v);
+        return (mz_uint)i;
+#elif defined(__GNUC__) || defined(__clang__)
+        return (mz_uint)__builtin_ctz(v);
+#else
+        mz_uint i = 0;
+        while (!(v & 1))
+        {
+            v >>= 1;
+            i++;
+        }
+        return i;
+#endif
+    }
+
+    static MZ_FORCEINLINE mz_uint mz_ctz64(mz_uint64 v)
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long i;
+        _BitScanForward64(&i, v);
+        return (mz_uint)i;
+#elif defined(__GNUC__) || defined(__clang__)
+        return (mz_uint)__builtin_ctzll(v);
+#else
+        mz_uint32 lo = (mz_uint32)v;
+        return lo ? mz_ctz32(lo) : 32 + mz_ctz32((mz_uint32)(v >> 32));
+#endif
+    }
+
+    static mz_uint32 mz_adler32_scalar(mz_uint32 adler, const mz_uint8 *ptr, size_t buf_len)
+    {
+        mz_uint32 i, s1 = adler & 0xffff, s2 = adler >> 16;
         size_t block_len = buf_len % 5552;
-        if (!ptr)
-            return MZ_ADLER32_INIT;
         while (buf_len)
         {
             for (i = 0; i + 7 < block_len; i += 8, ptr += 8)
@@ -66,6 +132,217 @@ extern "C"
         return (s2 << 16) + s1;
     }
 
+    /* Length of the common prefix of pA and pB, reading at most max_len bytes from each. */
+    static size_t mz_match_len_scalar(const mz_uint8 *pA, const mz_uint8 *pB, size_t max_len)
+    {
+        size_t len = 0;
+#if MINIZ_LITTLE_ENDIAN && MINIZ_HAS_64BIT_REGISTERS
+        for (; len + 8 <= max_len; len += 8)
+        {
+            mz_uint64 a, b;
+            memcpy(&a, pA + len, sizeof(a));
+            memcpy(&b, pB + len, sizeof(b));
+            if (a != b)
+                return len + (mz_ctz64(a ^ b) >> 3);
+        }
+#endif
+        while ((len < max_len) && (pA[len] == pB[len]))
+            len++;
+        return len;
+    }
+
+#if MINIZ_SIMD_SSE2
+    static MZ_FORCEINLINE mz_uint32 mz_hsum_epi32(__m128i v)
+    {
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return (mz_uint32)_mm_cvtsi128_si32(v);
+    }
+
+    /* Each 16 byte vector adds its byte sum to s1 and its bytes weighted 16..1 to s2; v_ps collects the s1 of every earlier vector, */
+    /* which each of the 16 bytes adds to s2 once more. 5552 bytes (a multiple of 16) is the most s2 can absorb before it must be reduced. */
+    static mz_uint32 mz_adler32_sse2(mz_uint32 adler, const mz_uint8 *ptr, size_t buf_len)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i weights_lo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+        const __m128i weights_hi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+        mz_uint32 s1 = adler & 0xffff, s2 = adler >> 16;
+        while (buf_len >= 16)
+        {
+            size_t n = MZ_MIN(buf_len, 5552) & ~(size_t)15;
+            __m128i v_s1 = zero, v_ps = zero, v_s2 = zero;
+            buf_len -= n;
+            s2 += s1 * (mz_uint32)n;
+            for (; n; n -= 16, ptr += 16)
+            {
+                __m128i bytes = _mm_loadu_si128((const __m128i *)ptr);
+                v_ps = _mm_add_epi32(v_ps, v_s1);
+                v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes, zero));
+                v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weights_lo));
+                v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weights_hi));
+            }
+            v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 4));
+            s1 = (s1 + mz_hsum_epi32(v_s1)) % 65521U;
+            s2 = (s2 + mz_hsum_epi32(v_s2)) % 65521U;
+        }
+        return mz_adler32_scalar((s2 << 16) + s1, ptr, buf_len);
+    }
+
+    static size_t mz_match_len_sse2(const mz_uint8 *pA, const mz_uint8 *pB, size_t max_len)
+    {
+        size_t len = 0;
+        for (; len + 16 <= max_len; len += 16)
+        {
+            mz_uint32 mask = (mz_uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pA + len)), _mm_loadu_si128((const __m128i *)(pB + len))));
+            if (mask != 0xFFFF)
+                return len + mz_ctz32(~mask);
+        }
+        return len + mz_match_len_scalar(pA + len, pB + len, max_len - len);
+    }
+#endif
+
+#if MINIZ_SIMD_AVX2
+    /* Same scheme as mz_adler32_sse2() with 32 byte vectors, so the block is cut to 5536 bytes. */
+    static MZ_TARGET_AVX2 mz_uint32 mz_adler32_avx2(mz_uint32 adler, const mz_uint8 *ptr, size_t buf_len)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+        const __m256i ones = _mm256_set1_epi16(1);
+        mz_uint32 s1 = adler & 0xffff, s2 = adler >> 16;
+        while (buf_len >= 32)
+        {
+            size_t n = MZ_MIN(buf_len, 5536) & ~(size_t)31;
+            __m256i v_s1 = zero, v_ps = zero, v_s2 = zero;
+            buf_len -= n;
+            s2 += s1 * (mz_uint32)n;
+            for (; n; n -= 32, ptr += 32)
+            {
+                __m256i bytes = _mm256_loadu_si256((const __m256i *)ptr);
+                v_ps = _mm256_add_epi32(v_ps, v_s1);
+                v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(bytes, zero));
+                v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights), ones));
+            }
+            v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 5));
+            s1 = (s1 + mz_hsum_epi32(_mm_add_epi32(_mm256_castsi256_si128(v_s1), _mm256_extracti128_si256(v_s1, 1)))) % 65521U;
+            s2 = (s2 + mz_hsum_epi32(_mm_add_epi32(_mm256_castsi256_si128(v_s2), _mm256_extracti128_si256(v_s2, 1)))) % 65521U;
+        }
+        return mz_adler32_sse2((s2 << 16) + s1, ptr, buf_len);
+    }
+
+    static MZ_TARGET_AVX2 size_t mz_match_len_avx2(const mz_uint8 *pA, const mz_uint8 *pB, size_t max_len)
+    {
+        size_t len = 0;
+        for (; len + 32 <= max_len; len += 32)
+        {
+            mz_uint32 mask = (mz_uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(pA + len)), _mm256_loadu_si256((const __m256i *)(pB + len))));
+            if (mask != 0xFFFFFFFFU)
+                return len + mz_ctz32(~mask);
+        }
+        return len + mz_match_len_sse2(pA + len, pB + len, max_len - len);
+    }
+#endif
+
+#if MINIZ_SIMD_NEON
+    static MZ_FORCEINLINE mz_uint32 mz_hsum_u32x4(uint32x4_t v)
+    {
+        uint32x2_t t = vadd_u32(vget_low_u32(v), vget_high_u32(v));
+        return vget_lane_u32(vpadd_u32(t, t), 0);
+    }
+
+    /* Same scheme as mz_adler32_sse2(). */
+    static mz_uint32 mz_adler32_neon(mz_uint32 adler, const mz_uint8 *ptr, size_t buf_len)
+    {
+        static const mz_uint16 s_weights[16] = { 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+        const uint16x4_t w0 = vld1_u16(s_weights), w1 = vld1_u16(s_weights + 4), w2 = vld1_u16(s_weights + 8), w3 = vld1_u16(s_weights + 12);
+        mz_uint32 s1 = adler & 0xffff, s2 = adler >> 16;
+        while (buf_len >= 16)
+        {
+            size_t n = MZ_MIN(buf_len, 5552) & ~(size_t)15;
+            uint32x4_t v_s1 = vdupq_n_u32(0), v_ps = vdupq_n_u32(0), v_s2 = vdupq_n_u32(0);
+            buf_len -= n;
+            s2 += s1 * (mz_uint32)n;
+            for (; n; n -= 16, ptr += 16)
+            {
+                uint8x16_t bytes = vld1q_u8(ptr);
+                uint16x8_t lo = vmovl_u8(vget_low_u8(bytes)), hi = vmovl_u8(vget_high_u8(bytes));
+                v_ps = vaddq_u32(v_ps, v_s1);
+                v_s1 = vpadalq_u16(v_s1, vpaddlq_u8(bytes));
+                v_s2 = vmlal_u16(v_s2, vget_low_u16(lo), w0);
+                v_s2 = vmlal_u16(v_s2, vget_high_u16(lo), w1);
+                v_s2 = vmlal_u16(v_s2, vget_low_u16(hi), w2);
+                v_s2 = vmlal_u16(v_s2, vget_high_u16(hi), w3);
+            }
+            v_s2 = vaddq_u32(v_s2, vshlq_n_u32(v_ps, 4));
+            s1 = (s1 + mz_hsum_u32x4(v_s1)) % 65521U;
+            s2 = (s2 + mz_hsum_u32x4(v_s2)) % 65521U;
+        }
+        return mz_adler32_scalar((s2 << 16) + s1, ptr, buf_len);
+    }
+
+    static size_t mz_match_len_neon(const mz_uint8 *pA, const mz_uint8 *pB, size_t max_len)
+    {
+        size_t len = 0;
+        for (; len + 16 <= max_len; len += 16)
+        {
+            uint64x2_t diff = vreinterpretq_u64_u8(veorq_u8(vld1q_u8(pA + len), vld1q_u8(pB + len)));
+            mz_uint64 lo = vgetq_lane_u64(diff, 0), hi = vgetq_lane_u64(diff, 1);
+            if (lo)
+                return len + (mz_ctz64(lo) >> 3);
+            if (hi)
+                return len + 8 + (mz_ctz64(hi) >> 3);
+        }
+        return len + mz_match_len_scalar(pA + len, pB + len, max_len - len);
+    }
+#endif
+
+    /* Copies len bytes from pSrc to pDst in 16 byte steps, writing up to 15 bytes past pDst + len. pDst must be at least 16 bytes */
+    /* past pSrc: every step then loads bytes that are already final, so overlapping long matches copy correctly. */
+    static void mz_inflate_copy_scalar(mz_uint8 *pDst, const mz_uint8 *pSrc, size_t len)
+    {
+        size_t i;
+        for (i = 0; i < len; i += 16)
+        {
+            mz_uint64 v0, v1;
+            memcpy(&v0, pSrc + i, sizeof(v0));
+            memcpy(&v1, pSrc + i + 8, sizeof(v1));
+            memcpy(pDst + i, &v0, sizeof(v0));
+            memcpy(pDst + i + 8, &v1, sizeof(v1));
+        }
+    }
+
+#if MINIZ_SIMD_SSE2
+    static void mz_inflate_copy_sse2(mz_uint8 *pDst, const mz_uint8 *pSrc, size_t len)
+    {
+        size_t i;
+        for (i = 0; i < len; i += 16)
+            _mm_storeu_si128((__m128i *)(pDst + i), _mm_loadu_si128((const __m128i *)(pSrc + i)));
+    }
+#endif
+
+#if MINIZ_SIMD_AVX2
+    /* 32 byte steps need the source 32 bytes behind; the tail and closer sources fall back to 16 byte steps. */
+    static MZ_TARGET_AVX2 void mz_inflate_copy_avx2(mz_uint8 *pDst, const mz_uint8 *pSrc, size_t len)
+    {
+        size_t i = 0;
+        if ((size_t)(pDst - pSrc) >= 32)
+        {
+            for (; i + 32 <= len; i += 32)
+                _mm256_storeu_si256((__m256i *)(pDst + i), _mm256_loadu_si256((const __m256i *)(pSrc + i)));
+        }
+        for (; i < len; i += 16)
+            _mm_storeu_si128((__m128i *)(pDst + i), _mm_loadu_si128((const __m128i *)(pSrc + i)));
+    }
+#endif
+
+#if MINIZ_SIMD_NEON
+    static void mz_inflate_copy_neon(mz_uint8 *pDst, const mz_uint8 *pSrc, size_t len)
+    {
+        size_t i;
+        for (i = 0; i < len; i += 16)
+            vst1q_u8(pDst + i, vld1q_u8(pSrc + i));
+    }
+#endif
+
 /* Karl Malbrain's compact CRC-32. See "A compact CCITT crc16 and crc32 C implementation that balances processor cache usage against speed": http://www.geocities.com/malbrain/ */
 #if 0
     mz_ulong mz_crc32(mz_ulong crc, const mz_uint8 *ptr, size_t buf_len)
@@ -93,7 +370,8 @@ mz_ulong mz_crc32(mz_ulong crc, const mz_uint8 *ptr, size_t buf_len);
 #else
 /* Faster, but larger CPU cache footprint.
  */
-mz_ulong mz_crc32(mz_ulong crc, const mz_uint8 *ptr, size_t buf_len)
+#define MINIZ_CRC32_KERNELS 1
+static mz_uint32 mz_crc32_scalar(mz_uint32 crc, const mz_uint8 *ptr, size_t buf_len)
 {
     static const mz_uint32 s_crc_table[256] = {
         0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535,
@@ -135,7 +413,7 @@ mz_ulong mz_crc32(mz_ulong crc, const mz_uint8 *ptr, size_t buf_len)
         0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
     };
 
-    mz_uint32 crc32 = (mz_uint32)crc ^ 0xFFFFFFFF;
+    mz_uint32 crc32 = crc ^ 0xFFFFFFFF;
     const mz_uint8 *pByte_buf = (const mz_uint8 *)ptr;
 
     while (buf_len >= 4)
@@ -157,6 +435,320 @@ mz_ulong mz_crc32(mz_ulong crc, const mz_uint8 *ptr, size_t buf_len)
 
     return ~crc32;
 }
+
+#if MINIZ_SIMD_PCLMUL
+    /* Folds 4 x 128 bits in parallel with carry-less multiplies, then reduces to 32 bits (Barrett), as in Intel's "Fast CRC Computation for */
+    /* Generic Polynomials Using PCLMULQDQ Instruction". Works on the inverted CRC; buf_len must be a multiple of 16 and at least 64. */
+    static MZ_TARGET_PCLMUL mz_uint32 mz_crc32_fold_pclmul(mz_uint32 crc, const mz_uint8 *ptr, size_t buf_len)
+    {
+        static const mz_uint64 s_k1k2[2] = { 0x0154442bd4ULL, 0x01c6e41596ULL }, s_k3k4[2] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+        static const mz_uint64 s_k5k0[2] = { 0x0163cd6124ULL, 0 }, s_poly[2] = { 0x01db710641ULL, 0x01f7011641ULL };
+        const __m128i k1k2 = _mm_loadu_si128((const __m128i *)s_k1k2), k3k4 = _mm_loadu_si128((const __m128i *)s_k3k4);
+        const __m128i k5k0 = _mm_loadu_si128((const __m128i *)s_k5k0), poly = _mm_loadu_si128((const __m128i *)s_poly);
+        const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+        __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+        x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)ptr), _mm_cvtsi32_si128((int)crc));
+        x2 = _mm_loadu_si128((const __m128i *)(ptr + 16));
+        x3 = _mm_loadu_si128((const __m128i *)(ptr + 32));
+        x4 = _mm_loadu_si128((const __m128i *)(ptr + 48));
+        ptr += 64;
+        buf_len -= 64;
+
+        for (; buf_len >= 64; ptr += 64, buf_len -= 64)
+        {
+            x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+            x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+            x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+            x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+            x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), x5), _mm_loadu_si128((const __m128i *)ptr));
+            x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), x6), _mm_loadu_si128((const __m128i *)(ptr + 16)));
+            x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), x7), _mm_loadu_si128((const __m128i *)(ptr + 32)));
+            x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), x8), _mm_loadu_si128((const __m128i *)(ptr + 48)));
+        }
+
+        /* Fold the 4 lanes into one, then the remaining 16 byte blocks. */
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+        for (; buf_len >= 16; ptr += 16, buf_len -= 16)
+        {
+            x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+            x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_loadu_si128((const __m128i *)ptr)), x5);
+        }
+
+        /* 128 -> 64 bits */
+        x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+        x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+        x2 = _mm_srli_si128(x1, 4);
+        x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00), x2);
+
+        /* Barrett reduction to 32 bits */
+        x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+        x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), poly, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+        return (mz_uint32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+    }
+
+    static MZ_TARGET_PCLMUL mz_uint32 mz_crc32_pclmul(mz_uint32 crc, const mz_uint8 *ptr, size_t buf_len)
+    {
+        if (buf_len >= 64)
+        {
+            size_t n = buf_len & ~(size_t)15;
+            crc = ~mz_crc32_fold_pclmul(~crc, ptr, n);
+            ptr += n;
+            buf_len -= n;
+        }
+        return mz_crc32_scalar(crc, ptr, buf_len);
+    }
+#endif
+
+#if MINIZ_SIMD_ARM_CRC32
+    static mz_uint32 mz_crc32_arm(mz_uint32 crc, const mz_uint8 *ptr, size_t buf_len)
+    {
+        crc = ~crc;
+        for (; buf_len >= 8; ptr += 8, buf_len -= 8)
+        {
+            mz_uint64 v;
+            memcpy(&v, ptr, sizeof(v));
+            crc = __crc32d(crc, v);
+        }
+        for (; buf_len; ++ptr, --buf_len)
+            crc = __crc32b(crc, *ptr);
+        return ~crc;
+    }
+#endif
+#endif
+
+    /* ------------------- Kernel dispatch */
+
+    typedef mz_uint32 (*mz_crc32_func)(mz_uint32 crc, const mz_uint8 *ptr, size_t buf_len);
+    typedef void (*mz_inflate_copy_func)(mz_uint8 *pDst, const mz_uint8 *pSrc, size_t len);
+
+    /* Until mz_set_cpu_features() is called, the first kernel call binds the ones the compiler targets unconditionally. */
+#if MINIZ_SIMD_SSE2
+#define MZ_DEFAULT_CPU_FEATURES MZ_CPU_SSE2
+#elif MINIZ_SIMD_ARM_CRC32
+#define MZ_DEFAULT_CPU_FEATURES (MZ_CPU_NEON | MZ_CPU_ARM_CRC32)
+#elif MINIZ_SIMD_NEON
+#define MZ_DEFAULT_CPU_FEATURES MZ_CPU_NEON
+#else
+#define MZ_DEFAULT_CPU_FEATURES 0
+#endif
+
+    static mz_uint32 mz_adler32_resolve(mz_uint32 adler, const mz_uint8 *ptr, size_t buf_len);
+    static size_t mz_match_len_resolve(const mz_uint8 *pA, const mz_uint8 *pB, size_t max_len);
+    static void mz_inflate_copy_resolve(mz_uint8 *pDst, const mz_uint8 *pSrc, size_t len);
+
+    /* The kernel bindings are written by mz_set_cpu_features() and by the lazy first-call binding while other threads */
+    /* may be compressing or extracting, so every access is a relaxed atomic load or store. A thread racing a rebind */
+    /* may see a mix of old and new bindings; each one is still a valid kernel for this CPU. */
+#if defined(__GNUC__) || defined(__clang__)
+#define MZ_KERNEL_VAR
+#define MZ_KERNEL_LOAD(v) __atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define MZ_KERNEL_STORE(v, x) __atomic_store_n(&(v), (x), __ATOMIC_RELAXED)
+#else
+/* MSVC: aligned pointer- and int-sized volatile accesses are single, untorn loads and stores. */
+#define MZ_KERNEL_VAR volatile
+#define MZ_KERNEL_LOAD(v) (v)
+#define MZ_KERNEL_STORE(v, x) ((v) = (x))
+#endif
+
+    static mz_adler32_func MZ_KERNEL_VAR g_mz_adler32 = mz_adler32_resolve;
+    static mz_match_len_func MZ_KERNEL_VAR g_mz_match_len = mz_match_len_resolve;
+    static mz_inflate_copy_func MZ_KERNEL_VAR g_mz_inflate_copy = mz_inflate_copy_resolve;
+    static int MZ_KERNEL_VAR g_mz_kernels_bound;
+    static int MZ_KERNEL_VAR g_mz_crc32_kernel, g_mz_adler32_kernel, g_mz_match_len_kernel, g_mz_inflate_copy_kernel;
+#if MINIZ_CRC32_KERNELS
+    static mz_uint32 mz_crc32_resolve(mz_uint32 crc, const mz_uint8 *ptr, size_t buf_len);
+    static mz_crc32_func MZ_KERNEL_VAR g_mz_crc32 = mz_crc32_resolve;
+#endif
+
+    unsigned int mz_supported_cpu_features(void)
+    {
+        unsigned int features = 0;
+#if MINIZ_SIMD_SSE2
+        features |= MZ_CPU_SSE2;
+#endif
+#if MINIZ_SIMD_AVX2
+        features |= MZ_CPU_AVX2;
+#endif
+#if MINIZ_SIMD_PCLMUL && MINIZ_CRC32_KERNELS
+        features |= MZ_CPU_PCLMUL;
+#endif
+#if MINIZ_SIMD_NEON
+        features |= MZ_CPU_NEON;
+#endif
+#if MINIZ_SIMD_ARM_CRC32 && MINIZ_CRC32_KERNELS
+        features |= MZ_CPU_ARM_CRC32;
+#endif
+        return features;
+    }
+
+    void mz_set_cpu_features(unsigned int features)
+    {
+        int vector_kernel = MZ_KERNEL_SCALAR;
+        mz_adler32_func adler32 = mz_adler32_scalar;
+        mz_match_len_func match_len = mz_match_len_scalar;
+        mz_inflate_copy_func inflate_copy = mz_inflate_copy_scalar;
+        features &= mz_supported_cpu_features();
+#if MINIZ_SIMD_SSE2
+        if (features & MZ_CPU_SSE2)
+        {
+            vector_kernel = MZ_KERNEL_SSE2;
+            adler32 = mz_adler32_sse2;
+            match_len = mz_match_len_sse2;
+            inflate_copy = mz_inflate_copy_sse2;
+        }
+#endif
+#if MINIZ_SIMD_AVX2
+        if ((features & (MZ_CPU_SSE2 | MZ_CPU_AVX2)) == (MZ_CPU_SSE2 | MZ_CPU_AVX2))
+        {
+            vector_kernel = MZ_KERNEL_AVX2;
+            adler32 = mz_adler32_avx2;
+            match_len = mz_match_len_avx2;
+            inflate_copy = mz_inflate_copy_avx2;
+        }
+#endif
+#if MINIZ_SIMD_NEON
+        if (features & MZ_CPU_NEON)
+        {
+            vector_kernel = MZ_KERNEL_NEON;
+            adler32 = mz_adler32_neon;
+            match_len = mz_match_len_neon;
+            inflate_copy = mz_inflate_copy_neon;
+        }
+#endif
+#if MINIZ_CRC32_KERNELS
+        MZ_KERNEL_STORE(g_mz_crc32, mz_crc32_scalar);
+        MZ_KERNEL_STORE(g_mz_crc32_kernel, MZ_KERNEL_SCALAR);
+#if MINIZ_SIMD_PCLMUL
+        if ((features & (MZ_CPU_SSE2 | MZ_CPU_PCLMUL)) == (MZ_CPU_SSE2 | MZ_CPU_PCLMUL))
+        {
+            MZ_KERNEL_STORE(g_mz_crc32, mz_crc32_pclmul);
+            MZ_KERNEL_STORE(g_mz_crc32_kernel, MZ_KERNEL_PCLMUL);
+        }
+#endif
+#if MINIZ_SIMD_ARM_CRC32
+        if (features & MZ_CPU_ARM_CRC32)
+        {
+            MZ_KERNEL_STORE(g_mz_crc32, mz_crc32_arm);
+            MZ_KERNEL_STORE(g_mz_crc32_kernel, MZ_KERNEL_ARM_CRC32);
+        }
+#endif
+#else
+        MZ_KERNEL_STORE(g_mz_crc32_kernel, MZ_KERNEL_EXTERNAL);
+#endif
+        MZ_KERNEL_STORE(g_mz_adler32, adler32);
+        MZ_KERNEL_STORE(g_mz_match_len, match_len);
+        MZ_KERNEL_STORE(g_mz_inflate_copy, inflate_copy);
+        MZ_KERNEL_STORE(g_mz_adler32_kernel, vector_kernel);
+        MZ_KERNEL_STORE(g_mz_match_len_kernel, vector_kernel);
+        MZ_KERNEL_STORE(g_mz_inflate_copy_kernel, vector_kernel);
+        MZ_KERNEL_STORE(g_mz_kernels_bound, 1);
+    }
+
+    static void mz_bind_default_kernels(void)
+    {
+        if (!MZ_KERNEL_LOAD(g_mz_kernels_bound))
+            mz_set_cpu_features(MZ_DEFAULT_CPU_FEATURES);
+    }
+
+    static mz_uint32 mz_adler32_resolve(mz_uint32 adler, const mz_uint8 *ptr, size_t buf_len)
+    {
+        mz_bind_default_kernels();
+        return MZ_KERNEL_LOAD(g_mz_adler32)(adler, ptr, buf_len);
+    }
+
+    static size_t mz_match_len_resolve(const mz_uint8 *pA, const mz_uint8 *pB, size_t max_len)
+    {
+        mz_bind_default_kernels();
+        return MZ_KERNEL_LOAD(g_mz_match_len)(pA, pB, max_len);
+    }
+
+    static void mz_inflate_copy_resolve(mz_uint8 *pDst, const mz_uint8 *pSrc, size_t len)
+    {
+        mz_bind_default_kernels();
+        MZ_KERNEL_LOAD(g_mz_inflate_copy)(pDst, pSrc, len);
+    }
+
+#if MINIZ_CRC32_KERNELS
+    static mz_uint32 mz_crc32_resolve(mz_uint32 crc, const mz_uint8 *ptr, size_t buf_len)
+    {
+        mz_bind_default_kernels();
+        return MZ_KERNEL_LOAD(g_mz_crc32)(crc, ptr, buf_len);
+    }
+#endif
+
+    int mz_crc32_kernel(void)
+    {
+        mz_bind_default_kernels();
+        return MZ_KERNEL_LOAD(g_mz_crc32_kernel);
+    }
+
+    int mz_adler32_kernel(void)
+    {
+        mz_bind_default_kernels();
+        return MZ_KERNEL_LOAD(g_mz_adler32_kernel);
+    }
+
+    int mz_match_len_kernel(void)
+    {
+        mz_bind_default_kernels();
+        return MZ_KERNEL_LOAD(g_mz_match_len_kernel);
+    }
+
+    int mz_inflate_copy_kernel(void)
+    {
+        mz_bind_default_kernels();
+        return MZ_KERNEL_LOAD(g_mz_inflate_copy_kernel);
+    }
+
+    const char *mz_kernel_name(int kernel)
+    {
+        switch (kernel)
+        {
+            case MZ_KERNEL_SCALAR:
+                return "scalar";
+            case MZ_KERNEL_SSE2:
+                return "sse2";
+            case MZ_KERNEL_AVX2:
+                return "avx2";
+            case MZ_KERNEL_NEON:
+                return "neon";
+            case MZ_KERNEL_PCLMUL:
+                return "pclmul";
+            case MZ_KERNEL_ARM_CRC32:
+                return "arm-crc32";
+            case MZ_KERNEL_EXTERNAL:
+                return "external";
+            default:
+                return "unknown";
+        }
+    }
+
+    size_t mz_match_len(const unsigned char *pA, const unsigned char *pB, size_t max_len)
+    {
+        return MZ_KERNEL_LOAD(g_mz_match_len)(pA, pB, max_len);
+    }
+
+    /* ------------------- zlib-style API's */
+
+    mz_ulong mz_adler32(mz_ulong adler, const unsigned char *ptr, size_t buf_len)
+    {
+        if (!ptr)
+            return MZ_ADLER32_INIT;
+        return MZ_KERNEL_LOAD(g_mz_adler32)((mz_uint32)adler, ptr, buf_len);
+    }
+
+#if MINIZ_CRC32_KERNELS
+    mz_ulong mz_crc32(mz_ulong crc, const mz_uint8 *ptr, size_t buf_len)
+    {
+        return MZ_KERNEL_LOAD(g_mz_crc32)((mz_uint32)crc, ptr, buf_len);
+    }
 #endif
 
     void mz_free(void *p)
@@ -1402,6 +1994,23 @@ static mz_bool tdefl_compress_lz_codes(tdefl_compressor *d)
         return d->m_output_flush_remaining;
     }
 
+    /* Most candidates differ within the first few bytes, so test 8 bytes inline before paying for the call into the match length kernel. */
+    static MZ_FORCEINLINE mz_uint tdefl_match_len(const mz_uint8 *pA, const mz_uint8 *pB, mz_uint max_len)
+    {
+#if MINIZ_LITTLE_ENDIAN && MINIZ_HAS_64BIT_REGISTERS
+        if (max_len >= 8)
+        {
+            mz_uint64 a, b;
+            memcpy(&a, pA, sizeof(a));
+            memcpy(&b, pB, sizeof(b));
+            if (a != b)
+                return mz_ctz64(a ^ b) >> 3;
+            return 8 + (mz_uint)MZ_KERNEL_LOAD(g_mz_match_len)(pA + 8, pB + 8, max_len - 8);
+        }
+#endif
+        return (mz_uint)MZ_KERNEL_LOAD(g_mz_match_len)(pA, pB, max_len);
+    }
+
 #if MINIZ_USE_UNALIGNED_LOADS_AND_STORES
 #ifdef MINIZ_UNALIGNED_USE_MEMCPY
     static mz_uint16 TDEFL_READ_UNALIGNED_WORD(const mz_uint8 *p)
@@ -1424,7 +2033,7 @@ static mz_bool tdefl_compress_lz_codes(tdefl_compressor *d)
     {
         mz_uint dist, pos = lookahead_pos & TDEFL_LZ_DICT_SIZE_MASK, match_len = *pMatch_len, probe_pos = pos, next_probe_pos, probe_len;
         mz_uint num_probes_left = d->m_max_probes[match_len >= 32];
-        const mz_uint16 *s = (const mz_uint16 *)(d->m_dict + pos), *p, *q;
+        const mz_uint16 *s = (const mz_uint16 *)(d->m_dict + pos), *q;
         mz_uint16 c01 = TDEFL_READ_UNALIGNED_WORD(&d->m_dict[pos + match_len - 1]), s01 = TDEFL_READ_UNALIGNED_WORD2(s);
         MZ_ASSERT(max_match_len <= TDEFL_MAX_MATCH_LEN);
         if (max_match_len <= match_len)
@@ -1451,22 +2060,10 @@ static mz_bool tdefl_compress_lz_codes(tdefl_compressor *d)
             q = (const mz_uint16 *)(d->m_dict + probe_pos);
             if (TDEFL_READ_UNALIGNED_WORD2(q) != s01)
                 continue;
-            p = s;
-            probe_len = 32;
-            do
-            {
-            } while ((TDEFL_READ_UNALIGNED_WORD2(++p) == TDEFL_READ_UNALIGNED_WORD2(++q)) && (TDEFL_READ_UNALIGNED_WORD2(++p) == TDEFL_READ_UNALIGNED_WORD2(++q)) &&
-                     (TDEFL_READ_UNALIGNED_WORD2(++p) == TDEFL_READ_UNALIGNED_WORD2(++q)) && (TDEFL_READ_UNALIGNED_WORD2(++p) == TDEFL_READ_UNALIGNED_WORD2(++q)) && (--probe_len > 0));
-            if (!probe_len)
-            {
-                *pMatch_dist = dist;
-                *pMatch_len = MZ_MIN(max_match_len, (mz_uint)TDEFL_MAX_MATCH_LEN);
-                break;
-            }
-            else if ((probe_len = ((mz_uint)(p - s) * 2) + (mz_uint)(*(const mz_uint8 *)p == *(const mz_uint8 *)q)) > match_len)
+            if ((probe_len = tdefl_match_len((const mz_uint8 *)s, (const mz_uint8 *)q, max_match_len)) > match_len)
             {
                 *pMatch_dist = dist;
-                if ((*pMatch_len = match_len = MZ_MIN(max_match_len, probe_len)) == max_match_len)
+                if ((*pMatch_len = match_len = probe_len) == max_match_len)
                     break;
                 c01 = TDEFL_READ_UNALIGNED_WORD(&d->m_dict[pos + match_len - 1]);
             }
@@ -1477,7 +2074,7 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
 {
     mz_uint dist, pos = lookahead_pos & TDEFL_LZ_DICT_SIZE_MASK, match_len = *pMatch_len, probe_pos = pos, next_probe_pos, probe_len;
     mz_uint num_probes_left = d->m_max_probes[match_len >= 32];
-    const mz_uint8 *s = d->m_dict + pos, *p, *q;
+    const mz_uint8 *s = d->m_dict + pos;
     mz_uint8 c0 = d->m_dict[pos + match_len], c1 = d->m_dict[pos + match_len - 1];
     MZ_ASSERT(max_match_len <= TDEFL_MAX_MATCH_LEN);
     if (max_match_len <= match_len)
@@ -1501,12 +2098,7 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
         }
         if (!dist)
             break;
-        p = s;
-        q = d->m_dict + probe_pos;
-        for (probe_len = 0; probe_len < max_match_len; probe_len++)
-            if (*p++ != *q++)
-                break;
-        if (probe_len > match_len)
+        if ((probe_len = tdefl_match_len(s, d->m_dict + probe_pos, max_match_len)) > match_len)
         {
             *pMatch_dist = dist;
             if ((*pMatch_len = match_len = probe_len) == max_match_len)
@@ -1518,20 +2110,40 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
 }
 #endif /* #if MINIZ_USE_UNALIGNED_LOADS_AND_STORES */
 
-#if MINIZ_USE_UNALIGNED_LOADS_AND_STORES && MINIZ_LITTLE_ENDIAN
-#ifdef MINIZ_UNALIGNED_USE_MEMCPY
-    static mz_uint32 TDEFL_READ_UNALIGNED_WORD32(const mz_uint8 *p)
+#if TDEFL_USE_FAST_MATCHER
+/* m_hash holds TDEFL_LZ_HASH_SIZE / 2 buckets of the 2 most recent positions. */
+#define TDEFL_FAST_HASH_BITS (TDEFL_LZ_HASH_BITS - 1)
+
+    static MZ_FORCEINLINE mz_uint32 tdefl_read_le32(const mz_uint8 *p)
     {
-        mz_uint32 ret;
-        memcpy(&ret, p, sizeof(mz_uint32));
-        return ret;
+        mz_uint32 v;
+        memcpy(&v, p, sizeof(v));
+        return v;
     }
-#else
-#define TDEFL_READ_UNALIGNED_WORD32(p) *(const mz_uint32 *)(p)
-#endif
+
+    static MZ_FORCEINLINE mz_uint64 tdefl_read_le64(const mz_uint8 *p)
+    {
+        mz_uint64 v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static MZ_FORCEINLINE mz_uint16 *tdefl_fast_bucket(tdefl_compressor *d, mz_uint32 first_4_bytes)
+    {
+        return d->m_hash + (((first_4_bytes * 2654435761U) >> (32 - TDEFL_FAST_HASH_BITS)) << 1);
+    }
+
+    /* Inserts a position into its bucket, evicting the oldest entry. */
+    static MZ_FORCEINLINE void tdefl_fast_insert(mz_uint16 *pBucket, mz_uint pos)
+    {
+        pBucket[1] = pBucket[0];
+        pBucket[0] = (mz_uint16)pos;
+    }
+
     static mz_bool tdefl_compress_fast(tdefl_compressor *d)
     {
-        /* Faster, minimally featured LZRW1-style match+parse loop with better register utilization. Intended for applications where raw throughput is valued more highly than ratio. */
+        /* Greedy single-pass parser for level 1: a multiplicative hash of the next 4 bytes selects a bucket of the 2 most recent positions */
+        /* (stored in m_hash), candidates are verified on 4 bytes and extended 8 bytes at a time. Emits the same LZ codes as tdefl_compress_normal(). */
         mz_uint lookahead_pos = d->m_lookahead_pos, lookahead_size = d->m_lookahead_size, dict_size = d->m_dict_size, total_lz_bytes = d->m_total_lz_bytes, num_flags_left = d->m_num_flags_left;
         mz_uint8 *pLZ_code_buf = d->m_pLZ_code_buf, *pLZ_flags = d->m_pLZ_flags;
         mz_uint cur_pos = lookahead_pos & TDEFL_LZ_DICT_SIZE_MASK;
@@ -1541,6 +2153,7 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
             const mz_uint TDEFL_COMP_FAST_LOOKAHEAD_SIZE = 4096;
             mz_uint dst_pos = (lookahead_pos + lookahead_size) & TDEFL_LZ_DICT_SIZE_MASK;
             mz_uint num_bytes_to_process = (mz_uint)MZ_MIN(d->m_src_buf_left, TDEFL_COMP_FAST_LOOKAHEAD_SIZE - lookahead_size);
+            mz_uint min_lookahead;
             d->m_src_buf_left -= num_bytes_to_process;
             lookahead_size += num_bytes_to_process;
 
@@ -1559,66 +2172,98 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
             if ((!d->m_flush) && (lookahead_size < TDEFL_COMP_FAST_LOOKAHEAD_SIZE))
                 break;
 
-            while (lookahead_size >= 4)
+            /* Keep a full match length of lookahead between input chunks so matches do not stop at chunk boundaries; */
+            /* the last 3 bytes of the stream are left for the literal loop below. */
+            min_lookahead = ((d->m_flush) && (!d->m_src_buf_left)) ? 4 : TDEFL_MAX_MATCH_LEN;
+            while (lookahead_size >= min_lookahead)
             {
-                mz_uint cur_match_dist, cur_match_len = 1;
-                mz_uint8 *pCur_dict = d->m_dict + cur_pos;
-                mz_uint first_trigram = TDEFL_READ_UNALIGNED_WORD32(pCur_dict) & 0xFFFFFF;
-                mz_uint hash = (first_trigram ^ (first_trigram >> (24 - (TDEFL_LZ_HASH_BITS - 8)))) & TDEFL_LEVEL1_HASH_SIZE_MASK;
-                mz_uint probe_pos = d->m_hash[hash];
-                d->m_hash[hash] = (mz_uint16)lookahead_pos;
+                mz_uint cur_match_dist = 0, cur_match_len = 1;
+                const mz_uint8 *pCur_dict = d->m_dict + cur_pos;
+                mz_uint32 first_4_bytes = tdefl_read_le32(pCur_dict);
+                mz_uint16 *pBucket = tdefl_fast_bucket(d, first_4_bytes);
+                mz_uint max_len = MZ_MIN(lookahead_size, (mz_uint)TDEFL_MAX_MATCH_LEN);
+                mz_uint way;
 
-                if (((cur_match_dist = (mz_uint16)(lookahead_pos - probe_pos)) <= dict_size) && ((TDEFL_READ_UNALIGNED_WORD32(d->m_dict + (probe_pos &= TDEFL_LZ_DICT_SIZE_MASK)) & 0xFFFFFF) == first_trigram))
+                for (way = 0; way < 2; way++)
                 {
-                    const mz_uint16 *p = (const mz_uint16 *)pCur_dict;
-                    const mz_uint16 *q = (const mz_uint16 *)(d->m_dict + probe_pos);
-                    mz_uint32 probe_len = 32;
-                    do
-                    {
-                    } while ((TDEFL_READ_UNALIGNED_WORD2(++p) == TDEFL_READ_UNALIGNED_WORD2(++q)) && (TDEFL_READ_UNALIGNED_WORD2(++p) == TDEFL_READ_UNALIGNED_WORD2(++q)) &&
-                             (TDEFL_READ_UNALIGNED_WORD2(++p) == TDEFL_READ_UNALIGNED_WORD2(++q)) && (TDEFL_READ_UNALIGNED_WORD2(++p) == TDEFL_READ_UNALIGNED_WORD2(++q)) && (--probe_len > 0));
-                    cur_match_len = ((mz_uint)(p - (const mz_uint16 *)pCur_dict) * 2) + (mz_uint)(*(const mz_uint8 *)p == *(const mz_uint8 *)q);
-                    if (!probe_len)
-                        cur_match_len = cur_match_dist ? TDEFL_MAX_MATCH_LEN : 0;
+                    /* Positions are stored modulo 65536; anything farther back than the dictionary fails the distance check or the byte check. */
+                    mz_uint dist = (mz_uint16)(lookahead_pos - pBucket[way]);
+                    const mz_uint8 *p, *q;
+                    mz_uint len;
+                    if ((dist - 1U) >= dict_size)
+                        continue;
+                    q = d->m_dict + ((lookahead_pos - dist) & TDEFL_LZ_DICT_SIZE_MASK);
+                    if (tdefl_read_le32(q) != first_4_bytes)
+                        continue;
 
-                    if ((cur_match_len < TDEFL_MIN_MATCH_LEN) || ((cur_match_len == TDEFL_MIN_MATCH_LEN) && (cur_match_dist >= 8U * 1024U)))
+                    /* Both sides stay below m_dict + TDEFL_LZ_DICT_SIZE + TDEFL_MAX_MATCH_LEN - 1, the end of the mirrored tail. */
+                    p = pCur_dict + 4;
+                    q += 4;
+                    len = 4;
+                    while (len + 8 <= max_len)
                     {
-                        cur_match_len = 1;
-                        *pLZ_code_buf++ = (mz_uint8)first_trigram;
-                        *pLZ_flags = (mz_uint8)(*pLZ_flags >> 1);
-                        d->m_huff_count[0][(mz_uint8)first_trigram]++;
+                        mz_uint64 diff = tdefl_read_le64(p) ^ tdefl_read_le64(q);
+                        if (diff)
+                        {
+                            len += mz_ctz64(diff) >> 3;
+                            goto match_found;
+                        }
+                        p += 8;
+                        q += 8;
+                        len += 8;
                     }
-                    else
+                    while ((len < max_len) && (*p == *q))
                     {
-                        mz_uint32 s0, s1;
-                        cur_match_len = MZ_MIN(cur_match_len, lookahead_size);
+                        p++;
+                        q++;
+                        len++;
+                    }
+                match_found:
+                    if (len > cur_match_len)
+                    {
+                        cur_match_len = len;
+                        cur_match_dist = dist;
+                    }
+                }
+                /* A 4 byte match at the far end of the window costs about as many bits as its literals. */
+                if ((cur_match_len == 4) && (cur_match_dist > 16384))
+                    cur_match_len = 1;
 
-                        MZ_ASSERT((cur_match_len >= TDEFL_MIN_MATCH_LEN) && (cur_match_dist >= 1) && (cur_match_dist <= TDEFL_LZ_DICT_SIZE));
+                tdefl_fast_insert(pBucket, lookahead_pos);
 
-                        cur_match_dist--;
+                if (cur_match_len < 4)
+                {
+                    cur_match_len = 1;
+                    *pLZ_code_buf++ = (mz_uint8)first_4_bytes;
+                    *pLZ_flags = (mz_uint8)(*pLZ_flags >> 1);
+                    d->m_huff_count[0][(mz_uint8)first_4_bytes]++;
+                }
+                else
+                {
+                    mz_uint32 s0, s1;
+                    MZ_ASSERT((cur_match_len <= lookahead_size) && (cur_match_dist >= 1) && (cur_match_dist <= TDEFL_LZ_DICT_SIZE));
 
-                        pLZ_code_buf[0] = (mz_uint8)(cur_match_len - TDEFL_MIN_MATCH_LEN);
-#ifdef MINIZ_UNALIGNED_USE_MEMCPY
-                        memcpy(&pLZ_code_buf[1], &cur_match_dist, sizeof(cur_match_dist));
-#else
-                        *(mz_uint16 *)(&pLZ_code_buf[1]) = (mz_uint16)cur_match_dist;
-#endif
-                        pLZ_code_buf += 3;
-                        *pLZ_flags = (mz_uint8)((*pLZ_flags >> 1) | 0x80);
+                    cur_match_dist--;
+
+                    pLZ_code_buf[0] = (mz_uint8)(cur_match_len - TDEFL_MIN_MATCH_LEN);
+                    pLZ_code_buf[1] = (mz_uint8)(cur_match_dist & 0xFF);
+                    pLZ_code_buf[2] = (mz_uint8)(cur_match_dist >> 8);
+                    pLZ_code_buf += 3;
+                    *pLZ_flags = (mz_uint8)((*pLZ_flags >> 1) | 0x80);
 
-                        s0 = s_tdefl_small_dist_sym[cur_match_dist & 511];
-                        s1 = s_tdefl_large_dist_sym[cur_match_dist >> 8];
-                        d->m_huff_count[1][(cur_match_dist < 512) ? s0 : s1]++;
+                    s0 = s_tdefl_small_dist_sym[cur_match_dist & 511];
+                    s1 = s_tdefl_large_dist_sym[cur_match_dist >> 8];
+                    d->m_huff_count[1][(cur_match_dist < 512) ? s0 : s1]++;
 
-                        d->m_huff_count[0][s_tdefl_len_sym[cur_match_len - TDEFL_MIN_MATCH_LEN]]++;
+                    d->m_huff_count[0][s_tdefl_len_sym[cur_match_len - TDEFL_MIN_MATCH_LEN]]++;
+
+                    /* Also index a position near the end of the match, so runs of matches can chain from each other. */
+                    if (lookahead_size - cur_match_len >= 2)
+                    {
+                        mz_uint ins_pos = lookahead_pos + cur_match_len - 2;
+                        tdefl_fast_insert(tdefl_fast_bucket(d, tdefl_read_le32(d->m_dict + (ins_pos & TDEFL_LZ_DICT_SIZE_MASK))), ins_pos);
                     }
                 }
-                else
-                {
-                    *pLZ_code_buf++ = (mz_uint8)first_trigram;
-                    *pLZ_flags = (mz_uint8)(*pLZ_flags >> 1);
-                    d->m_huff_count[0][(mz_uint8)first_trigram]++;
-                }
 
                 if (--num_flags_left == 0)
                 {
@@ -1652,7 +2297,7 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
                 }
             }
 
-            while (lookahead_size)
+            while ((lookahead_size) && (min_lookahead < TDEFL_MAX_MATCH_LEN))
             {
                 mz_uint8 lit = d->m_dict[cur_pos];
 
@@ -1701,7 +2346,7 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
         d->m_num_flags_left = num_flags_left;
         return MZ_TRUE;
     }
-#endif /* MINIZ_USE_UNALIGNED_LOADS_AND_STORES && MINIZ_LITTLE_ENDIAN */
+#endif /* TDEFL_USE_FAST_MATCHER */
 
     static MZ_FORCEINLINE void tdefl_record_literal(tdefl_compressor *d, mz_uint8 lit)
     {
@@ -1910,6 +2555,16 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
         return (d->m_finished && !d->m_output_flush_remaining) ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY;
     }
 
+#if TDEFL_USE_FAST_MATCHER
+    /* Level 1 greedy parsing without match filters runs tdefl_compress_fast(), which keeps its own m_hash layout. */
+    static MZ_FORCEINLINE mz_bool tdefl_uses_fast_matcher(const tdefl_compressor *d)
+    {
+        return ((d->m_flags & TDEFL_MAX_PROBES_MASK) == 1) &&
+               ((d->m_flags & TDEFL_GREEDY_PARSING_FLAG) != 0) &&
+               ((d->m_flags & (TDEFL_FILTER_MATCHES | TDEFL_FORCE_ALL_RAW_BLOCKS | TDEFL_RLE_MATCHES)) == 0);
+    }
+#endif /* #if TDEFL_USE_FAST_MATCHER */
+
     tdefl_status tdefl_compress(tdefl_compressor *d, const void *pIn_buf, size_t *pIn_buf_size, void *pOut_buf, size_t *pOut_buf_size, tdefl_flush flush)
     {
         if (!d)
@@ -1944,16 +2599,14 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
         if ((d->m_output_flush_remaining) || (d->m_finished))
             return (d->m_prev_return_status = tdefl_flush_output_buffer(d));
 
-#if MINIZ_USE_UNALIGNED_LOADS_AND_STORES && MINIZ_LITTLE_ENDIAN
-        if (((d->m_flags & TDEFL_MAX_PROBES_MASK) == 1) &&
-            ((d->m_flags & TDEFL_GREEDY_PARSING_FLAG) != 0) &&
-            ((d->m_flags & (TDEFL_FILTER_MATCHES | TDEFL_FORCE_ALL_RAW_BLOCKS | TDEFL_RLE_MATCHES)) == 0))
+#if TDEFL_USE_FAST_MATCHER
+        if (tdefl_uses_fast_matcher(d))
         {
             if (!tdefl_compress_fast(d))
                 return d->m_prev_return_status;
         }
         else
-#endif /* #if MINIZ_USE_UNALIGNED_LOADS_AND_STORES && MINIZ_LITTLE_ENDIAN */
+#endif /* #if TDEFL_USE_FAST_MATCHER */
         {
             if (!tdefl_compress_normal(d))
                 return d->m_prev_return_status;
@@ -2020,6 +2673,48 @@ static MZ_FORCEINLINE void tdefl_find_match(tdefl_compressor *d, mz_uint lookahe
         return TDEFL_STATUS_OKAY;
     }
 
+    tdefl_status tdefl_set_dictionary(tdefl_compressor *d, const void *pDict, size_t dict_size)
+    {
+        const mz_uint8 *pSrc = (const mz_uint8 *)pDict;
+        mz_uint n, pos;
+
+        if ((!d) || ((!pDict) && (dict_size)) || (d->m_lookahead_pos) || (d->m_lookahead_size) || (d->m_block_index) || (d->m_prev_return_status != TDEFL_STATUS_OKAY))
+            return TDEFL_STATUS_BAD_PARAM;
+
+        /* Only the last window's worth of the dictionary is reachable. */
+        if (dict_size > TDEFL_LZ_DICT_SIZE)
+        {
+            pSrc += dict_size - TDEFL_LZ_DICT_SIZE;
+            dict_size = TDEFL_LZ_DICT_SIZE;
+        }
+        n = (mz_uint)dict_size;
+        memcpy(d->m_dict, pSrc, n);
+        memcpy(d->m_dict + TDEFL_LZ_DICT_SIZE, pSrc, MZ_MIN(n, (mz_uint)(TDEFL_MAX_MATCH_LEN - 1)));
+
+        /* Index the dictionary the way the matcher in use would have while compressing it. The last 2-3 positions need */
+        /* bytes that aren't known yet; the matchers insert them themselves once the first input bytes arrive. */
+#if TDEFL_USE_FAST_MATCHER
+        if (tdefl_uses_fast_matcher(d))
+        {
+            for (pos = 0; pos + 4 <= n; pos++)
+                tdefl_fast_insert(tdefl_fast_bucket(d, tdefl_read_le32(d->m_dict + pos)), pos);
+        }
+        else
+#endif /* #if TDEFL_USE_FAST_MATCHER */
+        {
+            for (pos = 0; pos + 3 <= n; pos++)
+            {
+                mz_uint hash = ((pSrc[pos] << (TDEFL_LZ_HASH_SHIFT * 2)) ^ (pSrc[pos + 1] << TDEFL_LZ_HASH_SHIFT) ^ pSrc[pos + 2]) & (TDEFL_LZ_HASH_SIZE - 1);
+                d->m_next[pos] = d->m_hash[hash];
+                d->m_hash[hash] = (mz_uint16)pos;
+            }
+        }
+
+        /* The dictionary counts as already emitted: matches may reach back into it, raw blocks start after it. */
+        d->m_lookahead_pos = d->m_dict_size = d->m_lz_code_buf_dict_pos = n;
+        return TDEFL_STATUS_OKAY;
+    }
+
     tdefl_status tdefl_get_prev_return_status(tdefl_compressor *d)
     {
         return d->m_prev_return_status;
@@ -2378,45 +3073,337 @@ extern "C"
         num_bits += 8;                                               \
     } while (num_bits < 15);
 
-/* TINFL_HUFF_DECODE() decodes the next Huffman coded symbol. It's more complex than you would initially expect because the zlib API expects the decompressor to never read */
-/* beyond the final byte of the deflate stream. (In other words, when this macro wants to read another byte from the input, it REALLY needs another byte in order to fully */
-/* decode the next Huffman code.) Handling this properly is particularly important on raw deflate (non-zlib) streams, which aren't followed by a byte aligned adler-32. */
-/* The slow path is only executed at the very end of the input buffer. */
-/* v1.16: The original macro handled the case at the very end of the passed-in input buffer, but we also need to handle the case where the user passes in 1+zillion bytes */
-/* following the deflate data and our non-conservative read-ahead path won't kick in here on this code. This is much trickier. */
-#define TINFL_HUFF_DECODE(state_index, sym, pLookUp, pTree)                                                                         \
-    do                                                                                                                              \
-    {                                                                                                                               \
-        int temp;                                                                                                                   \
-        mz_uint code_len, c;                                                                                                        \
-        if (num_bits < 15)                                                                                                          \
-        {                                                                                                                           \
-            if ((pIn_buf_end - pIn_buf_cur) < 2)                                                                                    \
-            {                                                                                                                       \
-                TINFL_HUFF_BITBUF_FILL(state_index, pLookUp, pTree);                                                                \
-            }                                                                                                                       \
-            else                                                                                                                    \
-            {                                                                                                                       \
-                bit_buf |= (((tinfl_bit_buf_t)pIn_buf_cur[0]) << num_bits) | (((tinfl_bit_buf_t)pIn_buf_cur[1]) << (num_bits + 8)); \
-                pIn_buf_cur += 2;                                                                                                   \
-                num_bits += 16;                                                                                                     \
-            }                                                                                                                       \
-        }                                                                                                                           \
-        if ((temp = pLookUp[bit_buf & (TINFL_FAST_LOOKUP_SIZE - 1)]) >= 0)                                                          \
-            code_len = temp >> 9, temp &= 511;                                                                                      \
-        else                                                                                                                        \
-        {                                                                                                                           \
-            code_len = TINFL_FAST_LOOKUP_BITS;                                                                                      \
-            do                                                                                                                      \
-            {                                                                                                                       \
-                temp = pTree[~temp + ((bit_buf >> code_len++) & 1)];                                                                \
-            } while (temp < 0);                                                                                                     \
-        }                                                                                                                           \
-        sym = temp;                                                                                                                 \
-        bit_buf >>= code_len;                                                                                                       \
-        num_bits -= code_len;                                                                                                       \
-    }                                                                                                                               \
-    MZ_MACRO_END
+/* TINFL_HUFF_DECODE() decodes the next Huffman coded symbol. It's more complex than you would initially expect because the zlib API expects the decompressor to never read */
+/* beyond the final byte of the deflate stream. (In other words, when this macro wants to read another byte from the input, it REALLY needs another byte in order to fully */
+/* decode the next Huffman code.) Handling this properly is particularly important on raw deflate (non-zlib) streams, which aren't followed by a byte aligned adler-32. */
+/* The slow path is only executed at the very end of the input buffer. */
+/* v1.16: The original macro handled the case at the very end of the passed-in input buffer, but we also need to handle the case where the user passes in 1+zillion bytes */
+/* following the deflate data and our non-conservative read-ahead path won't kick in here on this code. This is much trickier. */
+#define TINFL_HUFF_DECODE(state_index, sym, pLookUp, pTree)                                                                         \
+    do                                                                                                                              \
+    {                                                                                                                               \
+        int temp;                                                                                                                   \
+        mz_uint code_len, c;                                                                                                        \
+        if (num_bits < 15)                                                                                                          \
+        {                                                                                                                           \
+            if ((pIn_buf_end - pIn_buf_cur) < 2)                                                                                    \
+            {                                                                                                                       \
+                TINFL_HUFF_BITBUF_FILL(state_index, pLookUp, pTree);                                                                \
+            }                                                                                                                       \
+            else                                                                                                                    \
+            {                                                                                                                       \
+                bit_buf |= (((tinfl_bit_buf_t)pIn_buf_cur[0]) << num_bits) | (((tinfl_bit_buf_t)pIn_buf_cur[1]) << (num_bits + 8)); \
+                pIn_buf_cur += 2;                                                                                                   \
+                num_bits += 16;                                                                                                     \
+            }                                                                                                                       \
+        }                                                                                                                           \
+        if ((temp = pLookUp[bit_buf & (TINFL_FAST_LOOKUP_SIZE - 1)]) >= 0)                                                          \
+            code_len = temp >> 9, temp &= 511;                                                                                      \
+        else                                                                                                                        \
+        {                                                                                                                           \
+            code_len = TINFL_FAST_LOOKUP_BITS;                                                                                      \
+            do                                                                                                                      \
+            {                                                                                                                       \
+                temp = pTree[~temp + ((bit_buf >> code_len++) & 1)];                                                                \
+            } while (temp < 0);                                                                                                     \
+        }                                                                                                                           \
+        sym = temp;                                                                                                                 \
+        bit_buf >>= code_len;                                                                                                       \
+        num_bits -= code_len;                                                                                                       \
+    }                                                                                                                               \
+    MZ_MACRO_END
+
+    static const mz_uint16 s_length_base[31] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 0, 0 };
+    static const mz_uint8 s_length_extra[31] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0, 0, 0 };
+    static const mz_uint16 s_dist_base[32] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 0, 0 };
+    static const mz_uint8 s_dist_extra[32] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+#if TINFL_USE_FAST_LOOP && TINFL_USE_64BIT_BITBUF
+/* Fast loop table entries: bits 0-3 code length, bits 4-7 number of extra bits, bits 8-9 entry kind, bits 16-31 literal, length base or distance base. */
+/* A zero entry means the code is longer than the table index; the fast loop then walks m_look_up/m_tree exactly like TINFL_HUFF_DECODE(). */
+#define TINFL_FAST_LITERAL 0x100
+#define TINFL_FAST_LENGTH 0x200
+#define TINFL_FAST_END_OF_BLOCK 0x300
+#define TINFL_FAST_KIND_MASK 0x300
+#define TINFL_FAST_DISTANCE 0x100
+
+/* The fast loop runs while one unaligned 8-byte refill is in bounds and a full match plus a 16-byte copy overrun fits in the output. */
+#define TINFL_FAST_IN_MARGIN 8
+#define TINFL_FAST_OUT_MARGIN (258 + 16)
+
+    static MZ_FORCEINLINE mz_uint64 tinfl_read_le64(const mz_uint8 *p)
+    {
+#if MINIZ_LITTLE_ENDIAN
+        mz_uint64 v;
+        TINFL_MEMCPY(&v, p, sizeof(v));
+        return v;
+#else
+        return MZ_READ_LE64(p);
+#endif
+    }
+
+    /* Both copies load before they store, so they are also correct when the source is a few bytes ahead of the destination (wrapped dictionary). */
+    static MZ_FORCEINLINE void tinfl_copy8(mz_uint8 *pDst, const mz_uint8 *pSrc)
+    {
+        mz_uint64 v;
+        TINFL_MEMCPY(&v, pSrc, sizeof(v));
+        TINFL_MEMCPY(pDst, &v, sizeof(v));
+    }
+
+    static MZ_FORCEINLINE void tinfl_copy16(mz_uint8 *pDst, const mz_uint8 *pSrc)
+    {
+        mz_uint64 v0, v1;
+        TINFL_MEMCPY(&v0, pSrc, sizeof(v0));
+        TINFL_MEMCPY(&v1, pSrc + 8, sizeof(v1));
+        TINFL_MEMCPY(pDst, &v0, sizeof(v0));
+        TINFL_MEMCPY(pDst + 8, &v1, sizeof(v1));
+    }
+
+    /* Derives the fast loop tables from the reference tables, so both loops decode identical symbols even for incomplete codes. */
+    static void tinfl_build_fast_tables(tinfl_decompressor *r)
+    {
+        mz_uint i;
+        for (i = 0; i < TINFL_FAST_LITLEN_SIZE; ++i)
+        {
+            int sym = r->m_look_up[0][i & (TINFL_FAST_LOOKUP_SIZE - 1)];
+            mz_uint code_len;
+            if (sym >= 0)
+                code_len = sym >> 9, sym &= 511;
+            else
+            {
+                /* One tree step resolves the 11-bit codes, longer ones keep the tree walk */
+                sym = r->m_tree_0[~sym + ((i >> TINFL_FAST_LOOKUP_BITS) & 1)];
+                code_len = TINFL_FAST_LOOKUP_BITS + 1;
+                if (sym < 0)
+                {
+                    r->m_fast_litlen[i] = 0;
+                    continue;
+                }
+            }
+            if (sym < 256)
+                r->m_fast_litlen[i] = ((mz_uint32)sym << 16) | TINFL_FAST_LITERAL | code_len;
+            else if (sym == 256)
+                r->m_fast_litlen[i] = TINFL_FAST_END_OF_BLOCK | code_len;
+            else
+                r->m_fast_litlen[i] = ((mz_uint32)s_length_base[sym - 257] << 16) | TINFL_FAST_LENGTH | ((mz_uint32)s_length_extra[sym - 257] << 4) | code_len;
+        }
+        for (i = 0; i < TINFL_FAST_LOOKUP_SIZE; ++i)
+        {
+            int sym = r->m_look_up[1][i];
+            if (sym < 0)
+                r->m_fast_dist[i] = 0;
+            else
+                r->m_fast_dist[i] = ((mz_uint32)s_dist_base[sym & 511] << 16) | TINFL_FAST_DISTANCE | ((mz_uint32)s_dist_extra[sym & 511] << 4) | (sym >> 9);
+        }
+    }
+
+    /* Decodes literals and matches of the current block until the input or output margin runs out. */
+    /* Returns 1 at the end of the block, -1 on an invalid distance and 0 when the reference loop has to take over. */
+    /* The caller guarantees at least TINFL_FAST_IN_MARGIN input bytes and TINFL_FAST_OUT_MARGIN output bytes on entry. */
+    static int tinfl_decode_fast(tinfl_decompressor *r, const mz_uint8 **ppIn_buf_cur, const mz_uint8 *pIn_buf_end, mz_uint8 *pOut_buf_start, mz_uint8 **ppOut_buf_cur, mz_uint8 *pOut_buf_end,
+                                 size_t out_buf_size_mask, tinfl_bit_buf_t *pBit_buf, mz_uint32 *pNum_bits, const mz_uint32 decomp_flags)
+    {
+        const mz_uint8 *pIn = *ppIn_buf_cur, *const pIn_last = pIn_buf_end - TINFL_FAST_IN_MARGIN;
+        mz_uint8 *pOut = *ppOut_buf_cur, *const pOut_last = pOut_buf_end - TINFL_FAST_OUT_MARGIN;
+        tinfl_bit_buf_t bit_buf = *pBit_buf;
+        mz_uint32 num_bits = *pNum_bits;
+        const mz_uint32 non_wrapping = decomp_flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF;
+        /* Writing up to 15 bytes past a match is harmless if those bytes are not history yet: always true for a non-wrapping buffer, */
+        /* and true for a wrapping buffer of at least twice the window, where they sit more than TINFL_LZ_DICT_SIZE bytes back. */
+        /* (Only the invalid distance 0 of a corrupt stream reaches that far; it yields stale buffer bytes with either loop.) */
+        const int allow_overrun = out_buf_size_mask >= (2 * TINFL_LZ_DICT_SIZE - 1);
+        int result = 0;
+
+        while ((pIn <= pIn_last) && (pOut <= pOut_last))
+        {
+            mz_uint32 entry, code_len, length, dist;
+            size_t dist_from_out_buf_start;
+            const mz_uint8 *pSrc;
+
+            /* Refill once per symbol: at least 56 bits afterwards, enough for a length and a distance with all their extra bits. */
+            /* Bits above num_bits are the not yet consumed low bits of *pIn, so OR-ing the next refill over them is harmless. */
+            bit_buf |= tinfl_read_le64(pIn) << num_bits;
+            pIn += (63 - num_bits) >> 3;
+            num_bits |= 56;
+
+            entry = r->m_fast_litlen[bit_buf & (TINFL_FAST_LITLEN_SIZE - 1)];
+            if ((entry & TINFL_FAST_KIND_MASK) == TINFL_FAST_LITERAL)
+            {
+                code_len = entry & 15;
+                bit_buf >>= code_len;
+                num_bits -= code_len;
+                *pOut++ = (mz_uint8)(entry >> 16);
+
+                /* A second literal still fits in the same refill */
+                entry = r->m_fast_litlen[bit_buf & (TINFL_FAST_LITLEN_SIZE - 1)];
+                if ((entry & TINFL_FAST_KIND_MASK) != TINFL_FAST_LITERAL)
+                    continue;
+                code_len = entry & 15;
+                bit_buf >>= code_len;
+                num_bits -= code_len;
+                *pOut++ = (mz_uint8)(entry >> 16);
+                continue;
+            }
+
+            if ((entry & TINFL_FAST_KIND_MASK) == TINFL_FAST_LENGTH)
+            {
+                code_len = entry & 15;
+                length = (entry >> 16) + (mz_uint32)((bit_buf >> code_len) & ((1U << ((entry >> 4) & 15)) - 1));
+                code_len += (entry >> 4) & 15;
+            }
+            else if ((entry & TINFL_FAST_KIND_MASK) == TINFL_FAST_END_OF_BLOCK)
+            {
+                code_len = entry & 15;
+                bit_buf >>= code_len;
+                num_bits -= code_len;
+                result = 1;
+                break;
+            }
+            else
+            {
+                int sym = r->m_look_up[0][bit_buf & (TINFL_FAST_LOOKUP_SIZE - 1)];
+                code_len = TINFL_FAST_LOOKUP_BITS;
+                do
+                {
+                    sym = r->m_tree_0[~sym + ((bit_buf >> code_len++) & 1)];
+                } while (sym < 0);
+                if (sym < 256)
+                {
+                    bit_buf >>= code_len;
+                    num_bits -= code_len;
+                    *pOut++ = (mz_uint8)sym;
+                    continue;
+                }
+                if (sym == 256)
+                {
+                    bit_buf >>= code_len;
+                    num_bits -= code_len;
+                    result = 1;
+                    break;
+                }
+                length = s_length_base[sym - 257] + (mz_uint32)((bit_buf >> code_len) & ((1U << s_length_extra[sym - 257]) - 1));
+                code_len += s_length_extra[sym - 257];
+            }
+            bit_buf >>= code_len;
+            num_bits -= code_len;
+
+            entry = r->m_fast_dist[bit_buf & (TINFL_FAST_LOOKUP_SIZE - 1)];
+            if (entry)
+            {
+                code_len = entry & 15;
+                dist = (entry >> 16) + (mz_uint32)((bit_buf >> code_len) & ((1U << ((entry >> 4) & 15)) - 1));
+                code_len += (entry >> 4) & 15;
+            }
+            else
+            {
+                int sym = r->m_look_up[1][bit_buf & (TINFL_FAST_LOOKUP_SIZE - 1)];
+                code_len = TINFL_FAST_LOOKUP_BITS;
+                do
+                {
+                    sym = r->m_tree_1[~sym + ((bit_buf >> code_len++) & 1)];
+                } while (sym < 0);
+                dist = s_dist_base[sym] + (mz_uint32)((bit_buf >> code_len) & ((1U << s_dist_extra[sym]) - 1));
+                code_len += s_dist_extra[sym];
+            }
+            bit_buf >>= code_len;
+            num_bits -= code_len;
+
+            dist_from_out_buf_start = pOut - pOut_buf_start;
+            if ((dist == 0 || dist > dist_from_out_buf_start || dist_from_out_buf_start == 0) && non_wrapping)
+            {
+                result = -1;
+                break;
+            }
+
+            pSrc = pOut_buf_start + ((dist_from_out_buf_start - dist) & out_buf_size_mask);
+            if ((MZ_MAX(pOut, pSrc) + length) > pOut_buf_end)
+            {
+                /* The source wraps around the dictionary end */
+                while (length--)
+                    *pOut++ = pOut_buf_start[(dist_from_out_buf_start++ - dist) & out_buf_size_mask];
+            }
+            else if ((pSrc < pOut) && ((size_t)(pOut - pSrc) < 8))
+            {
+                /* Short overlapping distance: runs repeat the previous 1..7 bytes */
+                if (pOut - pSrc == 1)
+                {
+                    TINFL_MEMSET(pOut, *pSrc, length);
+                    pOut += length;
+                }
+                else
+                {
+                    while (length--)
+                        *pOut++ = *pSrc++;
+                }
+            }
+            else if (allow_overrun && (pSrc < pOut))
+            {
+                /* Copy whole words and let the last one spill over; source and destination both stay below pOut_buf_end thanks to the output margin */
+                mz_uint8 *pMatch_end = pOut + length;
+                if ((size_t)(pOut - pSrc) >= 16)
+                {
+                    /* Short matches stay inline; longer ones go to the vector copy kernel */
+                    if (length <= 32)
+                    {
+                        tinfl_copy16(pOut, pSrc);
+                        if (length > 16)
+                            tinfl_copy16(pOut + 16, pSrc + 16);
+                    }
+                    else
+                        MZ_KERNEL_LOAD(g_mz_inflate_copy)(pOut, pSrc, length);
+                }
+                else
+                {
+                    do
+                    {
+                        tinfl_copy8(pOut, pSrc);
+                        pOut += 8;
+                        pSrc += 8;
+                    } while (pOut < pMatch_end);
+                }
+                pOut = pMatch_end;
+            }
+            else if (length >= 8)
+            {
+                /* In a 32KB wrapping dictionary the bytes after the match are still needed history: copy exactly, */
+                /* finishing with a word that overlaps the previous one (only valid when the source is behind) */
+                mz_uint8 *pMatch_end = pOut + length;
+                for (; length >= 8; length -= 8, pOut += 8, pSrc += 8)
+                    tinfl_copy8(pOut, pSrc);
+                if (length && (pSrc < pOut))
+                    tinfl_copy8(pMatch_end - 8, pSrc + length - 8);
+                else
+                {
+                    while (length--)
+                        *pOut++ = *pSrc++;
+                }
+                pOut = pMatch_end;
+            }
+            else if (length >= 4)
+            {
+                /* Head and tail words overlap; both are loaded before either is stored */
+                mz_uint32 head, tail;
+                TINFL_MEMCPY(&head, pSrc, sizeof(head));
+                TINFL_MEMCPY(&tail, pSrc + length - 4, sizeof(tail));
+                TINFL_MEMCPY(pOut, &head, sizeof(head));
+                TINFL_MEMCPY(pOut + length - 4, &tail, sizeof(tail));
+                pOut += length;
+            }
+            else
+            {
+                while (length--)
+                    *pOut++ = *pSrc++;
+            }
+        }
+
+        *ppIn_buf_cur = pIn;
+        *ppOut_buf_cur = pOut;
+        /* The reference loop expects no stale bits above num_bits */
+        *pBit_buf = bit_buf & ((((tinfl_bit_buf_t)1) << num_bits) - 1);
+        *pNum_bits = num_bits;
+        return result;
+    }
+#endif
 
     static void tinfl_clear_tree(tinfl_decompressor *r)
     {
@@ -2430,10 +3417,6 @@ extern "C"
 
     tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size, mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size, const mz_uint32 decomp_flags)
     {
-        static const mz_uint16 s_length_base[31] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 0, 0 };
-        static const mz_uint8 s_length_extra[31] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0, 0, 0 };
-        static const mz_uint16 s_dist_base[32] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 0, 0 };
-        static const mz_uint8 s_dist_extra[32] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
         static const mz_uint8 s_length_dezigzag[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
         static const mz_uint16 s_min_table_sizes[3] = { 257, 1, 4 };
 
@@ -2663,9 +3646,24 @@ extern "C"
                         TINFL_MEMCPY(r->m_code_size_1, r->m_len_codes + r->m_table_sizes[0], r->m_table_sizes[1]);
                     }
                 }
+#if TINFL_USE_FAST_LOOP && TINFL_USE_64BIT_BITBUF
+                tinfl_build_fast_tables(r);
+#endif
                 for (;;)
                 {
                     mz_uint8 *pSrc;
+#if TINFL_USE_FAST_LOOP && TINFL_USE_64BIT_BITBUF
+                    if (!(decomp_flags & TINFL_FLAG_DISABLE_FAST_LOOP) && ((pIn_buf_end - pIn_buf_cur) >= TINFL_FAST_IN_MARGIN) && ((pOut_buf_end - pOut_buf_cur) >= TINFL_FAST_OUT_MARGIN))
+                    {
+                        int fast_result = tinfl_decode_fast(r, &pIn_buf_cur, pIn_buf_end, pOut_buf_start, &pOut_buf_cur, pOut_buf_end, out_buf_size_mask, &bit_buf, &num_bits, decomp_flags);
+                        if (fast_result > 0)
+                            break;
+                        if (fast_result < 0)
+                        {
+                            TINFL_CR_RETURN_FOREVER(54, TINFL_STATUS_FAILED);
+                        }
+                    }
+#endif
                     for (;;)
                     {
                         if (((pIn_buf_end - pIn_buf_cur) < 4) || ((pOut_buf_end - pOut_buf_cur) < 2))
@@ -2884,30 +3882,7 @@ extern "C"
         *pOut_buf_size = pOut_buf_cur - pOut_buf_next;
         if ((decomp_flags & (TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32)) && (status >= 0))
         {
-            const mz_uint8 *ptr = pOut_buf_next;
-            size_t buf_len = *pOut_buf_size;
-            mz_uint32 i, s1 = r->m_check_adler32 & 0xffff, s2 = r->m_check_adler32 >> 16;
-            size_t block_len = buf_len % 5552;
-            while (buf_len)
-            {
-                for (i = 0; i + 7 < block_len; i += 8, ptr += 8)
-                {
-                    s1 += ptr[0], s2 += s1;
-                    s1 += ptr[1], s2 += s1;
-                    s1 += ptr[2], s2 += s1;
-                    s1 += ptr[3], s2 += s1;
-                    s1 += ptr[4], s2 += s1;
-                    s1 += ptr[5], s2 += s1;
-                    s1 += ptr[6], s2 += s1;
-                    s1 += ptr[7], s2 += s1;
-                }
-                for (; i < block_len; ++i)
-                    s1 += *ptr++, s2 += s1;
-                s1 %= 65521U, s2 %= 65521U;
-                buf_len -= block_len;
-                block_len = 5552;
-            }
-            r->m_check_adler32 = (s2 << 16) + s1;
+            r->m_check_adler32 = MZ_KERNEL_LOAD(g_mz_adler32)(r->m_check_adler32, pOut_buf_next, *pOut_buf_size);
             if ((status == TINFL_STATUS_DONE) && (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) && (r->m_check_adler32 != r->m_z_adler32))
                 status = TINFL_STATUS_ADLER32_MISMATCH;
         }
@@ -3344,6 +4319,9 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         void *m_pMem;
         size_t m_mem_size;
         size_t m_mem_capacity;
+
+        /* Preset dictionary for MZ_DEFLATED_PRESET_DICT entries: set by the writer, loaded lazily from MZ_ZIP_PRESET_DICT_NAME by the reader. */
+        mz_zip_array m_preset_dict;
     };
 
 #define MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(array_ptr, element_size) (array_ptr)->m_element_size = element_size
@@ -3500,6 +4478,20 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         return MZ_FALSE;
     }
 
+    static MZ_FORCEINLINE size_t mz_zip_io_buf_size(const mz_zip_archive *pZip)
+    {
+        return pZip->m_io_buf_size ? pZip->m_io_buf_size : (size_t)MZ_ZIP_MAX_IO_BUF_SIZE;
+    }
+
+#ifndef MINIZ_NO_STDIO
+    /* Gives a file miniz opened a stdio buffer of m_io_buf_size bytes, so small reads and writes reach the OS in large chunks. */
+    static void mz_zip_set_file_buffer(const mz_zip_archive *pZip, MZ_FILE *pFile)
+    {
+        if (pZip->m_io_buf_size)
+            setvbuf(pFile, NULL, _IOFBF, pZip->m_io_buf_size);
+    }
+#endif
+
     static mz_bool mz_zip_reader_init_internal(mz_zip_archive *pZip, mz_uint flags)
     {
         (void)flags;
@@ -3525,6 +4517,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pZip->m_pState->m_central_dir, sizeof(mz_uint8));
         MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pZip->m_pState->m_central_dir_offsets, sizeof(mz_uint32));
         MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pZip->m_pState->m_sorted_central_dir_offsets, sizeof(mz_uint32));
+        MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pZip->m_pState->m_preset_dict, sizeof(mz_uint8));
         pZip->m_pState->m_init_flags = flags;
         pZip->m_pState->m_zip64 = MZ_FALSE;
         pZip->m_pState->m_zip64_has_extended_info_fields = MZ_FALSE;
@@ -3683,7 +4676,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
 
         mz_uint32 buf_u32[4096 / sizeof(mz_uint32)];
         mz_uint8 *pBuf = (mz_uint8 *)buf_u32;
-        mz_bool sort_central_dir = ((flags & MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY) == 0);
+        mz_bool sort_central_dir = ((flags & (MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY | MZ_ZIP_FLAG_DEFER_SORT_CENTRAL_DIRECTORY)) == 0);
         mz_uint32 zip64_end_of_central_dir_locator_u32[(MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE + sizeof(mz_uint32) - 1) / sizeof(mz_uint32)];
         mz_uint8 *pZip64_locator = (mz_uint8 *)zip64_end_of_central_dir_locator_u32;
 
@@ -3999,6 +4992,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             mz_zip_array_clear(pZip, &pState->m_central_dir);
             mz_zip_array_clear(pZip, &pState->m_central_dir_offsets);
             mz_zip_array_clear(pZip, &pState->m_sorted_central_dir_offsets);
+            mz_zip_array_clear(pZip, &pState->m_preset_dict);
 
 #ifndef MINIZ_NO_STDIO
             if (pState->m_pFile)
@@ -4119,6 +5113,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         pFile = MZ_FOPEN(pFilename, (flags & MZ_ZIP_FLAG_READ_ALLOW_WRITING ) ? "r+b" : "rb");
         if (!pFile)
             return mz_zip_set_error(pZip, MZ_ZIP_FILE_OPEN_FAILED);
+        mz_zip_set_file_buffer(pZip, pFile);
 
         file_size = archive_size;
         if (!file_size)
@@ -4240,7 +5235,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         method = MZ_READ_LE16(p + MZ_ZIP_CDH_METHOD_OFS);
         bit_flag = MZ_READ_LE16(p + MZ_ZIP_CDH_BIT_FLAG_OFS);
 
-        if ((method != 0) && (method != MZ_DEFLATED))
+        if ((method != 0) && (method != MZ_DEFLATED) && (method != MZ_DEFLATED_PRESET_DICT))
         {
             mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_METHOD);
             return MZ_FALSE;
@@ -4504,9 +5499,19 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         /* See if we can use a binary search */
         if (((pZip->m_pState->m_init_flags & MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY) == 0) &&
             (pZip->m_zip_mode == MZ_ZIP_MODE_READING) &&
-            ((flags & (MZ_ZIP_FLAG_IGNORE_PATH | MZ_ZIP_FLAG_CASE_SENSITIVE)) == 0) && (!pComment) && (pZip->m_pState->m_sorted_central_dir_offsets.m_size))
+            ((flags & (MZ_ZIP_FLAG_IGNORE_PATH | MZ_ZIP_FLAG_CASE_SENSITIVE)) == 0) && (!pComment))
         {
-            return mz_zip_locate_file_binary_search(pZip, pName, pIndex);
+            /* Build the deferred sorted index on the first lookup that can use it. If the allocation fails fall back to a linear scan. */
+            if ((pZip->m_pState->m_init_flags & MZ_ZIP_FLAG_DEFER_SORT_CENTRAL_DIRECTORY) && (!pZip->m_pState->m_sorted_central_dir_offsets.m_size) && (pZip->m_total_files) &&
+                (mz_zip_array_resize(pZip, &pZip->m_pState->m_sorted_central_dir_offsets, pZip->m_total_files, MZ_FALSE)))
+            {
+                for (file_index = 0; file_index < pZip->m_total_files; file_index++)
+                    MZ_ZIP_ARRAY_ELEMENT(&pZip->m_pState->m_sorted_central_dir_offsets, mz_uint32, file_index) = file_index;
+                mz_zip_reader_sort_central_dir_offsets_by_filename(pZip);
+            }
+
+            if (pZip->m_pState->m_sorted_central_dir_offsets.m_size)
+                return mz_zip_locate_file_binary_search(pZip, pName, pIndex);
         }
 
         /* Locate the entry by scanning the entire central directory */
@@ -4555,12 +5560,16 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         return mz_zip_set_error(pZip, MZ_ZIP_FILE_NOT_FOUND);
     }
 
+    static mz_bool mz_zip_reader_load_preset_dict(mz_zip_archive *pZip);
+
     static mz_bool mz_zip_reader_extract_to_mem_no_alloc1(mz_zip_archive *pZip, mz_uint file_index, void *pBuf, size_t buf_size, mz_uint flags, void *pUser_read_buf, size_t user_read_buf_size, const mz_zip_archive_file_stat *st)
     {
         int status = TINFL_STATUS_DONE;
         mz_uint64 needed_size, cur_file_ofs, comp_remaining, out_buf_ofs = 0, read_buf_size, read_buf_ofs = 0, read_buf_avail;
         mz_zip_archive_file_stat file_stat;
         void *pRead_buf;
+        mz_uint8 *pOut_buf = (mz_uint8 *)pBuf;
+        size_t dict_size = 0;
         mz_uint32 local_header_u32[(MZ_ZIP_LOCAL_DIR_HEADER_SIZE + sizeof(mz_uint32) - 1) / sizeof(mz_uint32)];
         mz_uint8 *pLocal_header = (mz_uint8 *)local_header_u32;
         tinfl_decompressor inflator;
@@ -4583,8 +5592,8 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         if (file_stat.m_bit_flag & (MZ_ZIP_GENERAL_PURPOSE_BIT_FLAG_IS_ENCRYPTED | MZ_ZIP_GENERAL_PURPOSE_BIT_FLAG_USES_STRONG_ENCRYPTION | MZ_ZIP_GENERAL_PURPOSE_BIT_FLAG_COMPRESSED_PATCH_FLAG))
             return mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_ENCRYPTION);
 
-        /* This function only supports decompressing stored and deflate. */
-        if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED))
+        /* This function only supports decompressing stored and deflate (optionally primed with the archive's preset dictionary). */
+        if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED) && (file_stat.m_method != MZ_DEFLATED_PRESET_DICT))
             return mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_METHOD);
 
         /* Ensure supplied output buffer is large enough. */
@@ -4621,6 +5630,15 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             return MZ_TRUE;
         }
 
+        if (file_stat.m_method == MZ_DEFLATED_PRESET_DICT)
+        {
+            if (!mz_zip_reader_load_preset_dict(pZip))
+                return MZ_FALSE;
+            dict_size = pZip->m_pState->m_preset_dict.m_size;
+            if (((sizeof(size_t) == sizeof(mz_uint32))) && (file_stat.m_uncomp_size > 0x7FFFFFFF - dict_size))
+                return mz_zip_set_error(pZip, MZ_ZIP_INTERNAL_ERROR);
+        }
+
         /* Decompress the file either directly from memory or from a file input buffer. */
         tinfl_init(&inflator);
 
@@ -4644,7 +5662,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         else
         {
             /* Temporarily allocate a read buffer. */
-            read_buf_size = MZ_MIN(file_stat.m_comp_size, (mz_uint64)MZ_ZIP_MAX_IO_BUF_SIZE);
+            read_buf_size = MZ_MIN(file_stat.m_comp_size, (mz_uint64)mz_zip_io_buf_size(pZip));
             if (((sizeof(size_t) == sizeof(mz_uint32))) && (read_buf_size > 0x7FFFFFFF))
                 return mz_zip_set_error(pZip, MZ_ZIP_INTERNAL_ERROR);
 
@@ -4655,6 +5673,18 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             comp_remaining = file_stat.m_comp_size;
         }
 
+        if (dict_size)
+        {
+            /* Decompress behind a copy of the dictionary so back references can reach into it, then move the output into place. */
+            if (NULL == (pOut_buf = (mz_uint8 *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, dict_size + (size_t)file_stat.m_uncomp_size)))
+            {
+                if ((!pZip->m_pState->m_pMem) && (!pUser_read_buf))
+                    pZip->m_pFree(pZip->m_pAlloc_opaque, pRead_buf);
+                return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
+            }
+            memcpy(pOut_buf, pZip->m_pState->m_preset_dict.m_p, dict_size);
+        }
+
         do
         {
             /* The size_t cast here should be OK because we've verified that the output buffer is >= file_stat.m_uncomp_size above */
@@ -4673,12 +5703,19 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
                 read_buf_ofs = 0;
             }
             in_buf_size = (size_t)read_buf_avail;
-            status = tinfl_decompress(&inflator, (mz_uint8 *)pRead_buf + read_buf_ofs, &in_buf_size, (mz_uint8 *)pBuf, (mz_uint8 *)pBuf + out_buf_ofs, &out_buf_size, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF | (comp_remaining ? TINFL_FLAG_HAS_MORE_INPUT : 0));
+            status = tinfl_decompress(&inflator, (mz_uint8 *)pRead_buf + read_buf_ofs, &in_buf_size, pOut_buf, pOut_buf + dict_size + out_buf_ofs, &out_buf_size, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF | (comp_remaining ? TINFL_FLAG_HAS_MORE_INPUT : 0));
             read_buf_avail -= in_buf_size;
             read_buf_ofs += in_buf_size;
             out_buf_ofs += out_buf_size;
         } while (status == TINFL_STATUS_NEEDS_MORE_INPUT);
 
+        if (dict_size)
+        {
+            if (status == TINFL_STATUS_DONE)
+                memcpy(pBuf, pOut_buf + dict_size, (size_t)out_buf_ofs);
+            pZip->m_pFree(pZip->m_pAlloc_opaque, pOut_buf);
+        }
+
         if (status == TINFL_STATUS_DONE)
         {
             /* Make sure the entire file was decompressed, and check its CRC. */
@@ -4702,6 +5739,35 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         return status == TINFL_STATUS_DONE;
     }
 
+    static mz_bool mz_zip_reader_load_preset_dict(mz_zip_archive *pZip)
+    {
+        mz_zip_internal_state *pState = pZip->m_pState;
+        mz_zip_archive_file_stat file_stat;
+        mz_uint32 file_index;
+
+        if (pState->m_preset_dict.m_size)
+            return MZ_TRUE;
+
+        if (!mz_zip_reader_locate_file_v2(pZip, MZ_ZIP_PRESET_DICT_NAME, NULL, MZ_ZIP_FLAG_CASE_SENSITIVE, &file_index))
+            return mz_zip_set_error(pZip, MZ_ZIP_INVALID_HEADER_OR_CORRUPTED);
+        if (!mz_zip_reader_file_stat(pZip, file_index, &file_stat))
+            return MZ_FALSE;
+
+        /* The dictionary itself is always stored, so loading it never recurses. */
+        if ((file_stat.m_method != 0) || (!file_stat.m_uncomp_size) || (file_stat.m_uncomp_size > MZ_ZIP_PRESET_DICT_MAX_SIZE))
+            return mz_zip_set_error(pZip, MZ_ZIP_INVALID_HEADER_OR_CORRUPTED);
+
+        if (!mz_zip_array_resize(pZip, &pState->m_preset_dict, (size_t)file_stat.m_uncomp_size, MZ_FALSE))
+            return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
+        if (!mz_zip_reader_extract_to_mem_no_alloc1(pZip, file_index, pState->m_preset_dict.m_p, pState->m_preset_dict.m_size, 0, NULL, 0, &file_stat))
+        {
+            mz_zip_array_clear(pZip, &pState->m_preset_dict);
+            MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pState->m_preset_dict, sizeof(mz_uint8));
+            return MZ_FALSE;
+        }
+        return MZ_TRUE;
+    }
+
     mz_bool mz_zip_reader_extract_to_mem_no_alloc(mz_zip_archive *pZip, mz_uint file_index, void *pBuf, size_t buf_size, mz_uint flags, void *pUser_read_buf, size_t user_read_buf_size)
     {
         return mz_zip_reader_extract_to_mem_no_alloc1(pZip, file_index, pBuf, buf_size, flags, pUser_read_buf, user_read_buf_size, NULL);
@@ -4773,6 +5839,26 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         return mz_zip_reader_extract_to_heap(pZip, file_index, pSize, flags);
     }
 
+    /* Preset dictionary entries are small by construction: decompress them whole and hand the result to the callback in one call. */
+    static mz_bool mz_zip_reader_extract_preset_dict_entry_to_callback(mz_zip_archive *pZip, mz_uint file_index, const mz_zip_archive_file_stat *pStat, mz_file_write_func pCallback, void *pOpaque, mz_uint flags)
+    {
+        mz_bool status;
+        void *pBuf;
+
+        if (((sizeof(size_t) == sizeof(mz_uint32))) && (pStat->m_uncomp_size > 0x7FFFFFFF))
+            return mz_zip_set_error(pZip, MZ_ZIP_INTERNAL_ERROR);
+
+        if (NULL == (pBuf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, (size_t)MZ_MAX(pStat->m_uncomp_size, 1))))
+            return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
+
+        status = mz_zip_reader_extract_to_mem_no_alloc1(pZip, file_index, pBuf, (size_t)pStat->m_uncomp_size, flags, NULL, 0, pStat);
+        if ((status) && (pCallback(pOpaque, 0, pBuf, (size_t)pStat->m_uncomp_size) != pStat->m_uncomp_size))
+            status = mz_zip_set_error(pZip, MZ_ZIP_WRITE_CALLBACK_FAILED);
+
+        pZip->m_pFree(pZip->m_pAlloc_opaque, pBuf);
+        return status;
+    }
+
     mz_bool mz_zip_reader_extract_to_callback(mz_zip_archive *pZip, mz_uint file_index, mz_file_write_func pCallback, void *pOpaque, mz_uint flags)
     {
         int status = TINFL_STATUS_DONE;
@@ -4800,6 +5886,9 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         if (file_stat.m_bit_flag & (MZ_ZIP_GENERAL_PURPOSE_BIT_FLAG_IS_ENCRYPTED | MZ_ZIP_GENERAL_PURPOSE_BIT_FLAG_USES_STRONG_ENCRYPTION | MZ_ZIP_GENERAL_PURPOSE_BIT_FLAG_COMPRESSED_PATCH_FLAG))
             return mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_ENCRYPTION);
 
+        if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method == MZ_DEFLATED_PRESET_DICT))
+            return mz_zip_reader_extract_preset_dict_entry_to_callback(pZip, file_index, &file_stat, pCallback, pOpaque, flags);
+
         /* This function only supports decompressing stored and deflate. */
         if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED))
             return mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_METHOD);
@@ -4825,7 +5914,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         }
         else
         {
-            read_buf_size = MZ_MIN(file_stat.m_comp_size, (mz_uint64)MZ_ZIP_MAX_IO_BUF_SIZE);
+            read_buf_size = MZ_MIN(file_stat.m_comp_size, (mz_uint64)mz_zip_io_buf_size(pZip));
             if (NULL == (pRead_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, (size_t)read_buf_size)))
                 return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
 
@@ -4894,7 +5983,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             tinfl_decompressor inflator;
             tinfl_init(&inflator);
 
-            if (NULL == (pWrite_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, TINFL_LZ_DICT_SIZE)))
+            if (NULL == (pWrite_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, MZ_ZIP_READER_DICT_SIZE)))
             {
                 mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
                 status = TINFL_STATUS_FAILED;
@@ -4903,8 +5992,8 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             {
                 do
                 {
-                    mz_uint8 *pWrite_buf_cur = (mz_uint8 *)pWrite_buf + (out_buf_ofs & (TINFL_LZ_DICT_SIZE - 1));
-                    size_t in_buf_size, out_buf_size = TINFL_LZ_DICT_SIZE - (out_buf_ofs & (TINFL_LZ_DICT_SIZE - 1));
+                    mz_uint8 *pWrite_buf_cur = (mz_uint8 *)pWrite_buf + (out_buf_ofs & (MZ_ZIP_READER_DICT_SIZE - 1));
+                    size_t in_buf_size, out_buf_size = MZ_ZIP_READER_DICT_SIZE - (out_buf_ofs & (MZ_ZIP_READER_DICT_SIZE - 1));
                     if ((!read_buf_avail) && (!pZip->m_pState->m_pMem))
                     {
                         read_buf_avail = MZ_MIN(read_buf_size, comp_remaining);
@@ -5074,7 +6163,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             if (!((flags & MZ_ZIP_FLAG_COMPRESSED_DATA) || (!pState->file_stat.m_method)))
             {
                 /* Decompression required, therefore intermediate read buffer required */
-                pState->read_buf_size = MZ_MIN(pState->file_stat.m_comp_size, (mz_uint64)MZ_ZIP_MAX_IO_BUF_SIZE);
+                pState->read_buf_size = MZ_MIN(pState->file_stat.m_comp_size, (mz_uint64)mz_zip_io_buf_size(pZip));
                 if (NULL == (pState->pRead_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, (size_t)pState->read_buf_size)))
                 {
                     mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
@@ -5097,7 +6186,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             tinfl_init(&pState->inflator);
 
             /* Allocate write buffer */
-            if (NULL == (pState->pWrite_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, TINFL_LZ_DICT_SIZE)))
+            if (NULL == (pState->pWrite_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, MZ_ZIP_READER_DICT_SIZE)))
             {
                 mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
                 if (pState->pRead_buf)
@@ -5170,10 +6259,10 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             do
             {
                 /* Calc ptr to write buffer - given current output pos and block size */
-                mz_uint8 *pWrite_buf_cur = (mz_uint8 *)pState->pWrite_buf + (pState->out_buf_ofs & (TINFL_LZ_DICT_SIZE - 1));
+                mz_uint8 *pWrite_buf_cur = (mz_uint8 *)pState->pWrite_buf + (pState->out_buf_ofs & (MZ_ZIP_READER_DICT_SIZE - 1));
 
                 /* Calc max output size - given current output pos and block size */
-                size_t in_buf_size, out_buf_size = TINFL_LZ_DICT_SIZE - (pState->out_buf_ofs & (TINFL_LZ_DICT_SIZE - 1));
+                size_t in_buf_size, out_buf_size = MZ_ZIP_READER_DICT_SIZE - (pState->out_buf_ofs & (MZ_ZIP_READER_DICT_SIZE - 1));
 
                 if (!pState->out_blk_remain)
                 {
@@ -5303,6 +6392,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         pFile = MZ_FOPEN(pDst_filename, "wb");
         if (!pFile)
             return mz_zip_set_error(pZip, MZ_ZIP_FILE_OPEN_FAILED);
+        mz_zip_set_file_buffer(pZip, pFile);
 
         status = mz_zip_reader_extract_to_callback(pZip, file_index, mz_zip_file_write_callback, pFile, flags);
 
@@ -5403,7 +6493,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             return mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_ENCRYPTION);
 
         /* This function only supports stored and deflate. */
-        if ((file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED))
+        if ((file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED) && (file_stat.m_method != MZ_DEFLATED_PRESET_DICT))
             return mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_METHOD);
 
         if (!file_stat.m_is_supported)
@@ -5792,6 +6882,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         mz_zip_array_clear(pZip, &pState->m_central_dir);
         mz_zip_array_clear(pZip, &pState->m_central_dir_offsets);
         mz_zip_array_clear(pZip, &pState->m_sorted_central_dir_offsets);
+        mz_zip_array_clear(pZip, &pState->m_preset_dict);
 
 #ifndef MINIZ_NO_STDIO
         if (pState->m_pFile)
@@ -5860,6 +6951,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pZip->m_pState->m_central_dir, sizeof(mz_uint8));
         MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pZip->m_pState->m_central_dir_offsets, sizeof(mz_uint32));
         MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pZip->m_pState->m_sorted_central_dir_offsets, sizeof(mz_uint32));
+        MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pZip->m_pState->m_preset_dict, sizeof(mz_uint8));
 
         pZip->m_pState->m_zip64 = zip64;
         pZip->m_pState->m_zip64_has_extended_info_fields = zip64;
@@ -5925,6 +7017,76 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         return MZ_FWRITE(pBuf, 1, n, pZip->m_pState->m_pFile);
     }
 
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+    /* Copies n raw archive bytes from pSource_zip to pZip inside the kernel when both are stdio file archives (Linux only).
+       copy_file_range() lets the filesystem share extents (btrfs/xfs reflink) or copy server side (NFS 4.2, SMB); when it's unavailable
+       (old kernel, EXDEV, ...) sendfile() still avoids the user space round trip. Returns the number of bytes copied, the caller copies the
+       rest through its buffer. The destination FILE is flushed first and its file position is left untouched, so later stdio writes stay consistent. */
+    static mz_uint64 mz_zip_kernel_copy(mz_zip_archive *pZip, mz_uint64 dst_ofs, mz_zip_archive *pSource_zip, mz_uint64 src_ofs, mz_uint64 n)
+    {
+        mz_uint64 copied = 0;
+#if defined(__linux__)
+        const size_t max_chunk = 1U << 30;
+        int in_fd, out_fd;
+        off_t saved_pos;
+
+        if ((pZip->m_pWrite != mz_zip_file_write_func) || (pSource_zip->m_pRead != mz_zip_file_read_func) || (!pZip->m_pState->m_pFile) || (!pSource_zip->m_pState->m_pFile))
+            return 0;
+        if (MZ_FFLUSH(pZip->m_pState->m_pFile) == EOF)
+            return 0;
+
+        in_fd = fileno(pSource_zip->m_pState->m_pFile);
+        out_fd = fileno(pZip->m_pState->m_pFile);
+        src_ofs += pSource_zip->m_pState->m_file_archive_start_ofs;
+        dst_ofs += pZip->m_pState->m_file_archive_start_ofs;
+
+#ifdef SYS_copy_file_range
+        while (copied < n)
+        {
+            loff_t in_pos = (loff_t)(src_ofs + copied), out_pos = (loff_t)(dst_ofs + copied);
+            long r = syscall(SYS_copy_file_range, in_fd, &in_pos, out_fd, &out_pos, (size_t)MZ_MIN((mz_uint64)max_chunk, n - copied), 0U);
+            if ((r < 0) && (errno == EINTR))
+                continue;
+            if (r <= 0)
+                break;
+            copied += (mz_uint64)r;
+        }
+#endif
+
+        /* sendfile() writes at the file position of out_fd, restore it afterwards */
+        if ((copied < n) && ((saved_pos = lseek(out_fd, 0, SEEK_CUR)) >= 0))
+        {
+            if (lseek(out_fd, (off_t)(dst_ofs + copied), SEEK_SET) >= 0)
+            {
+                while (copied < n)
+                {
+                    off_t in_pos = (off_t)(src_ofs + copied);
+                    ssize_t r = sendfile(out_fd, in_fd, &in_pos, (size_t)MZ_MIN((mz_uint64)max_chunk, n - copied));
+                    if ((r < 0) && (errno == EINTR))
+                        continue;
+                    if (r <= 0)
+                        break;
+                    copied += (mz_uint64)r;
+                }
+            }
+            lseek(out_fd, saved_pos, SEEK_SET);
+        }
+#else
+        (void)pZip;
+        (void)dst_ofs;
+        (void)pSource_zip;
+        (void)src_ofs;
+        (void)n;
+#endif
+        return copied;
+    }
+
     mz_bool mz_zip_writer_init_file(mz_zip_archive *pZip, const char *pFilename, mz_uint64 size_to_reserve_at_beginning)
     {
         return mz_zip_writer_init_file_v2(pZip, pFilename, size_to_reserve_at_beginning, 0);
@@ -5950,6 +7112,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             mz_zip_writer_end(pZip);
             return mz_zip_set_error(pZip, MZ_ZIP_FILE_OPEN_FAILED);
         }
+        mz_zip_set_file_buffer(pZip, pFile);
 
         pZip->m_pState->m_pFile = pFile;
         pZip->m_zip_type = MZ_ZIP_TYPE_FILE;
@@ -6051,6 +7214,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
                     mz_zip_reader_end_internal(pZip, MZ_FALSE);
                     return mz_zip_set_error(pZip, MZ_ZIP_FILE_OPEN_FAILED);
                 }
+                mz_zip_set_file_buffer(pZip, pState->m_pFile);
             }
 
             pZip->m_pWrite = mz_zip_file_write_func;
@@ -6277,6 +7441,49 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         return mz_zip_writer_add_mem_ex_v2(pZip, pArchive_name, pBuf, buf_size, pComment, comment_size, level_and_flags, uncomp_size, uncomp_crc32, NULL, NULL, 0, NULL, 0);
     }
 
+    mz_bool mz_zip_writer_reserve_entries(mz_zip_archive *pZip, mz_uint num_files, mz_uint64 name_bytes)
+    {
+        mz_zip_internal_state *pState;
+        mz_uint64 central_dir_size;
+
+        if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_WRITING))
+            return mz_zip_set_error(pZip, MZ_ZIP_INVALID_PARAMETER);
+
+        pState = pZip->m_pState;
+        central_dir_size = pState->m_central_dir.m_size + (mz_uint64)num_files * (MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + (pState->m_zip64 ? MZ_ZIP64_MAX_CENTRAL_EXTRA_FIELD_SIZE : 0)) + name_bytes;
+
+        /* miniz doesn't support central dirs >= MZ_UINT32_MAX bytes yet */
+        if (central_dir_size >= MZ_UINT32_MAX)
+            return mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_CDIR_SIZE);
+
+        if ((!mz_zip_array_reserve(pZip, &pState->m_central_dir, (size_t)central_dir_size, MZ_FALSE)) ||
+            (!mz_zip_array_reserve(pZip, &pState->m_central_dir_offsets, pState->m_central_dir_offsets.m_size + num_files, MZ_FALSE)))
+            return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
+
+        return MZ_TRUE;
+    }
+
+    mz_bool mz_zip_writer_add_preset_dict(mz_zip_archive *pZip, const void *pDict, size_t dict_size, MZ_TIME_T *last_modified)
+    {
+        mz_zip_internal_state *pState;
+
+        if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_WRITING) || (!pDict) || (!dict_size) || (dict_size > MZ_ZIP_PRESET_DICT_MAX_SIZE) || (pZip->m_pState->m_preset_dict.m_size))
+            return mz_zip_set_error(pZip, MZ_ZIP_INVALID_PARAMETER);
+
+        pState = pZip->m_pState;
+        if (!mz_zip_array_resize(pZip, &pState->m_preset_dict, dict_size, MZ_FALSE))
+            return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
+
+        if (!mz_zip_writer_add_mem_ex_v2(pZip, MZ_ZIP_PRESET_DICT_NAME, pDict, dict_size, NULL, 0, MZ_NO_COMPRESSION, 0, 0, last_modified, NULL, 0, NULL, 0))
+        {
+            mz_zip_array_clear(pZip, &pState->m_preset_dict);
+            MZ_ZIP_ARRAY_SET_ELEMENT_SIZE(&pState->m_preset_dict, sizeof(mz_uint8));
+            return MZ_FALSE;
+        }
+        memcpy(pState->m_preset_dict.m_p, pDict, dict_size);
+        return MZ_TRUE;
+    }
+
     mz_bool mz_zip_writer_add_mem_ex_v2(mz_zip_archive *pZip, const char *pArchive_name, const void *pBuf, size_t buf_size, const void *pComment, mz_uint16 comment_size,
                                         mz_uint level_and_flags, mz_uint64 uncomp_size, mz_uint32 uncomp_crc32, MZ_TIME_T *last_modified,
                                         const char *user_extra_data, mz_uint user_extra_data_len, const char *user_extra_data_central, mz_uint user_extra_data_central_len)
@@ -6397,6 +7604,9 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         if ((!mz_zip_array_ensure_room(pZip, &pState->m_central_dir, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + archive_name_size + comment_size + (pState->m_zip64 ? MZ_ZIP64_MAX_CENTRAL_EXTRA_FIELD_SIZE : 0))) || (!mz_zip_array_ensure_room(pZip, &pState->m_central_dir_offsets, 1)))
             return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
 
+        if ((level_and_flags & MZ_ZIP_FLAG_PRESET_DICT) && (!pState->m_preset_dict.m_size))
+            return mz_zip_set_error(pZip, MZ_ZIP_INVALID_PARAMETER);
+
         if ((!store_data_uncompressed) && (buf_size))
         {
             if (NULL == (pComp = (tdefl_compressor *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, sizeof(tdefl_compressor))))
@@ -6420,7 +7630,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
 
         if (!store_data_uncompressed || (level_and_flags & MZ_ZIP_FLAG_COMPRESSED_DATA))
         {
-            method = MZ_DEFLATED;
+            method = (level_and_flags & MZ_ZIP_FLAG_PRESET_DICT) ? MZ_DEFLATED_PRESET_DICT : MZ_DEFLATED;
         }
 
         if (pState->m_zip64)
@@ -6503,6 +7713,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             state.m_comp_size = 0;
 
             if ((tdefl_init(pComp, mz_zip_writer_add_put_buf_callback, &state, tdefl_create_comp_flags_from_zip_params(level, -15, MZ_DEFAULT_STRATEGY)) != TDEFL_STATUS_OKAY) ||
+                ((level_and_flags & MZ_ZIP_FLAG_PRESET_DICT) && (tdefl_set_dictionary(pComp, pState->m_preset_dict.m_p, pState->m_preset_dict.m_size) != TDEFL_STATUS_OKAY)) ||
                 (tdefl_compress_buffer(pComp, pBuf, buf_size, TDEFL_FINISH) != TDEFL_STATUS_DONE))
             {
                 pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
@@ -6604,6 +7815,9 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         if (level_and_flags & MZ_ZIP_FLAG_COMPRESSED_DATA)
             return mz_zip_set_error(pZip, MZ_ZIP_INVALID_PARAMETER);
 
+        if ((level_and_flags & MZ_ZIP_FLAG_PRESET_DICT) && (!pState->m_preset_dict.m_size))
+            return mz_zip_set_error(pZip, MZ_ZIP_INVALID_PARAMETER);
+
         if (!mz_zip_writer_validate_archive_name(pArchive_name))
             return mz_zip_set_error(pZip, MZ_ZIP_INVALID_FILENAME);
 
@@ -6668,7 +7882,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
 
         if (max_size && level)
         {
-            method = MZ_DEFLATED;
+            method = (level_and_flags & MZ_ZIP_FLAG_PRESET_DICT) ? MZ_DEFLATED_PRESET_DICT : MZ_DEFLATED;
         }
 
         MZ_CLEAR_ARR(local_dir_header);
@@ -6737,7 +7951,8 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
 
         if (max_size)
         {
-            void *pRead_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, MZ_ZIP_MAX_IO_BUF_SIZE);
+            const size_t io_buf_size = mz_zip_io_buf_size(pZip);
+            void *pRead_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, io_buf_size);
             if (!pRead_buf)
             {
                 return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
@@ -6747,11 +7962,11 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             {
                 while (1)
                 {
-                    size_t n = read_callback(callback_opaque, file_ofs, pRead_buf, MZ_ZIP_MAX_IO_BUF_SIZE);
+                    size_t n = read_callback(callback_opaque, file_ofs, pRead_buf, io_buf_size);
                     if (n == 0)
                         break;
 
-                    if ((n > MZ_ZIP_MAX_IO_BUF_SIZE) || (file_ofs + n > max_size))
+                    if ((n > io_buf_size) || (file_ofs + n > max_size))
                     {
                         pZip->m_pFree(pZip->m_pAlloc_opaque, pRead_buf);
                         return mz_zip_set_error(pZip, MZ_ZIP_FILE_READ_FAILED);
@@ -6783,7 +7998,8 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
                 state.m_cur_archive_file_ofs = cur_archive_file_ofs;
                 state.m_comp_size = 0;
 
-                if (tdefl_init(pComp, mz_zip_writer_add_put_buf_callback, &state, tdefl_create_comp_flags_from_zip_params(level, -15, MZ_DEFAULT_STRATEGY)) != TDEFL_STATUS_OKAY)
+                if ((tdefl_init(pComp, mz_zip_writer_add_put_buf_callback, &state, tdefl_create_comp_flags_from_zip_params(level, -15, MZ_DEFAULT_STRATEGY)) != TDEFL_STATUS_OKAY) ||
+                    ((level_and_flags & MZ_ZIP_FLAG_PRESET_DICT) && (tdefl_set_dictionary(pComp, pState->m_preset_dict.m_p, pState->m_preset_dict.m_size) != TDEFL_STATUS_OKAY)))
                 {
                     pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
                     pZip->m_pFree(pZip->m_pAlloc_opaque, pRead_buf);
@@ -6795,8 +8011,8 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
                     tdefl_status status;
                     tdefl_flush flush = TDEFL_NO_FLUSH;
 
-                    size_t n = read_callback(callback_opaque, file_ofs, pRead_buf, MZ_ZIP_MAX_IO_BUF_SIZE);
-                    if ((n > MZ_ZIP_MAX_IO_BUF_SIZE) || (file_ofs + n > max_size))
+                    size_t n = read_callback(callback_opaque, file_ofs, pRead_buf, io_buf_size);
+                    if ((n > io_buf_size) || (file_ofs + n > max_size))
                     {
                         mz_zip_set_error(pZip, MZ_ZIP_FILE_READ_FAILED);
                         break;
@@ -7056,6 +8272,14 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
 
     /* TODO: This func is now pretty freakin complex due to zip64, split it up? */
     mz_bool mz_zip_writer_add_from_zip_reader(mz_zip_archive *pZip, mz_zip_archive *pSource_zip, mz_uint src_file_index)
+    {
+        return mz_zip_writer_add_from_zip_reader_v2(pZip, pSource_zip, src_file_index, NULL);
+    }
+
+    /* Copies an entry's compressed data as-is. With new_metadata set, the copy records pFile_time (the current time if NULL) and ext_attributes */
+    /* in its local and central headers instead of the source entry's modification time and external attributes. */
+    static mz_bool mz_zip_writer_copy_entry(mz_zip_archive *pZip, mz_zip_archive *pSource_zip, mz_uint src_file_index, const char *pNew_archive_name,
+                                            mz_bool new_metadata, const MZ_TIME_T *pFile_time, mz_uint32 ext_attributes)
     {
         mz_uint n, bit_flags, num_alignment_padding_bytes, src_central_dir_following_data_size;
         mz_uint64 src_archive_bytes_remaining, local_dir_header_ofs;
@@ -7072,11 +8296,38 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         mz_uint32 local_header_filename_size, local_header_extra_len;
         mz_uint64 local_header_comp_size, local_header_uncomp_size;
         mz_bool found_zip64_ext_data_in_ldir = MZ_FALSE;
+        size_t dst_filename_len = 0;
+        mz_uint16 dos_time = 0, dos_date = 0;
 
         /* Sanity checks */
         if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_WRITING) || (!pSource_zip->m_pRead))
             return mz_zip_set_error(pZip, MZ_ZIP_INVALID_PARAMETER);
 
+        if (pNew_archive_name)
+        {
+            if (!mz_zip_writer_validate_archive_name(pNew_archive_name))
+                return mz_zip_set_error(pZip, MZ_ZIP_INVALID_FILENAME);
+
+            dst_filename_len = strlen(pNew_archive_name);
+            if (dst_filename_len > MZ_UINT16_MAX)
+                return mz_zip_set_error(pZip, MZ_ZIP_INVALID_FILENAME);
+        }
+
+        if (new_metadata)
+        {
+#ifndef MINIZ_NO_TIME
+            MZ_TIME_T cur_time;
+            if (pFile_time == NULL)
+            {
+                time(&cur_time);
+                pFile_time = &cur_time;
+            }
+            mz_zip_time_t_to_dos_time(*pFile_time, &dos_time, &dos_date);
+#else
+            (void)pFile_time;
+#endif /* #ifndef MINIZ_NO_TIME */
+        }
+
         pState = pZip->m_pState;
 
         /* Don't support copying files from zip64 archives to non-zip64, even though in some cases this is possible */
@@ -7093,12 +8344,24 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         src_filename_len = MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_FILENAME_LEN_OFS);
         src_comment_len = MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_COMMENT_LEN_OFS);
         src_ext_len = MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_EXTRA_LEN_OFS);
-        src_central_dir_following_data_size = src_filename_len + src_ext_len + src_comment_len;
+        if (!pNew_archive_name)
+            dst_filename_len = src_filename_len;
+        src_central_dir_following_data_size = (mz_uint)dst_filename_len + src_ext_len + src_comment_len;
 
         /* TODO: We don't support central dir's >= MZ_UINT32_MAX bytes right now (+32 fudge factor in case we need to add more extra data) */
         if ((pState->m_central_dir.m_size + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + src_central_dir_following_data_size + 32) >= MZ_UINT32_MAX)
             return mz_zip_set_error(pZip, MZ_ZIP_UNSUPPORTED_CDIR_SIZE);
 
+        /* When cloning an entry of the archive being written (which requires MZ_ZIP_FLAG_WRITE_ALLOW_READING), */
+        /* reserve room up front so appending the new central dir header can't move the source header. */
+        if (pSource_zip == pZip)
+        {
+            if (!mz_zip_array_ensure_room(pZip, &pState->m_central_dir, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + src_central_dir_following_data_size + MZ_ZIP64_MAX_CENTRAL_EXTRA_FIELD_SIZE))
+                return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
+
+            pSrc_central_header = mz_zip_get_cdh(pSource_zip, src_file_index);
+        }
+
         num_alignment_padding_bytes = mz_zip_writer_compute_padding_needed_for_file_alignment(pZip);
 
         if (!pState->m_zip64)
@@ -7223,19 +8486,53 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             MZ_ASSERT((local_dir_header_ofs & (pZip->m_file_offset_alignment - 1)) == 0);
         }
 
+        /* When renaming, only the filename length (and the UTF-8 flag) of the local header change; the new name replaces the source name bytes */
+        if (pNew_archive_name)
+        {
+            MZ_WRITE_LE16(pLocal_header + MZ_ZIP_LDH_FILENAME_LEN_OFS, dst_filename_len);
+            MZ_WRITE_LE16(pLocal_header + MZ_ZIP_LDH_BIT_FLAG_OFS, MZ_READ_LE16(pLocal_header + MZ_ZIP_LDH_BIT_FLAG_OFS) | MZ_ZIP_GENERAL_PURPOSE_BIT_FLAG_UTF8);
+        }
+
+        if (new_metadata)
+        {
+            MZ_WRITE_LE16(pLocal_header + MZ_ZIP_LDH_FILE_TIME_OFS, dos_time);
+            MZ_WRITE_LE16(pLocal_header + MZ_ZIP_LDH_FILE_DATE_OFS, dos_date);
+        }
+
         /* The original zip's local header+ext block doesn't change, even with zip64, so we can just copy it over to the dest zip */
         if (pZip->m_pWrite(pZip->m_pIO_opaque, cur_dst_file_ofs, pLocal_header, MZ_ZIP_LOCAL_DIR_HEADER_SIZE) != MZ_ZIP_LOCAL_DIR_HEADER_SIZE)
             return mz_zip_set_error(pZip, MZ_ZIP_FILE_WRITE_FAILED);
 
         cur_dst_file_ofs += MZ_ZIP_LOCAL_DIR_HEADER_SIZE;
 
+        if (pNew_archive_name)
+        {
+            if (pZip->m_pWrite(pZip->m_pIO_opaque, cur_dst_file_ofs, pNew_archive_name, dst_filename_len) != dst_filename_len)
+                return mz_zip_set_error(pZip, MZ_ZIP_FILE_WRITE_FAILED);
+
+            cur_dst_file_ofs += dst_filename_len;
+            cur_src_file_ofs += local_header_filename_size;
+            src_archive_bytes_remaining -= local_header_filename_size;
+        }
+
         /* Copy over the source archive bytes to the dest archive, also ensure we have enough buf space to handle optional data descriptor */
-        if (NULL == (pBuf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, (size_t)MZ_MAX(32U, MZ_MIN((mz_uint64)MZ_ZIP_MAX_IO_BUF_SIZE, src_archive_bytes_remaining)))))
+        if (NULL == (pBuf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, (size_t)MZ_MAX(32U, MZ_MIN((mz_uint64)mz_zip_io_buf_size(pSource_zip), src_archive_bytes_remaining)))))
             return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
 
+#ifndef MINIZ_NO_STDIO
+        /* Entries spanning more than one buffer are copied inside the kernel when possible; small ones aren't worth flushing the stdio buffer for */
+        if (src_archive_bytes_remaining > mz_zip_io_buf_size(pSource_zip))
+        {
+            mz_uint64 copied = mz_zip_kernel_copy(pZip, cur_dst_file_ofs, pSource_zip, cur_src_file_ofs, src_archive_bytes_remaining);
+            cur_src_file_ofs += copied;
+            cur_dst_file_ofs += copied;
+            src_archive_bytes_remaining -= copied;
+        }
+#endif
+
         while (src_archive_bytes_remaining)
         {
-            n = (mz_uint)MZ_MIN((mz_uint64)MZ_ZIP_MAX_IO_BUF_SIZE, src_archive_bytes_remaining);
+            n = (mz_uint)MZ_MIN((mz_uint64)mz_zip_io_buf_size(pSource_zip), src_archive_bytes_remaining);
             if (pSource_zip->m_pRead(pSource_zip->m_pIO_opaque, cur_src_file_ofs, pBuf, n) != n)
             {
                 pZip->m_pFree(pZip->m_pAlloc_opaque, pBuf);
@@ -7326,6 +8623,19 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
 
         memcpy(new_central_header, pSrc_central_header, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE);
 
+        if (pNew_archive_name)
+        {
+            MZ_WRITE_LE16(new_central_header + MZ_ZIP_CDH_FILENAME_LEN_OFS, dst_filename_len);
+            MZ_WRITE_LE16(new_central_header + MZ_ZIP_CDH_BIT_FLAG_OFS, MZ_READ_LE16(new_central_header + MZ_ZIP_CDH_BIT_FLAG_OFS) | MZ_ZIP_GENERAL_PURPOSE_BIT_FLAG_UTF8);
+        }
+
+        if (new_metadata)
+        {
+            MZ_WRITE_LE16(new_central_header + MZ_ZIP_CDH_FILE_TIME_OFS, dos_time);
+            MZ_WRITE_LE16(new_central_header + MZ_ZIP_CDH_FILE_DATE_OFS, dos_date);
+            MZ_WRITE_LE32(new_central_header + MZ_ZIP_CDH_EXTERNAL_ATTR_OFS, ext_attributes);
+        }
+
         if (pState->m_zip64)
         {
             /* This is the painful part: We need to write a new central dir header + ext block with updated zip64 fields, and ensure the old fields (if any) are not included. */
@@ -7352,7 +8662,7 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
                 return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
             }
 
-            if (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pSrc_central_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE, src_filename_len))
+            if (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pNew_archive_name ? (const mz_uint8 *)pNew_archive_name : pSrc_central_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE, dst_filename_len))
             {
                 mz_zip_array_clear(pZip, &new_ext_block);
                 mz_zip_array_resize(pZip, &pState->m_central_dir, orig_central_dir_size, MZ_FALSE);
@@ -7389,7 +8699,8 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
             if (!mz_zip_array_push_back(pZip, &pState->m_central_dir, new_central_header, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE))
                 return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
 
-            if (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pSrc_central_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE, src_central_dir_following_data_size))
+            if ((!mz_zip_array_push_back(pZip, &pState->m_central_dir, pNew_archive_name ? (const mz_uint8 *)pNew_archive_name : pSrc_central_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE, dst_filename_len)) ||
+                (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pSrc_central_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + src_filename_len, src_ext_len + src_comment_len)))
             {
                 mz_zip_array_resize(pZip, &pState->m_central_dir, orig_central_dir_size, MZ_FALSE);
                 return mz_zip_set_error(pZip, MZ_ZIP_ALLOC_FAILED);
@@ -7417,6 +8728,17 @@ static int mz_stat64(const char *path, struct __stat64 *buffer)
         return MZ_TRUE;
     }
 
+    mz_bool mz_zip_writer_add_from_zip_reader_v2(mz_zip_archive *pZip, mz_zip_archive *pSource_zip, mz_uint src_file_index, const char *pNew_archive_name)
+    {
+        return mz_zip_writer_copy_entry(pZip, pSource_zip, src_file_index, pNew_archive_name, MZ_FALSE, NULL, 0);
+    }
+
+    mz_bool mz_zip_writer_add_from_zip_reader_v3(mz_zip_archive *pZip, mz_zip_archive *pSource_zip, mz_uint src_file_index, const char *pNew_archive_name,
+                                                 const MZ_TIME_T *pFile_time, mz_uint32 ext_attributes)
+    {
+        return mz_zip_writer_copy_entry(pZip, pSource_zip, src_file_index, pNew_archive_name, MZ_TRUE, pFile_time, ext_attributes);
+    }
+
     mz_bool mz_zip_writer_finalize_archive(mz_zip_archive *pZip)
     {
         mz_zip_internal_state *pState;
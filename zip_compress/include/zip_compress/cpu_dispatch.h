@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+
+/**
+ * @file cpu_dispatch.h
+ * @brief 运行时 CPU 特性检测, 为 CRC-32 / adler-32 / 匹配比较 / 解压匹配复制绑定对应的 SIMD 内核
+ * @author abin
+ * @date 2025-12-13
+ */
+
+#ifndef __GUARD_CPU_DISPATCH_H_INCLUDE_GUARD__
+#define __GUARD_CPU_DISPATCH_H_INCLUDE_GUARD__
+
+#include "miniz.h"
+
+namespace zip_compress
+{
+
+// 分发结果, 特性位为 miniz 的 MZ_CPU_*
+struct CpuDispatch
+{
+  unsigned int detected;     // CPU 实际具备的特性
+  unsigned int enabled;      // 绑定内核时使用的特性(强制标量时为 0)
+  bool force_scalar;         // 环境变量 ZIP_COMPRESS_FORCE_SCALAR 已设置且不为 "0"
+  const char *crc32;         // 各热点选用的内核名, 见 mz_kernel_name()
+  const char *adler32;
+  const char *match_len;
+  const char *inflate_copy;
+};
+
+// 首次调用时检测 CPU(x86: cpuid/xgetbv, Linux ARM: getauxval)并为 miniz 绑定内核, 之后直接返回同一结果.
+// ZipWriter / ZipReader 构造时会自动调用; 直接使用 miniz 接口前可先手动调用一次
+const CpuDispatch &cpu_dispatch();
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_CPU_DISPATCH_H_INCLUDE_GUARD__
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+
+/**
+ * @file entry_rules.h
+ * @brief add_folder / extract_all 的条目规则: glob/正则 包含与排除, 以及按名称或文件大小选择压缩级别
+ * @author abin
+ * @date 2025-12-18
+ */
+
+#ifndef __GUARD_ENTRY_RULES_H_INCLUDE_GUARD__
+#define __GUARD_ENTRY_RULES_H_INCLUDE_GUARD__
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace zip_compress
+{
+
+// 规则匹配的是相对文件夹根目录、以 '/' 分隔的条目名.
+// glob: '*' '?' '[...]'(支持 '!' / '^' 取反) 不跨越 '/', "**" 可跨越; 不含 '/' 的模式只匹配最后一级名称
+// (如 "*.png" 匹配任意目录下的 png, ".git" 匹配任意位置的 .git), 含 '/' 的模式匹配完整条目名.
+// 正则: ECMAScript 语法, 在完整条目名中搜索, 需要整串匹配时自行加 ^ $
+class EntryRules
+{
+ public:
+  // 包含规则: 设置后只打包至少匹配一条包含规则的文件(不作用于目录)
+  EntryRules &include(const std::string &glob);
+  EntryRules &include_regex(const std::string &regex);
+
+  // 排除规则: 匹配的文件被跳过, 匹配的目录整棵子树都不会进入. 优先于包含规则
+  EntryRules &exclude(const std::string &glob);
+  EntryRules &exclude_regex(const std::string &regex);
+
+  // 压缩级别规则(级别取值同 ZipWriter::set_level): 按添加顺序取第一条命中的规则, 都未命中时使用 ZipWriter 的级别
+  EntryRules &level(const std::string &glob, int level);
+  EntryRules &level_regex(const std::string &regex, int level);
+
+  // 按文件大小选择级别: 大小位于 [min_size, max_size) 的文件命中; 与上面的规则一起按添加顺序匹配
+  EntryRules &level_by_size(uint64_t min_size, uint64_t max_size, int level);
+
+  // 目录是否需要进入
+  bool accepts_directory(const std::string &name) const;
+
+  // 文件是否需要打包
+  bool accepts_file(const std::string &name) const;
+
+  // 按完整条目名判断(用于 ZIP 内条目): 任一级祖先目录被排除即排除; 设置了包含规则时目录条目不选中
+  bool accepts_entry(const std::string &name, bool is_directory) const;
+
+  // 文件的压缩级别, 没有规则命中时返回 -1; file_size 只在检查到大小规则时才调用
+  int level_for(const std::string &name, const std::function<uint64_t()> &file_size) const;
+
+  bool empty() const
+  {
+    return includes_.empty() && excludes_.empty() && levels_.empty();
+  }
+
+ private:
+  struct Pattern
+  {
+    std::string glob;
+    std::shared_ptr<const std::regex> regex;  // 非空表示正则规则
+    bool basename_only;                       // glob 不含 '/' 时只匹配最后一级名称
+
+    bool matches(const std::string &name) const;
+  };
+
+  struct LevelRule
+  {
+    std::shared_ptr<const Pattern> pattern;  // 为空表示按大小匹配
+    uint64_t min_size;
+    uint64_t max_size;
+    int level;
+  };
+
+  static Pattern make_glob(const std::string &glob);
+  static Pattern make_regex(const std::string &regex);
+  static bool any_matches(const std::vector<Pattern> &patterns, const std::string &name);
+  static void check_level(int level);
+
+  std::vector<Pattern> includes_;
+  std::vector<Pattern> excludes_;
+  std::vector<LevelRule> levels_;
+};
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_ENTRY_RULES_H_INCLUDE_GUARD__
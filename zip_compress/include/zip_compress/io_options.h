@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+
+/**
+ * @file io_options.h
+ * @brief ZipReader / ZipWriter 的 IO 参数: 缓冲区大小、顺序预读提示、目录遍历线程数与解压输出文件的写入方式
+ * @author abin
+ * @date 2025-12-14
+ */
+
+#ifndef __GUARD_IO_OPTIONS_H_INCLUDE_GUARD__
+#define __GUARD_IO_OPTIONS_H_INCLUDE_GUARD__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zip_compress
+{
+
+struct IoOptions
+{
+  // 读取条目/源文件的块大小, 同时作为 ZIP 文件与解压输出文件的 stdio 缓冲区大小;
+  // 0 保持 miniz 默认(64 KB 读块, stdio 默认缓冲). 网络文件系统上建议 1 MB 以上
+  size_t buffer_size = 0;
+
+  // 顺序预读提示(posix_fadvise SEQUENTIAL, 解压前对要读的范围发 WILLNEED; macOS 为 F_RDAHEAD / F_RDADVISE):
+  // ZipReader 作用于 ZIP 文件, ZipWriter 作用于自行读取的源文件(去重指纹、归档级别). 不支持的平台忽略
+  bool read_ahead = false;
+
+  // ZipWriter::add_folder 并行遍历目录的线程数, 0 为自动(硬件线程数, 最多 8); 遍历与压缩流水线进行
+  size_t scan_threads = 0;
+
+  // 解压时按条目解压后大小预留磁盘空间(Linux fallocate KEEP_SIZE, macOS F_PREALLOCATE), 减少 ext4/xfs 上的碎片;
+  // 文件系统不支持时忽略, 不会退化为写零
+  bool preallocate = true;
+
+  // 解压时跳过按 4 KB 对齐的全零块, 生成稀疏文件(开启后不做预分配)
+  bool sparse = false;
+
+  // 解压后不小于此字节数的条目以 O_DIRECT 和对齐缓冲写出, 绕过页缓存(macOS 为 F_NOCACHE);
+  // 0 关闭. 文件系统不支持 O_DIRECT 时退回普通写入
+  uint64_t direct_io_threshold = 0;
+
+  // Linux 上解压 STORED(未压缩)条目时直接从 ZIP 文件在内核内拷贝(copy_file_range, 其次 sendfile),
+  // btrfs/xfs 上为 reflink, 不产生写 IO. 拷贝后仍从 ZIP 文件读一遍数据校验 CRC-32, 不一致时解压失败;
+  // 稀疏/直接 IO 模式下数据仍经过缓冲
+  bool kernel_copy = true;
+};
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_IO_OPTIONS_H_INCLUDE_GUARD__
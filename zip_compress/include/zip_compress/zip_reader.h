@@ -11,18 +11,100 @@
 #ifndef __GUARD_ZIP_READER_H_INCLUDE_GUARD__
 #define __GUARD_ZIP_READER_H_INCLUDE_GUARD__
 
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "miniz.h"
+#include "zip_compress/entry_rules.h"
+#include "zip_compress/io_options.h"
 
 namespace zip_compress
 {
 
+class EntryCache;
+class SidecarIndex;
+
+// 解压统计信息, 由 extract_all / extract_file 更新
+struct ExtractStats
+{
+  size_t entries = 0;                   // 遍历的条目数
+  size_t files_extracted = 0;           // 实际解压的文件数
+  size_t entries_skipped = 0;           // 被过滤跳过的条目数
+  size_t directories = 0;               // 需要存在的唯一目录数(含祖先目录)
+  size_t directory_syscalls = 0;        // 实际发出的目录创建调用次数
+};
+
+// 中央目录中的条目元数据, 供 extract_all 的选择回调使用
+struct EntryInfo
+{
+  std::string name;  // ZIP 内条目名, 以 '/' 分隔
+  uint64_t comp_size = 0;
+  uint64_t uncomp_size = 0;
+  uint32_t crc32 = 0;
+  time_t mtime = 0;
+  bool is_directory = false;
+};
+
+// 条目选择回调: 返回 true 表示解压该条目
+using EntrySelector = std::function<bool(const EntryInfo &info)>;
+
+// extract_sync 的参数
+struct SyncOptions
+{
+  // false: 大小与修改时间(DOS 时间精度 2 秒)都一致即视为未变;
+  // true: 大小一致时计算已有文件的 CRC-32 与条目比较, 内容一致但时间不同时把修改时间改回条目时间
+  bool verify_crc = false;
+
+  // 删除目标目录中 ZIP 不包含的文件; false 时只在清单中报告
+  bool delete_extras = false;
+
+  // 比较与解压的线程数, 0 为自动(硬件线程数, 最多 8)
+  size_t threads = 0;
+};
+
+// extract_sync 的变更清单, 路径均为以 '/' 分隔的相对路径
+struct SyncManifest
+{
+  size_t unchanged = 0;              // 已是最新, 跳过的文件数
+  std::vector<std::string> updated;  // 新建或已变化, 重新解压的文件
+  std::vector<std::string> extras;   // 目标目录中存在但 ZIP 中没有的文件(delete_extras 时已删除)
+};
+
+// 解压结果缓存的统计信息
+struct CacheStats
+{
+  size_t hits = 0;       // 命中次数
+  size_t misses = 0;     // 未命中(需要解压)次数
+  size_t evictions = 0;  // 因容量不足淘汰的条目数
+  size_t entries = 0;    // 当前缓存的条目数
+  size_t bytes = 0;      // 当前缓存的解压后字节数
+};
+
+// ZIP 打开方式
+enum class ReadMode
+{
+  standard,  // 打开时读取中央目录并按名称排序, 之后按名查找为二分查找
+  lazy       // 打开时只读取中央目录, 排序推迟到第一次按名查找; 只遍历条目(file_list / extract_all)时不排序
+};
+
 class ZipReader
 {
  public:
-  explicit ZipReader(const std::string &zip_path);
+  // io 控制读取块大小与顺序预读提示, 默认与 miniz 行为一致.
+  // lazy 模式适合条目很多(百万级)且只查找少量条目或只遍历的 ZIP, 打开开销为一次中央目录读取
+  explicit ZipReader(const std::string &zip_path, const IoOptions &io = IoOptions(),
+                     ReadMode mode = ReadMode::standard);
+
+  // 使用边车索引(write_index 生成)打开: 只映射索引文件并比对 ZIP 大小与末尾校验和, 开销与条目数无关;
+  // 索引缺失、损坏或过期时退回 ReadMode::lazy. 需要完整中央目录的操作(如 ZipWriter 复制条目)首次使用时再解析
+  ZipReader(const std::string &zip_path, const std::string &index_path, const IoOptions &io = IoOptions());
   ~ZipReader();
 
   ZipReader(const ZipReader &) = delete;
@@ -37,15 +119,122 @@ class ZipReader
   // 解压整个 ZIP 文件到指定目录（会覆盖已有文件）
   void extract_all(const std::string &output_folder);
 
+  // 只解压规则选中的条目(规则按 ZIP 内条目名匹配, 任一级祖先目录被排除时整棵子树跳过), threads 个线程并行解压,
+  // 0 为自动(硬件线程数, 最多 8). 选择只读取中央目录(或边车索引), 不会读取未选中条目的本地头和压缩数据
+  void extract_all(const std::string &output_folder, const EntryRules &rules, size_t threads = 0);
+
+  // 同上, 由 selector 按中央目录元数据(名称、大小、CRC、修改时间)选择条目
+  void extract_all(const std::string &output_folder, const EntrySelector &selector, size_t threads = 0);
+
+  // 同步解压: 只解压目标目录中缺失或与条目不一致的文件, 一致的文件不读取其压缩数据也不重写;
+  // 目标目录中多出的文件按 options 报告或删除
+  SyncManifest extract_sync(const std::string &output_folder, const SyncOptions &options = SyncOptions());
+
   // 解压单个文件到指定路径
   void extract_file(const std::string &file_name_in_zip, const std::string &output_path);
 
   // 解压单个文件到内存, 返回数据
   std::vector<uint8_t> extract_file_to_memory(const std::string &file_name_in_zip);
 
+  // 条目解压后的字节数, 用于预先分配 extract_file_to_buffer 的缓冲
+  size_t entry_size(const std::string &file_name_in_zip);
+
+  // 解压单个文件到调用方提供的缓冲, 返回写入的字节数; capacity 小于 entry_size 时抛 std::invalid_argument.
+  // scratch 为可复用的压缩数据读取缓冲(建议不小于 64 KB), 提供后解压过程不分配堆内存; 为空时内部临时分配.
+  // 开启缓存时命中的条目直接复制, 未命中不放入缓存
+  size_t extract_file_to_buffer(const std::string &file_name_in_zip, void *buffer, size_t capacity,
+                                void *scratch = nullptr, size_t scratch_size = 0);
+
+  // 解压单个文件到内存, 返回共享的只读缓冲; 开启缓存时命中的条目不再解压.
+  // 可在多个线程中并发调用(按名查找与解压在读取锁内进行, 缓存命中只锁所在分片)
+  std::shared_ptr<const std::vector<uint8_t>> extract_file_shared(const std::string &file_name_in_zip);
+
+  // 开启解压结果缓存: 按解压后字节数限制总容量, 分 shards 个分片各自做 LRU 淘汰; capacity_bytes 为 0 关闭.
+  // 开启后 extract_file_to_memory 也从缓存复制. 重新设置会清空缓存
+  void set_cache(size_t capacity_bytes, size_t shards = 8);
+
+  // 缓存统计信息, 未开启缓存时全为 0
+  CacheStats cache_stats() const;
+
+  // 写出边车索引: 名称哈希表、条目偏移/大小/CRC 与中央目录校验和, 先写临时文件再改名
+  void write_index(const std::string &index_path);
+
+  // 是否正在使用边车索引
+  bool using_index() const
+  {
+    return index_ != nullptr;
+  }
+
+  // 完整校验索引是否与 ZIP 匹配(含中央目录 CRC-32), 开销与中央目录大小成正比
+  static bool verify_index(const std::string &zip_path, const std::string &index_path);
+
+  // 最近一次解压操作的统计信息
+  const ExtractStats &last_extract_stats() const
+  {
+    return stats_;
+  }
+
  private:
+  friend class ZipWriter;  // 原样复制条目时需要访问底层 archive
+
+  // extract_all 选中的条目
+  struct SelectedEntry
+  {
+    mz_uint index;
+    std::string name;  // ZIP 内条目名
+    bool is_directory;
+  };
+
+  // 条目总数
+  mz_uint entry_count();
+
+  // 条目序号对应的 ZIP 内条目名与是否为目录, 只读取中央目录(或边车索引)
+  std::string entry_name(mz_uint file_index, bool &is_directory);
+
+  // 解压前的检查回调, 参数为条目在 entries 中的位置与输出路径, 返回 true 跳过该条目; 会在工作线程中并发调用
+  using SkipCheck = std::function<bool(size_t position, const std::string &output_path)>;
+
+  // 条目序号对应的中央目录元数据
+  EntryInfo entry_info(mz_uint file_index);
+
+  // 创建选中条目需要的目录并解压其中的文件; threads > 1 时每个工作线程使用独立的读取句柄
+  void extract_entries(const std::string &output_folder, const std::vector<SelectedEntry> &entries, size_t threads,
+                       const SkipCheck &skip = nullptr);
+
+  // 打开 ZIP 并解析中央目录
+  void open_archive(ReadMode mode);
+
+  // 返回已解析中央目录的 archive, 使用边车索引时首次调用才解析
+  mz_zip_archive *archive();
+
+  // 按名查找条目序号, 找不到返回 -1
+  long long locate(const std::string &file_name_in_zip);
+
+  // 条目序号对应的解压后大小
+  uint64_t entry_size_at(mz_uint file_index, const std::string &file_name_in_zip);
+
+  // 解压指定条目到新分配的内存
+  std::vector<uint8_t> extract_index_to_memory(mz_uint file_index, const std::string &file_name_in_zip);
+
+  // 解压条目到文件, 输出文件无法创建时 open_failed 置为 true
+  bool extract_to_path(mz_uint file_index, const std::string &output_path, bool &open_failed);
+
+  // 确保目录存在, 已创建过的目录直接跳过
+  void ensure_directory(const std::string &dir);
+
+  // 开启 read_ahead 时提示内核预读条目的压缩数据
+  void advise_entry(mz_uint file_index);
+
   mz_zip_archive zip_;
   bool opened_;
+  std::string zip_path_;
+  std::string index_path_;  // 使用边车索引时为索引路径, 并行解压的工作线程据此打开各自的句柄
+  IoOptions io_;
+  std::unique_ptr<SidecarIndex> index_;  // 为空表示未使用边车索引
+  std::unique_ptr<EntryCache> cache_;    // 为空表示未开启缓存
+  std::mutex read_mutex_;                // extract_file_shared 访问底层 archive 时加锁
+  ExtractStats stats_;
+  std::unordered_set<std::string> created_dirs_;  // 已确认存在的输出目录
 };
 
 }  // namespace zip_compress
@@ -10,17 +10,65 @@
 #ifndef __GUARD_ZIP_WRITER_H_INCLUDE_GUARD__
 #define __GUARD_ZIP_WRITER_H_INCLUDE_GUARD__
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "miniz.h"
+#include "zip_compress/entry_rules.h"
+#include "zip_compress/io_options.h"
 
 namespace zip_compress
 {
 
+class ZipReader;
+struct ContentKey;
+struct ScannedFile;
+
+// 归档压缩级别: 二叉树匹配查找 + 近似最优解析 + 分块, 用数倍于 MZ_UBER_COMPRESSION 的 CPU 换取更小的条目,
+// 输出仍是标准 deflate, 任何解压工具都可以读取. 条目会整体读入内存压缩, 适合冷归档
+const int kArchiveLevel = MZ_UBER_COMPRESSION + 1;
+
+// 设置预设字典后, 解压后不超过该大小的 deflate 条目以字典压缩; 更大的条目字典的收益可以忽略, 保持标准 deflate
+const size_t kDictionaryEntryLimit = 256 * 1024;
+
+// 条目过滤回调: 返回 false 跳过该条目, 修改 name_in_zip 即可重命名
+using EntryFilter = std::function<bool(std::string &name_in_zip)>;
+
+// 增量重建的变更清单
+struct RebuildManifest
+{
+  size_t unchanged = 0;              // 未变化, 直接复制旧压缩数据的条目数
+  std::vector<std::string> changed;  // 新增或已变化, 重新压缩的条目
+  std::vector<std::string> removed;  // 旧 ZIP 中存在但文件夹中已删除(或被规则排除)的条目
+};
+
+// add_data_batch 的一条内存数据记录, name 与 data 在调用返回前必须保持有效
+struct DataEntry
+{
+  const char *name;  // ZIP 内条目名, 以 '\0' 结尾
+  const void *data;
+  size_t size;
+};
+
+// ZIP 打开方式
+enum class WriteMode
+{
+  create,  // 新建 ZIP, 已存在则覆盖
+  append   // 追加到已有 ZIP(不存在则新建), 已有条目原地保留
+};
+
 class ZipWriter
 {
  public:
-  explicit ZipWriter(const std::string &zip_path);
+  // append 模式只在旧中央目录处写入新条目并在 finish 时重写中央目录,
+  // 开销为 O(新数据 + 中央目录), 不会重写已有条目; 同名条目不会被替换.
+  // io 控制源文件读取块大小、ZIP 文件的 stdio 缓冲与源文件预读提示
+  explicit ZipWriter(const std::string &zip_path, WriteMode mode = WriteMode::create,
+                     const IoOptions &io = IoOptions());
   ~ZipWriter();
 
   ZipWriter(const ZipWriter &) = delete;
@@ -35,15 +83,149 @@ class ZipWriter
   // 添加内存数据作为文件
   void add_data(const std::string &filename_in_zip, const void *data, size_t size);
 
-  // 添加整个文件夹（递归）
-  void add_folder(const std::string &folder_path);
+  // 批量添加内存数据, 适合大量小条目: 多个线程并行压缩(每个线程复用一个压缩器, 输出放进按批分配的一块内存),
+  // 再按输入顺序写入, 小块写出合并为大块顺序写, 中央目录一次预留. 级别、去重与可复现模式同 add_data,
+  // 压缩没有收益的条目直接存储. threads 为 0 时自动(硬件线程数, 最多 8).
+  // 任一记录的 name 或 data 为空指针时抛出 std::invalid_argument, 此时不写入任何条目
+  void add_data_batch(const DataEntry *entries, size_t count, size_t threads = 0);
+
+  void add_data_batch(const std::vector<DataEntry> &entries, size_t threads = 0)
+  {
+    add_data_batch(entries.data(), entries.size(), threads);
+  }
+
+  // 添加调用方已压缩好的原始 deflate 流(不带 zlib 头尾), 直接写入而不重新压缩.
+  // uncomp_size / crc32 为解压后数据的大小与 CRC-32, 写入时无法校验, 由调用方保证一致(解压时会校验).
+  // 不参与内容去重; 可复现模式下使用固定修改时间. deflate_data 为空或 deflate_size 为 0 时抛出 std::invalid_argument
+  void add_precompressed(const std::string &filename_in_zip, const void *deflate_data, size_t deflate_size,
+                         uint64_t uncomp_size, uint32_t crc32);
+
+  // 从样本数据(如同类的 JSON/XML 文件)训练预设字典, 结果可直接传给 set_dictionary. dict_size 为字典大小上限,
+  // 取值 1 ~ MZ_ZIP_PRESET_DICT_MAX_SIZE, 否则抛出 std::invalid_argument; 样本之间没有共有内容时返回空
+  static std::vector<uint8_t> train_dictionary(const std::vector<std::string> &samples, size_t dict_size = 16 * 1024);
+
+  // 设置预设字典: 立即以存储方式写入字典条目 MZ_ZIP_PRESET_DICT_NAME, 之后 add_file/add_data/add_data_batch/add_folder
+  // 添加的不超过 kDictionaryEntryLimit 的压缩条目以字典预热压缩窗口, 大量相似小文件的压缩率明显提高
+  // (归档级别下这些条目改用 MZ_UBER_COMPRESSION 加字典). 每个条目都要重新索引字典, 16 KB 字典约 30 us,
+  // 条目很小时压缩 CPU 约为原来的 3 倍. 这类条目使用私有压缩方法 MZ_DEFLATED_PRESET_DICT,
+  // 只有本库能解压, 其他工具会报告不支持的压缩方法. add_from_reader/merge 复制这类条目时, 目标 ZIP 的字典
+  // 与来源逐字节相同才原样复制, 否则解压后重新压缩.
+  // dict 为空或超过 MZ_ZIP_PRESET_DICT_MAX_SIZE 时抛出 std::invalid_argument,
+  // ZIP 中已有字典条目(追加模式打开或合并而来)时抛出 std::runtime_error
+  void set_dictionary(const void *dict, size_t size);
+
+  void set_dictionary(const std::vector<uint8_t> &dict)
+  {
+    set_dictionary(dict.data(), dict.size());
+  }
+
+  // 添加整个文件夹（递归）, 可复现模式下按条目名排序后写入.
+  // rules 在遍历时生效: 被排除的目录不会进入, 被过滤的文件不会读取, 级别规则命中的文件按规则的级别压缩
+  void add_folder(const std::string &folder_path, const EntryRules &rules = EntryRules());
+
+  // 以上一次的 ZIP 为基础增量打包文件夹(递归): 大小和修改时间未变(或 CRC-32 相同)的文件
+  // 直接复制旧条目的压缩数据, 只压缩新增和已变化的文件. 遍历方式与 rules 同 add_folder, 级别规则只作用于
+  // 需要压缩的文件, 未变的文件保留旧条目的压缩级别; 被排除的文件不写入, 在清单中记为已删除
+  RebuildManifest add_folder_incremental(const std::string &folder_path, ZipReader &previous,
+                                         const EntryRules &rules = EntryRules());
+
+  // 从另一个 ZIP 原样复制单个条目(不解压也不重新压缩), new_name 为空时保持原名.
+  // 以预设字典压缩且字典与本 ZIP 不同的条目会解压后按当前设置重新压缩(保留修改时间);
+  // 复制字典条目而本 ZIP 已有不同的字典时抛出 std::runtime_error, 相同时跳过
+  void add_from_reader(ZipReader &reader, const std::string &name_in_zip, const std::string &new_name = "");
+
+  // 合并另一个 ZIP 的全部条目(原样复制压缩数据), filter 可用于过滤/重命名. 预设字典的处理同 add_from_reader,
+  // 过滤掉字典条目时依赖它的条目会被重新压缩
+  void merge(ZipReader &reader, const EntryFilter &filter = nullptr);
+
+  // 设置之后添加的条目的压缩级别: 0(仅存储) ~ 10(MZ_UBER_COMPRESSION) 或 kArchiveLevel, 默认 MZ_DEFAULT_LEVEL
+  void set_level(int level);
+
+  int level() const
+  {
+    return level_;
+  }
+
+  // 开启/关闭内容去重: 内容相同的条目直接复制已写入的压缩数据, 不再重复压缩.
+  // 开启后 add_folder_incremental/merge/add_from_reader 原样复制的条目同样可被复用.
+  // 判断重复要先得到文件内容的指纹: 不超过 4 MB 的文件整体读入内存, 只读一次; 更大的文件先完整读一遍计算指纹,
+  // 未命中时压缩再读一遍, 读 IO 约为关闭去重时的两倍(第二遍通常命中页缓存)
+  void set_deduplicate(bool enable);
+
+  // 因去重而跳过压缩的条目数
+  size_t deduplicated_entries() const
+  {
+    return deduplicated_;
+  }
+
+  // 开启/关闭可复现模式: add_folder/add_folder_incremental 按条目名(字节序)排序写入, 之后新压缩的条目
+  // 统一使用固定修改时间(环境变量 SOURCE_DATE_EPOCH, 未设置时为 1980-01-01 00:00:00), 且不记录文件属性,
+  // 相同输入在任何机器、时区和扫描线程数下都得到逐字节相同的 ZIP. 原样复制的条目保留其原有元数据.
+  // 以可复现模式生成的 ZIP 不含真实的修改时间, 基于它的 add_folder_incremental 无法按修改时间跳过未变文件,
+  // 每个大小相同的文件都要完整读出计算 CRC-32(省去的只有压缩), IO 与完整打包相当.
+  // SOURCE_DATE_EPOCH 不是合法的非负整数时抛出 std::invalid_argument
+  void set_reproducible(bool enable);
+
+  bool reproducible() const
+  {
+    return reproducible_;
+  }
 
   // 完成压缩（析构会自动调用）
   void finish();
 
  private:
+  struct DedupIndex;
+
+  // 查找内容相同的已写入条目, 找到时返回 true 并给出其序号; 大小与 CRC-32 相同的原样复制来的条目此时才读回计算指纹
+  bool find_entry(const ContentKey &key, mz_uint &file_index);
+
+  // 查找内容相同的已写入条目, 命中则复制其压缩数据并返回 true. 副本记录 last_modified(为空时为当前时间)
+  // 作为修改时间, 不沿用被复用条目的修改时间与属性
+  bool reuse_entry(const ContentKey &key, const std::string &filename_in_zip, const MZ_TIME_T *last_modified);
+
+  // 开启去重时登记刚从其他 ZIP 原样复制的条目, 之后内容相同的新条目可以复用它
+  void remember_copied_entry();
+
+  // 按 rules 遍历文件夹, 对每个要打包的文件调用 visit(文件, 压缩级别), 级别规则未命中时为 level_.
+  // 可复现模式下先收集完整的遍历结果, 按条目名排序后再调用
+  void scan_folder(const std::string &folder_path, const EntryRules &rules,
+                   const std::function<void(const ScannedFile &, int)> &visit);
+
+  // 以指定级别添加已确认为普通文件的磁盘文件, name 为 ZIP 内条目名
+  void add_file_entry(const std::string &file_path, const std::string &name, int level);
+
+  // 新条目的修改时间: 可复现模式下为固定时间, 否则为空(由调用方决定)
+  MZ_TIME_T *entry_time()
+  {
+    return reproducible_ ? &fixed_time_ : nullptr;
+  }
+
+  // 以指定级别, 按当前字典与去重设置添加内存数据
+  void add_data_entry(const std::string &filename_in_zip, const void *data, size_t size, MZ_TIME_T *last_modified,
+                      int level);
+
+  // 以归档级别压缩内存数据并写入条目
+  void add_archive_entry(const std::string &filename_in_zip, const void *data, size_t size, MZ_TIME_T *last_modified);
+
+  // 以预设字典压缩该条目时传给 miniz 的级别与标志, 不使用字典时返回 0
+  mz_uint dictionary_flags(int level, uint64_t size) const;
+
+  // 从 source 复制第 file_index 个条目为 dst_name, source_dict 为 source 的字典条目内容(没有时为空).
+  // 字典条目每个 ZIP 只能有一个; 依赖字典的条目在两个字典不同时重新压缩, 否则解压时会用错字典
+  void copy_entry(mz_zip_archive *source, mz_uint file_index, const std::string &dst_name,
+                  const std::vector<uint8_t> &source_dict);
+
   mz_zip_archive zip_;
   bool finished_;
+  int level_;
+  std::unique_ptr<DedupIndex> dedup_;  // 为空表示未开启去重
+  size_t deduplicated_;
+  IoOptions io_;
+  bool reproducible_;
+  MZ_TIME_T fixed_time_;                     // 可复现模式下所有新条目的修改时间
+  std::vector<uint8_t> dictionary_;          // set_dictionary 设置的预设字典, 为空表示新条目不使用字典
+  std::vector<uint8_t> archive_dictionary_;  // ZIP 中字典条目的内容(设置、追加模式已有或复制而来), 为空表示没有
 };
 
 }  // namespace zip_compress
@@ -0,0 +1,826 @@
+// 避免 Windows min/max 宏污染
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "archive_deflate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace zip_compress
+{
+
+namespace
+{
+
+const size_t kWindowSize = 32768;  // 树中只保留最近 32KB 的位置, 匹配距离为 1 ~ 32767
+const unsigned kMinMatch = 3;
+const unsigned kMaxMatch = 258;
+const unsigned kMaxSearchDepth = 128;   // 每个位置在二叉树中最多访问的节点数
+const size_t kSegmentSize = 256 * 1024;  // 每次解析的输入长度, 匹配可以引用前一段的数据
+const int kParseIterations = 4;          // 整段的代价模型迭代次数
+const int kBlockIterations = 2;          // 分块后每块按自身统计再迭代的次数
+const size_t kMinBlockItems = 256;       // 分块后每块至少包含的符号数
+const int kMaxSplitDepth = 8;            // 递归分块的最大深度
+const size_t kMaxStoredBlock = 65535;    // 存储块的最大长度
+const double kInfiniteCost = std::numeric_limits<double>::infinity();
+const size_t kNil = static_cast<size_t>(-1);  // 空节点
+const unsigned kHash3Bits = 15;
+const unsigned kHash4Bits = 16;
+
+const unsigned kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const unsigned kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const unsigned kDistBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const unsigned kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+const uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+const unsigned kNumLitLen = 288;  // 含两个不会使用的符号 286/287, 固定哈夫曼码需要
+const unsigned kNumDist = 30;
+const unsigned kEndOfBlock = 256;
+
+// 长度/距离到符号下标的查找表
+struct SymbolTables
+{
+  uint8_t length_index[kMaxMatch + 1];  // 长度 -> 0 ~ 28, 符号为 257 + 下标
+  uint8_t dist_symbol[kWindowSize];     // 距离 -> 0 ~ 29
+
+  SymbolTables()
+  {
+    for (unsigned i = 0; i < 29; ++i)
+    {
+      const unsigned end = i + 1 < 29 ? kLengthBase[i + 1] : kMaxMatch + 1;
+      for (unsigned len = kLengthBase[i]; len < end && len <= kMaxMatch; ++len) length_index[len] = static_cast<uint8_t>(i);
+    }
+    for (unsigned i = 0; i < kNumDist; ++i)
+    {
+      const unsigned end = i + 1 < kNumDist ? kDistBase[i + 1] : kWindowSize;
+      for (unsigned dist = kDistBase[i]; dist < end; ++dist) dist_symbol[dist] = static_cast<uint8_t>(i);
+    }
+  }
+};
+
+const SymbolTables &tables()
+{
+  static const SymbolTables instance;
+  return instance;
+}
+
+uint32_t load32(const uint8_t *p)
+{
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint64_t load64(const uint8_t *p)
+{
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// 解析结果: dist 为 0 时表示字面量 litlen, 否则为长度 litlen、距离 dist 的匹配
+struct Item
+{
+  uint16_t litlen;
+  uint16_t dist;
+};
+
+// 匹配查找结果, 同一位置的多个匹配按长度递增
+struct Match
+{
+  uint16_t len;
+  uint16_t dist;
+};
+
+// 二叉树匹配查找: 4 字节哈希选出一棵按后缀字典序排列的二叉树, 查找时同时把当前位置插入为新的根,
+// 沿途记录每个更长的匹配; 另用 3 字节哈希补充长度为 3 的近距离匹配
+class BinaryTreeMatchFinder
+{
+ public:
+  BinaryTreeMatchFinder(const uint8_t *data, size_t size)
+      : data_(data), size_(size), head3_(1u << kHash3Bits, kNil), head4_(1u << kHash4Bits, kNil), child_(2 * kWindowSize, kNil)
+  {
+  }
+
+  // 查找 pos 处的全部更优匹配并插入 pos, 返回匹配个数(out 至少容纳 kMaxMatch 个)
+  size_t find(size_t pos, Match *out)
+  {
+    return advance(pos, out);
+  }
+
+  // 只插入 pos, 不记录匹配
+  void skip(size_t pos)
+  {
+    advance(pos, nullptr);
+  }
+
+ private:
+  size_t advance(size_t pos, Match *out)
+  {
+    const size_t avail = size_ - pos;
+    if (avail < 4) return 0;  // 末尾不足 4 字节, 无法参与哈希
+
+    const uint8_t *cur = data_ + pos;
+    const uint32_t first4 = load32(cur);
+    const size_t max_len = std::min<size_t>(kMaxMatch, avail);
+    size_t n = 0, best_len = kMinMatch - 1;
+
+    // 长度为 3 的匹配: 二叉树按 4 字节分桶, 单独查一次最近的 3 字节相同位置
+    const uint32_t h3 = ((first4 & 0xFFFFFF) * 2654435761u) >> (32 - kHash3Bits);
+    const size_t cand3 = head3_[h3];
+    head3_[h3] = pos;
+    if (out != nullptr && cand3 != kNil && pos - cand3 < kWindowSize &&
+        (load32(data_ + cand3) & 0xFFFFFF) == (first4 & 0xFFFFFF))
+    {
+      out[n].len = static_cast<uint16_t>(kMinMatch);
+      out[n].dist = static_cast<uint16_t>(pos - cand3);
+      ++n;
+      best_len = kMinMatch;
+    }
+
+    const uint32_t h4 = (first4 * 2654435761u) >> (32 - kHash4Bits);
+    size_t node = head4_[h4];
+    head4_[h4] = pos;
+
+    // 当前位置成为新的根: 小于它的子树挂到左边, 大于它的挂到右边
+    size_t *pending_lt = &child_[2 * (pos & (kWindowSize - 1))];
+    size_t *pending_gt = pending_lt + 1;
+    size_t best_lt_len = 0, best_gt_len = 0, len = 0;
+    unsigned depth = kMaxSearchDepth;
+
+    for (;;)
+    {
+      if (node == kNil || pos - node >= kWindowSize || depth-- == 0)
+      {
+        *pending_lt = kNil;
+        *pending_gt = kNil;
+        return n;
+      }
+
+      const uint8_t *match = data_ + node;
+      if (match[len] == cur[len])
+      {
+        len = extend(cur, match, len + 1, max_len);
+        if (out != nullptr && len > best_len)
+        {
+          best_len = len;
+          out[n].len = static_cast<uint16_t>(len);
+          out[n].dist = static_cast<uint16_t>(pos - node);
+          ++n;
+        }
+        if (len >= max_len)
+        {
+          // 与 node 完全相同(直到可比较的末尾): 直接继承 node 的两棵子树
+          *pending_lt = child_[2 * (node & (kWindowSize - 1))];
+          *pending_gt = child_[2 * (node & (kWindowSize - 1)) + 1];
+          return n;
+        }
+      }
+
+      size_t *node_children = &child_[2 * (node & (kWindowSize - 1))];
+      if (match[len] < cur[len])
+      {
+        *pending_lt = node;
+        pending_lt = node_children + 1;
+        node = *pending_lt;
+        best_lt_len = len;
+        if (best_gt_len < len) len = best_gt_len;
+      }
+      else
+      {
+        *pending_gt = node;
+        pending_gt = node_children;
+        node = *pending_gt;
+        best_gt_len = len;
+        if (best_lt_len < len) len = best_lt_len;
+      }
+    }
+  }
+
+  static size_t extend(const uint8_t *a, const uint8_t *b, size_t len, size_t max_len)
+  {
+    while (len + 8 <= max_len && load64(a + len) == load64(b + len)) len += 8;
+    while (len < max_len && a[len] == b[len]) ++len;
+    return len;
+  }
+
+  const uint8_t *data_;
+  size_t size_;
+  std::vector<size_t> head3_;
+  std::vector<size_t> head4_;
+  std::vector<size_t> child_;  // 每个窗口位置的左右子节点
+};
+
+// 计算限长哈夫曼码长: 先求最优码长, 超过 max_bits 时按 Kraft 不等式调整(与 miniz 的做法相同).
+// 使用到的符号少于 2 个时补足 2 个, 避免单码字的不完整码表被部分解压器拒绝
+void huffman_lengths(const uint32_t *freq, unsigned num_syms, unsigned max_bits, uint8_t *lengths)
+{
+  std::vector<std::pair<uint32_t, unsigned>> syms;  // (频率, 符号), 按频率升序
+  for (unsigned i = 0; i < num_syms; ++i)
+  {
+    lengths[i] = 0;
+    if (freq[i] != 0) syms.push_back(std::make_pair(freq[i], i));
+  }
+  for (unsigned i = 0; syms.size() < 2 && i < num_syms; ++i)
+  {
+    if (freq[i] == 0) syms.push_back(std::make_pair(1u, i));
+  }
+  std::sort(syms.begin(), syms.end());
+
+  // 双队列构造哈夫曼树: 叶子已排序, 内部节点按生成顺序天然有序
+  const size_t num_leaves = syms.size();
+  std::vector<uint64_t> weight(2 * num_leaves - 1);
+  std::vector<size_t> parent(2 * num_leaves - 1, 0);
+  for (size_t i = 0; i < num_leaves; ++i) weight[i] = syms[i].first;
+  size_t next_leaf = 0, next_inner = num_leaves, end_inner = num_leaves;
+  auto take_min = [&]() {
+    if (next_leaf < num_leaves && (next_inner == end_inner || weight[next_leaf] <= weight[next_inner]))
+      return next_leaf++;
+    return next_inner++;
+  };
+  while (end_inner < 2 * num_leaves - 1)
+  {
+    const size_t a = take_min(), b = take_min();
+    weight[end_inner] = weight[a] + weight[b];
+    parent[a] = parent[b] = end_inner;
+    ++end_inner;
+  }
+
+  // 由根向下计算深度, 按深度统计码字个数
+  std::vector<unsigned> depth(2 * num_leaves - 1, 0);
+  unsigned num_codes[64] = {0};
+  for (size_t i = 2 * num_leaves - 1; i-- > 0;)
+  {
+    if (i != 2 * num_leaves - 2) depth[i] = depth[parent[i]] + 1;
+    if (i < num_leaves) ++num_codes[std::min(depth[i], 63u)];
+  }
+
+  for (unsigned i = max_bits + 1; i < 64; ++i)
+  {
+    num_codes[max_bits] += num_codes[i];
+    num_codes[i] = 0;
+  }
+  uint64_t total = 0;
+  for (unsigned i = max_bits; i > 0; --i) total += static_cast<uint64_t>(num_codes[i]) << (max_bits - i);
+  while (total != (1ull << max_bits))
+  {
+    --num_codes[max_bits];
+    for (unsigned i = max_bits - 1; i > 0; --i)
+    {
+      if (num_codes[i] != 0)
+      {
+        --num_codes[i];
+        num_codes[i + 1] += 2;
+        break;
+      }
+    }
+    --total;
+  }
+
+  // 频率越高码长越短
+  size_t j = num_leaves;
+  for (unsigned len = 1; len <= max_bits; ++len)
+  {
+    for (unsigned k = num_codes[len]; k > 0; --k) lengths[syms[--j].second] = static_cast<uint8_t>(len);
+  }
+}
+
+// 由码长生成规范哈夫曼码, 码字已按 deflate 的低位先出顺序反转
+void canonical_codes(const uint8_t *lengths, unsigned num_syms, uint16_t *codes)
+{
+  unsigned count[16] = {0}, next[16] = {0};
+  for (unsigned i = 0; i < num_syms; ++i) ++count[lengths[i]];
+  count[0] = 0;
+  for (unsigned len = 1, code = 0; len < 16; ++len)
+  {
+    code = (code + count[len - 1]) << 1;
+    next[len] = code;
+  }
+  for (unsigned i = 0; i < num_syms; ++i)
+  {
+    const unsigned len = lengths[i];
+    if (len == 0) continue;
+    unsigned code = next[len]++, rev = 0;
+    for (unsigned b = 0; b < len; ++b, code >>= 1) rev = (rev << 1) | (code & 1);
+    codes[i] = static_cast<uint16_t>(rev);
+  }
+}
+
+class BitWriter
+{
+ public:
+  explicit BitWriter(std::vector<uint8_t> &out) : out_(out), buf_(0), count_(0)
+  {
+  }
+
+  void put(uint32_t bits, unsigned n)
+  {
+    buf_ |= static_cast<uint64_t>(bits) << count_;
+    count_ += n;
+    while (count_ >= 8)
+    {
+      out_.push_back(static_cast<uint8_t>(buf_));
+      buf_ >>= 8;
+      count_ -= 8;
+    }
+  }
+
+  // 补齐到字节边界
+  void align()
+  {
+    if (count_ > 0) put(0, 8 - count_);
+  }
+
+ private:
+  std::vector<uint8_t> &out_;
+  uint64_t buf_;
+  unsigned count_;
+};
+
+// 单个块的符号统计、码表与三种编码方式的位数
+struct BlockPlan
+{
+  uint32_t litlen_freq[kNumLitLen];
+  uint32_t dist_freq[kNumDist];
+  uint64_t extra_bits;  // 长度与距离的额外位总数
+  size_t raw_bytes;     // 块覆盖的原始字节数
+
+  uint8_t litlen_len[kNumLitLen];
+  uint8_t dist_len[kNumDist];
+  unsigned num_litlen;  // HLIT + 257
+  unsigned num_dist;    // HDIST + 1
+
+  std::vector<uint16_t> header_syms;  // 码长序列的游程编码: 低 5 位为符号, 高位为额外位取值
+  uint32_t codelen_freq[19];
+  uint8_t codelen_len[19];
+  unsigned num_codelen;  // HCLEN + 4
+
+  uint64_t dynamic_bits;
+  uint64_t fixed_bits;
+  uint64_t stored_bits;
+};
+
+void fixed_lengths(uint8_t *litlen_len, uint8_t *dist_len)
+{
+  for (unsigned i = 0; i < kNumLitLen; ++i) litlen_len[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+  for (unsigned i = 0; i < kNumDist; ++i) dist_len[i] = 5;
+}
+
+void plan_block(const Item *items, size_t count, BlockPlan &plan)
+{
+  const SymbolTables &t = tables();
+  std::memset(plan.litlen_freq, 0, sizeof(plan.litlen_freq));
+  std::memset(plan.dist_freq, 0, sizeof(plan.dist_freq));
+  plan.extra_bits = 0;
+  plan.raw_bytes = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const Item &it = items[i];
+    if (it.dist == 0)
+    {
+      ++plan.litlen_freq[it.litlen];
+      ++plan.raw_bytes;
+      continue;
+    }
+    const unsigned li = t.length_index[it.litlen], di = t.dist_symbol[it.dist];
+    ++plan.litlen_freq[257 + li];
+    ++plan.dist_freq[di];
+    plan.extra_bits += kLengthExtra[li] + kDistExtra[di];
+    plan.raw_bytes += it.litlen;
+  }
+  plan.litlen_freq[kEndOfBlock] = 1;
+
+  huffman_lengths(plan.litlen_freq, 286, 15, plan.litlen_len);
+  plan.litlen_len[286] = plan.litlen_len[287] = 0;
+  huffman_lengths(plan.dist_freq, kNumDist, 15, plan.dist_len);
+  plan.num_litlen = 286;
+  while (plan.num_litlen > 257 && plan.litlen_len[plan.num_litlen - 1] == 0) --plan.num_litlen;
+  plan.num_dist = kNumDist;
+  while (plan.num_dist > 1 && plan.dist_len[plan.num_dist - 1] == 0) --plan.num_dist;
+
+  // 码长序列(字面量/长度表后接距离表)的游程编码: 16 重复前一个 3~6 次, 17/18 为 3~10/11~138 个 0
+  uint8_t all[kNumLitLen + kNumDist];
+  const unsigned total = plan.num_litlen + plan.num_dist;
+  std::memcpy(all, plan.litlen_len, plan.num_litlen);
+  std::memcpy(all + plan.num_litlen, plan.dist_len, plan.num_dist);
+  plan.header_syms.clear();
+  std::memset(plan.codelen_freq, 0, sizeof(plan.codelen_freq));
+  auto emit = [&plan](unsigned sym, unsigned extra) {
+    plan.header_syms.push_back(static_cast<uint16_t>(sym | (extra << 5)));
+    ++plan.codelen_freq[sym];
+  };
+  for (unsigned i = 0; i < total;)
+  {
+    const uint8_t len = all[i];
+    unsigned run = 1;
+    while (i + run < total && all[i + run] == len) ++run;
+    i += run;
+    if (len == 0)
+    {
+      while (run >= 11)
+      {
+        const unsigned n = std::min(run, 138u);
+        emit(18, n - 11);
+        run -= n;
+      }
+      if (run >= 3)
+      {
+        emit(17, run - 3);
+        run = 0;
+      }
+    }
+    else
+    {
+      emit(len, 0);
+      --run;
+      while (run >= 3)
+      {
+        const unsigned n = std::min(run, 6u);
+        emit(16, n - 3);
+        run -= n;
+      }
+    }
+    for (; run > 0; --run) emit(len, 0);
+  }
+  huffman_lengths(plan.codelen_freq, 19, 7, plan.codelen_len);
+  plan.num_codelen = 19;
+  while (plan.num_codelen > 4 && plan.codelen_len[kCodeLengthOrder[plan.num_codelen - 1]] == 0) --plan.num_codelen;
+
+  uint64_t header = 5 + 5 + 4 + 3 * plan.num_codelen;
+  for (unsigned sym = 0; sym < 19; ++sym) header += static_cast<uint64_t>(plan.codelen_freq[sym]) * plan.codelen_len[sym];
+  header += 2 * plan.codelen_freq[16] + 3 * plan.codelen_freq[17] + 7 * plan.codelen_freq[18];
+
+  uint8_t fixed_litlen[kNumLitLen], fixed_dist[kNumDist];
+  fixed_lengths(fixed_litlen, fixed_dist);
+  uint64_t dynamic_data = plan.extra_bits, fixed_data = plan.extra_bits;
+  for (unsigned i = 0; i < kNumLitLen; ++i)
+  {
+    dynamic_data += static_cast<uint64_t>(plan.litlen_freq[i]) * plan.litlen_len[i];
+    fixed_data += static_cast<uint64_t>(plan.litlen_freq[i]) * fixed_litlen[i];
+  }
+  for (unsigned i = 0; i < kNumDist; ++i)
+  {
+    dynamic_data += static_cast<uint64_t>(plan.dist_freq[i]) * plan.dist_len[i];
+    fixed_data += static_cast<uint64_t>(plan.dist_freq[i]) * fixed_dist[i];
+  }
+  plan.dynamic_bits = 3 + header + dynamic_data;
+  plan.fixed_bits = 3 + fixed_data;
+  // 存储块: 每 65535 字节一个块, 块头 3 位 + 对齐(按最坏 7 位) + LEN/NLEN
+  const size_t num_stored = plan.raw_bytes == 0 ? 1 : (plan.raw_bytes + kMaxStoredBlock - 1) / kMaxStoredBlock;
+  plan.stored_bits = num_stored * (3 + 7 + 32) + 8 * static_cast<uint64_t>(plan.raw_bytes);
+}
+
+uint64_t block_cost(const Item *items, size_t count, BlockPlan &plan)
+{
+  plan_block(items, count, plan);
+  return std::min(plan.dynamic_bits, std::min(plan.fixed_bits, plan.stored_bits));
+}
+
+// 以位为单位的符号代价, 由上一轮解析的符号统计得到
+struct CostModel
+{
+  double literal[256];
+  double length[kMaxMatch + 1];  // 含额外位
+  double dist_symbol[kNumDist];  // 含额外位
+
+  // 第一轮使用固定哈夫曼码的代价
+  static CostModel fixed()
+  {
+    uint8_t litlen_len[kNumLitLen], dist_len[kNumDist];
+    fixed_lengths(litlen_len, dist_len);
+    double litlen_cost[kNumLitLen], dist_cost[kNumDist];
+    for (unsigned i = 0; i < kNumLitLen; ++i) litlen_cost[i] = litlen_len[i];
+    for (unsigned i = 0; i < kNumDist; ++i) dist_cost[i] = dist_len[i];
+    return CostModel(litlen_cost, dist_cost);
+  }
+
+  // 代价取 -log2(出现概率), 未出现的符号按出现 1 次估计
+  static CostModel from_stats(const BlockPlan &plan)
+  {
+    double litlen_cost[kNumLitLen], dist_cost[kNumDist];
+    entropy(plan.litlen_freq, kNumLitLen, litlen_cost);
+    entropy(plan.dist_freq, kNumDist, dist_cost);
+    return CostModel(litlen_cost, dist_cost);
+  }
+
+  double distance(unsigned dist) const
+  {
+    return dist_symbol[tables().dist_symbol[dist]];
+  }
+
+ private:
+  CostModel(const double *litlen_cost, const double *dist_cost)
+  {
+    const SymbolTables &t = tables();
+    for (unsigned i = 0; i < 256; ++i) literal[i] = litlen_cost[i];
+    for (unsigned len = kMinMatch; len <= kMaxMatch; ++len)
+    {
+      const unsigned li = t.length_index[len];
+      length[len] = litlen_cost[257 + li] + kLengthExtra[li];
+    }
+    for (unsigned i = 0; i < kNumDist; ++i) dist_symbol[i] = dist_cost[i] + kDistExtra[i];
+  }
+
+  static void entropy(const uint32_t *freq, unsigned num_syms, double *cost)
+  {
+    uint64_t total = 0;
+    for (unsigned i = 0; i < num_syms; ++i) total += freq[i];
+    const double log_total = total == 0 ? 0.0 : std::log2(static_cast<double>(total));
+    for (unsigned i = 0; i < num_syms; ++i) cost[i] = log_total - (freq[i] > 1 ? std::log2(static_cast<double>(freq[i])) : 0.0);
+  }
+};
+
+class ArchiveDeflater
+{
+ public:
+  ArchiveDeflater(const uint8_t *data, size_t size) : data_(data), size_(size), finder_(data, size), next_insert_(0)
+  {
+  }
+
+  std::vector<uint8_t> run()
+  {
+    std::vector<uint8_t> out;
+    out.reserve(size_ / 3 + 64);
+    BitWriter writer(out);
+    if (size_ == 0)
+    {
+      write_block(writer, nullptr, 0, 0, true);
+    }
+    for (size_t seg_begin = 0; seg_begin < size_; seg_begin += kSegmentSize)
+    {
+      const size_t seg_end = std::min(size_, seg_begin + kSegmentSize);
+      compress_segment(writer, seg_begin, seg_end, seg_end == size_);
+    }
+    writer.align();
+    return out;
+  }
+
+ private:
+  void compress_segment(BitWriter &writer, size_t seg_begin, size_t seg_end, bool last)
+  {
+    find_matches(seg_begin, seg_end);
+
+    // 迭代: 用上一轮结果的符号统计作为代价模型重新解析, 保留编码后最小的一轮
+    BlockPlan plan;
+    CostModel model = CostModel::fixed();
+    std::vector<Item> best, items;
+    uint64_t best_bits = std::numeric_limits<uint64_t>::max();
+    for (int i = 0; i < kParseIterations; ++i)
+    {
+      parse(model, seg_begin, seg_end, items);
+      const uint64_t bits = block_cost(items.data(), items.size(), plan);
+      if (bits < best_bits)
+      {
+        best_bits = bits;
+        best.swap(items);
+      }
+      model = CostModel::from_stats(plan);
+    }
+
+    // 在符号序列上寻找分块点, 各块使用自己的码表
+    std::vector<size_t> splits;
+    split(best, 0, best.size(), 0, splits);
+    splits.push_back(best.size());
+
+    size_t item_begin = 0, byte_begin = seg_begin;
+    for (size_t s = 0; s < splits.size(); ++s)
+    {
+      const size_t item_end = splits[s];
+      size_t byte_end = byte_begin;
+      for (size_t i = item_begin; i < item_end; ++i) byte_end += best[i].dist == 0 ? 1 : best[i].litlen;
+
+      // 按本块的统计继续迭代, 更小则采用
+      std::vector<Item> block(best.begin() + item_begin, best.begin() + item_end);
+      uint64_t bits = block_cost(block.data(), block.size(), plan);
+      for (int i = 0; i < kBlockIterations; ++i)
+      {
+        parse(CostModel::from_stats(plan), byte_begin, byte_end, items);
+        const uint64_t new_bits = block_cost(items.data(), items.size(), plan);
+        if (new_bits >= bits) break;
+        bits = new_bits;
+        block.swap(items);
+      }
+      write_block(writer, block.data(), block.size(), byte_begin, last && s + 1 == splits.size());
+
+      item_begin = item_end;
+      byte_begin = byte_end;
+    }
+  }
+
+  // 为 [seg_begin, seg_end) 的每个位置查找匹配, 结果缓存供多轮解析使用
+  void find_matches(size_t seg_begin, size_t seg_end)
+  {
+    cache_.clear();
+    offsets_.assign(seg_end - seg_begin + 1, 0);
+    Match found[kMaxMatch];
+    for (size_t pos = seg_begin; pos < seg_end; ++pos)
+    {
+      offsets_[pos - seg_begin] = cache_.size();
+      if (pos < next_insert_) continue;  // 已在长匹配内跳过
+
+      const size_t n = finder_.find(pos, found);
+      cache_.insert(cache_.end(), found, found + n);
+      next_insert_ = pos + 1;
+
+      // 最长可能的匹配: 其覆盖的位置只插入不再查找, 避免长重复数据退化为平方复杂度
+      if (n > 0 && found[n - 1].len == kMaxMatch)
+      {
+        const size_t end = std::min(seg_end, pos + kMaxMatch);
+        for (size_t p = pos + 1; p < end; ++p) finder_.skip(p);
+        next_insert_ = end;
+      }
+    }
+    offsets_[seg_end - seg_begin] = cache_.size();
+    seg_begin_ = seg_begin;
+  }
+
+  // 最短路径解析: cost[i] 为编码前 i 字节的最小位数, 每个位置尝试字面量与所有匹配的所有长度
+  void parse(const CostModel &model, size_t begin, size_t end, std::vector<Item> &items)
+  {
+    const size_t n = end - begin;
+    cost_.assign(n + 1, kInfiniteCost);
+    from_.resize(n + 1);
+    cost_[0] = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      const double base = cost_[i];
+      const size_t pos = begin + i;
+      const double lit = base + model.literal[data_[pos]];
+      if (lit < cost_[i + 1])
+      {
+        cost_[i + 1] = lit;
+        from_[i + 1].litlen = 1;
+        from_[i + 1].dist = 0;
+      }
+
+      const size_t limit = end - pos;
+      const Match *m = cache_.data() + offsets_[pos - seg_begin_];
+      const Match *m_end = cache_.data() + offsets_[pos - seg_begin_ + 1];
+      unsigned len = kMinMatch;
+      for (; m != m_end && len <= limit; ++m)
+      {
+        const double with_dist = base + model.distance(m->dist);
+        const unsigned max_len = static_cast<unsigned>(std::min<size_t>(m->len, limit));
+        for (; len <= max_len; ++len)
+        {
+          const double c = with_dist + model.length[len];
+          if (c < cost_[i + len])
+          {
+            cost_[i + len] = c;
+            from_[i + len].litlen = static_cast<uint16_t>(len);
+            from_[i + len].dist = m->dist;
+          }
+        }
+      }
+    }
+
+    items.clear();
+    for (size_t i = n; i > 0;)
+    {
+      Item it = from_[i];
+      i -= it.litlen;
+      if (it.dist == 0) it.litlen = data_[begin + i];
+      items.push_back(it);
+    }
+    std::reverse(items.begin(), items.end());
+  }
+
+  // 递归二分: 在 [a, b) 中寻找使两块总位数最小的分割点(逐步缩小的等距采样), 有收益才分割
+  void split(const std::vector<Item> &items, size_t a, size_t b, int depth, std::vector<size_t> &splits)
+  {
+    if (depth >= kMaxSplitDepth || b - a < 2 * kMinBlockItems) return;
+
+    BlockPlan plan;
+    auto cost_at = [&](size_t s) {
+      return block_cost(items.data() + a, s - a, plan) + block_cost(items.data() + s, b - s, plan);
+    };
+
+    size_t lo = a + kMinBlockItems, hi = b - kMinBlockItems;
+    size_t best_split = lo;
+    uint64_t best = std::numeric_limits<uint64_t>::max();
+    const size_t kSamples = 9;
+    for (;;)
+    {
+      const size_t step = std::max<size_t>(1, (hi - lo) / (kSamples + 1));
+      for (size_t k = 0; k < kSamples; ++k)
+      {
+        const size_t s = std::min(hi, lo + step * (k + 1));
+        const uint64_t c = cost_at(s);
+        if (c < best)
+        {
+          best = c;
+          best_split = s;
+        }
+      }
+      if (step <= 16) break;
+      // 以当前最优点为中心缩小区间
+      lo = std::max(lo, best_split - step);
+      hi = std::min(hi, best_split + step);
+    }
+
+    if (best >= block_cost(items.data() + a, b - a, plan)) return;
+    split(items, a, best_split, depth + 1, splits);
+    splits.push_back(best_split);
+    split(items, best_split, b, depth + 1, splits);
+  }
+
+  void write_block(BitWriter &writer, const Item *items, size_t count, size_t byte_begin, bool final)
+  {
+    BlockPlan plan;
+    plan_block(items, count, plan);
+
+    if (plan.stored_bits < plan.dynamic_bits && plan.stored_bits < plan.fixed_bits)
+    {
+      size_t pos = byte_begin, left = plan.raw_bytes;
+      do
+      {
+        const size_t n = std::min(left, kMaxStoredBlock);
+        left -= n;
+        writer.put(final && left == 0 ? 1 : 0, 1);
+        writer.put(0, 2);
+        writer.align();
+        writer.put(static_cast<uint32_t>(n), 16);
+        writer.put(static_cast<uint32_t>(~n & 0xFFFF), 16);
+        for (size_t i = 0; i < n; ++i) writer.put(data_[pos + i], 8);
+        pos += n;
+      } while (left > 0);
+      return;
+    }
+
+    uint8_t litlen_len[kNumLitLen], dist_len[kNumDist];
+    writer.put(final ? 1 : 0, 1);
+    if (plan.fixed_bits <= plan.dynamic_bits)
+    {
+      writer.put(1, 2);
+      fixed_lengths(litlen_len, dist_len);
+    }
+    else
+    {
+      writer.put(2, 2);
+      std::memcpy(litlen_len, plan.litlen_len, sizeof(litlen_len));
+      std::memcpy(dist_len, plan.dist_len, sizeof(dist_len));
+
+      uint16_t codelen_code[19];
+      canonical_codes(plan.codelen_len, 19, codelen_code);
+      writer.put(plan.num_litlen - 257, 5);
+      writer.put(plan.num_dist - 1, 5);
+      writer.put(plan.num_codelen - 4, 4);
+      for (unsigned i = 0; i < plan.num_codelen; ++i) writer.put(plan.codelen_len[kCodeLengthOrder[i]], 3);
+      for (size_t i = 0; i < plan.header_syms.size(); ++i)
+      {
+        const unsigned sym = plan.header_syms[i] & 31, extra = plan.header_syms[i] >> 5;
+        writer.put(codelen_code[sym], plan.codelen_len[sym]);
+        if (sym == 16) writer.put(extra, 2);
+        if (sym == 17) writer.put(extra, 3);
+        if (sym == 18) writer.put(extra, 7);
+      }
+    }
+
+    uint16_t litlen_code[kNumLitLen], dist_code[kNumDist];
+    canonical_codes(litlen_len, kNumLitLen, litlen_code);
+    canonical_codes(dist_len, kNumDist, dist_code);
+    const SymbolTables &t = tables();
+    for (size_t i = 0; i < count; ++i)
+    {
+      const Item &it = items[i];
+      if (it.dist == 0)
+      {
+        writer.put(litlen_code[it.litlen], litlen_len[it.litlen]);
+        continue;
+      }
+      const unsigned li = t.length_index[it.litlen], di = t.dist_symbol[it.dist];
+      writer.put(litlen_code[257 + li], litlen_len[257 + li]);
+      writer.put(it.litlen - kLengthBase[li], kLengthExtra[li]);
+      writer.put(dist_code[di], dist_len[di]);
+      writer.put(it.dist - kDistBase[di], kDistExtra[di]);
+    }
+    writer.put(litlen_code[kEndOfBlock], litlen_len[kEndOfBlock]);
+  }
+
+  const uint8_t *data_;
+  size_t size_;
+  BinaryTreeMatchFinder finder_;
+  size_t next_insert_;  // 下一个需要插入二叉树的位置
+
+  size_t seg_begin_;
+  std::vector<Match> cache_;     // 当前段所有位置的匹配
+  std::vector<size_t> offsets_;  // 每个位置的匹配在 cache_ 中的起点
+  std::vector<double> cost_;
+  std::vector<Item> from_;
+};
+
+}  // namespace
+
+std::vector<uint8_t> archive_deflate(const uint8_t *data, size_t size)
+{
+  ArchiveDeflater deflater(data, size);
+  return deflater.run();
+}
+
+}  // namespace zip_compress
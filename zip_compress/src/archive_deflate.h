@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file archive_deflate.h
+ * @brief 归档级别的 deflate 压缩: 二叉树匹配查找 + 迭代代价模型的近似最优解析 + 分块
+ * @author abin
+ * @date 2025-12-12
+ */
+
+#ifndef __GUARD_ARCHIVE_DEFLATE_H_INCLUDE_GUARD__
+#define __GUARD_ARCHIVE_DEFLATE_H_INCLUDE_GUARD__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zip_compress
+{
+
+// 将 data 压缩为原始 deflate 流(无 zlib 头), 任何标准 inflate 都可以解压.
+// 比 MZ_UBER_COMPRESSION 慢数倍, 适合冷归档; 输入需整体位于内存中
+std::vector<uint8_t> archive_deflate(const uint8_t *data, size_t size);
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_ARCHIVE_DEFLATE_H_INCLUDE_GUARD__
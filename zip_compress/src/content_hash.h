@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file content_hash.h
+ * @brief 条目内容指纹(大小 + CRC-32 + XXH64), 供去重与增量重建使用
+ * @author abin
+ * @date 2025-12-10
+ */
+
+#ifndef __GUARD_CONTENT_HASH_H_INCLUDE_GUARD__
+#define __GUARD_CONTENT_HASH_H_INCLUDE_GUARD__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#include "miniz.h"
+
+namespace zip_compress
+{
+
+// 内容指纹: 三者同时相同才视为内容相同
+struct ContentKey
+{
+  uint64_t size;
+  uint32_t crc32;
+  uint64_t hash;
+
+  bool operator==(const ContentKey &other) const
+  {
+    return size == other.size && crc32 == other.crc32 && hash == other.hash;
+  }
+};
+
+struct ContentKeyHash
+{
+  size_t operator()(const ContentKey &key) const
+  {
+    return std::hash<uint64_t>()(key.hash ^ (static_cast<uint64_t>(key.crc32) << 32) ^ key.size);
+  }
+};
+
+// 流式计算内容指纹, 哈希部分为 XXH64(seed = 0)
+class ContentHasher
+{
+ public:
+  ContentHasher() : buf_len_(0), total_(0), crc32_(MZ_CRC32_INIT)
+  {
+    v_[0] = kPrime1 + kPrime2;
+    v_[1] = kPrime2;
+    v_[2] = 0;
+    v_[3] = 0 - kPrime1;
+  }
+
+  void update(const void *data, size_t len)
+  {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc32_ = static_cast<uint32_t>(mz_crc32(crc32_, p, len));
+    total_ += len;
+
+    // 先补齐上次遗留的不完整分块
+    if (buf_len_ != 0)
+    {
+      size_t n = len < sizeof(buf_) - buf_len_ ? len : sizeof(buf_) - buf_len_;
+      std::memcpy(buf_ + buf_len_, p, n);
+      buf_len_ += n;
+      p += n;
+      len -= n;
+      if (buf_len_ < sizeof(buf_)) return;
+      consume_stripe(buf_);
+      buf_len_ = 0;
+    }
+
+    for (; len >= sizeof(buf_); p += sizeof(buf_), len -= sizeof(buf_)) consume_stripe(p);
+
+    std::memcpy(buf_, p, len);
+    buf_len_ = len;
+  }
+
+  ContentKey digest() const
+  {
+    uint64_t h;
+    if (total_ >= sizeof(buf_))
+    {
+      h = rotl(v_[0], 1) + rotl(v_[1], 7) + rotl(v_[2], 12) + rotl(v_[3], 18);
+      for (int i = 0; i < 4; ++i)
+      {
+        h ^= round(0, v_[i]);
+        h = h * kPrime1 + kPrime4;
+      }
+    }
+    else
+    {
+      h = kPrime5;
+    }
+    h += total_;
+
+    const uint8_t *p = buf_;
+    size_t len = buf_len_;
+    for (; len >= 8; p += 8, len -= 8)
+    {
+      h ^= round(0, read64(p));
+      h = rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (len >= 4)
+    {
+      h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+      h = rotl(h, 23) * kPrime2 + kPrime3;
+      p += 4;
+      len -= 4;
+    }
+    for (; len > 0; ++p, --len)
+    {
+      h ^= *p * kPrime5;
+      h = rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+
+    ContentKey key;
+    key.size = total_;
+    key.crc32 = crc32_;
+    key.hash = h;
+    return key;
+  }
+
+  // 一次性计算内存块的指纹
+  static ContentKey of(const void *data, size_t len)
+  {
+    ContentHasher hasher;
+    hasher.update(data, len);
+    return hasher.digest();
+  }
+
+ private:
+  static const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+  static const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+  static const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+  static const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+  static const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+  static uint64_t rotl(uint64_t x, int r)
+  {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  static uint64_t round(uint64_t acc, uint64_t input)
+  {
+    acc += input * kPrime2;
+    return rotl(acc, 31) * kPrime1;
+  }
+
+  static uint64_t read64(const uint8_t *p)
+  {
+    return static_cast<uint64_t>(read32(p)) | (static_cast<uint64_t>(read32(p + 4)) << 32);
+  }
+
+  static uint32_t read32(const uint8_t *p)
+  {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  void consume_stripe(const uint8_t *p)
+  {
+    for (int i = 0; i < 4; ++i) v_[i] = round(v_[i], read64(p + 8 * i));
+  }
+
+  uint64_t v_[4];
+  uint8_t buf_[32];
+  size_t buf_len_;
+  uint64_t total_;
+  uint32_t crc32_;
+};
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_CONTENT_HASH_H_INCLUDE_GUARD__
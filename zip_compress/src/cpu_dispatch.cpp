@@ -0,0 +1,148 @@
+// 避免 Windows min/max 宏污染
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "zip_compress/cpu_dispatch.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ZIP_COMPRESS_CPU_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__arm__)
+#define ZIP_COMPRESS_CPU_ARM 1
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace zip_compress
+{
+
+namespace
+{
+
+#if defined(ZIP_COMPRESS_CPU_X86)
+void cpuid(unsigned int leaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, static_cast<int>(leaf), 0);
+  for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(info[i]);
+#else
+  __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// OS 是否保存 YMM 寄存器(XCR0 的 SSE 与 AVX 位)
+bool os_saves_ymm()
+{
+#if defined(_MSC_VER)
+  return (_xgetbv(0) & 6) == 6;
+#else
+  unsigned int lo, hi;
+  __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  return (lo & 6) == 6;
+#endif
+}
+
+unsigned int detect_features()
+{
+  unsigned int regs[4];
+  cpuid(0, regs);
+  const unsigned int max_leaf = regs[0];
+  if (max_leaf < 1) return 0;
+
+  unsigned int features = 0;
+  cpuid(1, regs);
+  if (regs[3] & (1u << 26)) features |= MZ_CPU_SSE2;
+  if (regs[2] & (1u << 1)) features |= MZ_CPU_PCLMUL;
+  // AVX2 还需要 OSXSAVE + AVX 且操作系统开启了 YMM 状态保存
+  const bool avx_usable = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && os_saves_ymm();
+  if (avx_usable && max_leaf >= 7)
+  {
+    cpuid(7, regs);
+    if (regs[1] & (1u << 5)) features |= MZ_CPU_AVX2;
+  }
+  return features;
+}
+#elif defined(ZIP_COMPRESS_CPU_ARM)
+unsigned int detect_features()
+{
+#if defined(_WIN32)
+  // Windows on ARM 总是具备 NEON
+  unsigned int features = MZ_CPU_NEON;
+  if (IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE)) features |= MZ_CPU_ARM_CRC32;
+  return features;
+#elif defined(__APPLE__)
+  // Apple 的 arm64 处理器都具备 NEON 与 CRC32 指令
+  return MZ_CPU_NEON | MZ_CPU_ARM_CRC32;
+#elif defined(__linux__) && defined(__aarch64__)
+  const unsigned long hwcap = getauxval(AT_HWCAP);
+  unsigned int features = 0;
+  if (hwcap & (1ul << 1)) features |= MZ_CPU_NEON;       // HWCAP_ASIMD
+  if (hwcap & (1ul << 7)) features |= MZ_CPU_ARM_CRC32;  // HWCAP_CRC32
+  return features;
+#elif defined(__linux__)
+  unsigned int features = 0;
+  if (getauxval(AT_HWCAP) & (1ul << 12)) features |= MZ_CPU_NEON;        // HWCAP_NEON
+  if (getauxval(AT_HWCAP2) & (1ul << 4)) features |= MZ_CPU_ARM_CRC32;  // HWCAP2_CRC32
+  return features;
+#else
+  // 无法查询时只信任编译器已经默认启用的特性
+#if defined(__aarch64__) || defined(__ARM_NEON)
+  unsigned int features = MZ_CPU_NEON;
+#else
+  unsigned int features = 0;
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+  features |= MZ_CPU_ARM_CRC32;
+#endif
+  return features;
+#endif
+}
+#else
+unsigned int detect_features()
+{
+  return 0;
+}
+#endif
+
+bool force_scalar_requested()
+{
+  const char *value = std::getenv("ZIP_COMPRESS_FORCE_SCALAR");
+  return value != nullptr && value[0] != '\0' && std::strcmp(value, "0") != 0;
+}
+
+CpuDispatch bind_kernels()
+{
+  CpuDispatch dispatch;
+  dispatch.detected = detect_features();
+  dispatch.force_scalar = force_scalar_requested();
+  dispatch.enabled = dispatch.force_scalar ? 0 : (dispatch.detected & mz_supported_cpu_features());
+  mz_set_cpu_features(dispatch.enabled);
+  dispatch.crc32 = mz_kernel_name(mz_crc32_kernel());
+  dispatch.adler32 = mz_kernel_name(mz_adler32_kernel());
+  dispatch.match_len = mz_kernel_name(mz_match_len_kernel());
+  dispatch.inflate_copy = mz_kernel_name(mz_inflate_copy_kernel());
+  return dispatch;
+}
+
+}  // namespace
+
+const CpuDispatch &cpu_dispatch()
+{
+  // C++11 保证局部静态变量只初始化一次且线程安全
+  static const CpuDispatch dispatch = bind_kernels();
+  return dispatch;
+}
+
+}  // namespace zip_compress
@@ -0,0 +1,144 @@
+// 避免 Windows min/max 宏污染
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "dictionary_trainer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+namespace zip_compress
+{
+
+namespace
+{
+
+const size_t kKmer = 8;                 // 统计共有内容的片段长度
+const size_t kSegment = 64;             // 候选段长度
+const size_t kStride = 16;              // 候选段起点间隔
+const size_t kMaxTrainBytes = 8 << 20;  // 参与训练的样本数据上限
+
+// 片段 -> 包含它的样本数; 被选中的段覆盖的片段从表中删除, 不再计分
+using KmerCounts = std::unordered_map<uint64_t, uint32_t>;
+
+struct Candidate
+{
+  uint64_t score;
+  uint32_t sample;
+  uint32_t offset;
+  uint32_t size;
+};
+
+// 得分相同时先取靠前的段, 结果与哈希表的遍历顺序无关
+struct CandidateLess
+{
+  bool operator()(const Candidate &a, const Candidate &b) const
+  {
+    if (a.score != b.score) return a.score < b.score;
+    if (a.sample != b.sample) return a.sample > b.sample;
+    return a.offset > b.offset;
+  }
+};
+
+uint64_t kmer_at(const char *p)
+{
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// 段内尚未覆盖、且至少出现在两个样本中的片段的样本数之和, 段内重复的片段只计一次
+uint64_t segment_score(const char *p, size_t size, const KmerCounts &counts, std::vector<uint64_t> &seen)
+{
+  seen.clear();
+  uint64_t score = 0;
+  for (size_t i = 0; i + kKmer <= size; ++i)
+  {
+    const uint64_t kmer = kmer_at(p + i);
+    const auto it = counts.find(kmer);
+    if (it == counts.end() || it->second < 2) continue;
+    if (std::find(seen.begin(), seen.end(), kmer) != seen.end()) continue;
+    seen.push_back(kmer);
+    score += it->second;
+  }
+  return score;
+}
+
+}  // namespace
+
+std::vector<uint8_t> train_dictionary(const std::vector<std::string> &samples, size_t dict_size)
+{
+  // 每个样本参与训练的前缀长度
+  std::vector<size_t> lengths(samples.size());
+  size_t budget = kMaxTrainBytes;
+  for (size_t s = 0; s < samples.size(); ++s)
+  {
+    lengths[s] = std::min(samples[s].size(), budget);
+    budget -= lengths[s];
+  }
+
+  // 按样本去重后计数: 所有样本都有的片段最值得放进字典, 单个样本内反复出现的片段它自己就能匹配
+  KmerCounts counts;
+  std::vector<uint64_t> kmers;
+  for (size_t s = 0; s < samples.size(); ++s)
+  {
+    if (lengths[s] < kKmer) continue;
+    kmers.clear();
+    for (size_t i = 0; i + kKmer <= lengths[s]; ++i) kmers.push_back(kmer_at(samples[s].data() + i));
+    std::sort(kmers.begin(), kmers.end());
+    kmers.erase(std::unique(kmers.begin(), kmers.end()), kmers.end());
+    for (const uint64_t kmer : kmers) ++counts[kmer];
+  }
+
+  std::priority_queue<Candidate, std::vector<Candidate>, CandidateLess> heap;
+  std::vector<uint64_t> seen;
+  for (size_t s = 0; s < samples.size(); ++s)
+  {
+    for (size_t offset = 0; offset + kKmer <= lengths[s]; offset += kStride)
+    {
+      const size_t size = std::min(kSegment, lengths[s] - offset);
+      const uint64_t score = segment_score(samples[s].data() + offset, size, counts, seen);
+      if (score == 0) continue;
+      heap.push(Candidate{score, static_cast<uint32_t>(s), static_cast<uint32_t>(offset),
+                          static_cast<uint32_t>(size)});
+    }
+  }
+
+  // 惰性贪心: 得分只会因覆盖而下降, 重新计算后仍不低于记录值的堆顶就是当前最优段
+  std::vector<Candidate> chosen;
+  size_t total = 0;
+  while (total < dict_size && !heap.empty())
+  {
+    Candidate top = heap.top();
+    heap.pop();
+    const char *p = samples[top.sample].data() + top.offset;
+    const uint64_t score = segment_score(p, top.size, counts, seen);
+    if (score == 0) continue;
+    if (score < top.score)
+    {
+      top.score = score;
+      heap.push(top);
+      continue;
+    }
+
+    chosen.push_back(top);
+    total += top.size;
+    for (size_t i = 0; i + kKmer <= top.size; ++i) counts.erase(kmer_at(p + i));
+  }
+
+  // 先选中的段放在最后; 超出大小时从开头截掉得分最低的部分
+  std::vector<uint8_t> dict;
+  dict.reserve(total);
+  for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+  {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(samples[it->sample].data()) + it->offset;
+    dict.insert(dict.end(), p, p + it->size);
+  }
+  if (dict.size() > dict_size) dict.erase(dict.begin(), dict.begin() + (dict.size() - dict_size));
+  return dict;
+}
+
+}  // namespace zip_compress
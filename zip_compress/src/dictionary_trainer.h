@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file dictionary_trainer.h
+ * @brief 从样本数据训练 deflate 预设字典: 按出现在多少个样本中统计 8 字节片段, 贪心挑选覆盖最多共有片段的数据段
+ * @author abin
+ * @date 2025-12-20
+ */
+
+#ifndef __GUARD_DICTIONARY_TRAINER_H_INCLUDE_GUARD__
+#define __GUARD_DICTIONARY_TRAINER_H_INCLUDE_GUARD__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace zip_compress
+{
+
+// 训练不超过 dict_size 字节的字典. 得分越高的段放得越靠后, 匹配距离越近编码越短.
+// 只使用前 8 MB 样本; 样本之间没有共有内容时返回空
+std::vector<uint8_t> train_dictionary(const std::vector<std::string> &samples, size_t dict_size);
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_DICTIONARY_TRAINER_H_INCLUDE_GUARD__
@@ -0,0 +1,228 @@
+// 避免 Windows min/max 宏污染
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "dir_scanner.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+// 引入 filesystem 库, 优先使用标准库, 其次使用 ghc::filesystem 作为替代
+#if defined(_MSC_VER)
+#if _MSVC_LANG >= 201703L && __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include "ghc/filesystem.hpp"
+namespace fs = ghc::filesystem;
+#endif
+#else
+#if __cplusplus >= 201703L && __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include "ghc/filesystem.hpp"
+namespace fs = ghc::filesystem;
+#endif
+#endif
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace zip_compress
+{
+
+namespace
+{
+
+const size_t kMaxQueuedFiles = 4096;  // 已发现未被取走的文件数上限
+
+}  // namespace
+
+DirScanner::DirScanner(const std::string &root, size_t threads, const ScanFilter &filter)
+    : root_(root), filter_(filter), pending_(1), queued_(1), stop_(false)
+{
+  if (threads == 0) threads = 1;
+  for (size_t i = 0; i < threads; ++i) queues_.emplace_back(new WorkQueue());
+  queues_[0]->dirs.push_back(std::string());  // 根目录
+  for (size_t i = 0; i < threads; ++i) threads_.emplace_back(&DirScanner::worker, this, i);
+}
+
+DirScanner::~DirScanner()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  files_cv_.notify_all();  // 唤醒等待队列空位的扫描线程
+  for (auto &thread : threads_) thread.join();
+}
+
+size_t DirScanner::default_threads()
+{
+  const size_t n = std::thread::hardware_concurrency();
+  return n == 0 ? 1 : std::min<size_t>(n, 8);
+}
+
+bool DirScanner::next(ScannedFile &file)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  files_cv_.wait(lock, [this]() { return !files_.empty() || pending_ == 0 || error_; });
+  if (error_) std::rethrow_exception(error_);
+  if (files_.empty()) return false;
+  const bool was_full = files_.size() >= kMaxQueuedFiles;
+  file = std::move(files_.front());
+  files_.pop_front();
+  lock.unlock();
+  if (was_full) files_cv_.notify_all();
+  return true;
+}
+
+void DirScanner::worker(size_t id)
+{
+  for (;;)
+  {
+    std::string dir;
+    if (take_directory(id, dir))
+    {
+      try
+      {
+        scan_directory(id, dir);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+        stop_ = true;
+      }
+
+      bool finished;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished = --pending_ == 0 || stop_;
+      }
+      if (finished)
+      {
+        work_cv_.notify_all();
+        files_cv_.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_cv_.wait(lock, [this]() { return stop_ || pending_ == 0 || queued_ > 0; });
+    if (stop_ || pending_ == 0) return;
+  }
+}
+
+bool DirScanner::take_directory(size_t id, std::string &dir)
+{
+  // 先取自己队列尾部(深度优先, 局部性好), 再从其他队列头部窃取(较浅的目录, 子树更大)
+  for (size_t k = 0; k < queues_.size(); ++k)
+  {
+    WorkQueue &queue = *queues_[(id + k) % queues_.size()];
+    std::lock_guard<std::mutex> queue_lock(queue.mutex);
+    if (queue.dirs.empty()) continue;
+    if (k == 0)
+    {
+      dir = std::move(queue.dirs.back());
+      queue.dirs.pop_back();
+    }
+    else
+    {
+      dir = std::move(queue.dirs.front());
+      queue.dirs.pop_front();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    --queued_;
+    return !stop_;  // 已停止(出错或析构)时不再扫描
+  }
+  return false;
+}
+
+void DirScanner::push_directory(size_t id, const std::string &dir)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pending_;
+    ++queued_;
+  }
+  {
+    std::lock_guard<std::mutex> queue_lock(queues_[id]->mutex);
+    queues_[id]->dirs.push_back(dir);
+  }
+  work_cv_.notify_one();
+}
+
+void DirScanner::scan_directory(size_t id, const std::string &dir)
+{
+  std::vector<ScannedFile> found;
+
+#ifdef _WIN32
+  const fs::path base = dir.empty() ? fs::path(root_) : fs::path(root_) / dir;
+  for (const auto &entry : fs::directory_iterator(base))
+  {
+    const std::string name = dir.empty() ? entry.path().filename().string() : (fs::path(dir) / entry.path().filename()).string();
+    // Windows 的目录项自带属性, 这里不会产生额外的 stat
+    if (entry.is_directory() && !entry.is_symlink())
+    {
+      if (accepts(name, true)) push_directory(id, name);
+    }
+    else if (entry.is_regular_file() && accepts(name, false))
+    {
+      found.push_back(ScannedFile{entry.path().string(), name});
+    }
+  }
+#else
+  const std::string base = dir.empty() ? root_ : root_ + "/" + dir;
+  std::unique_ptr<DIR, int (*)(DIR *)> handle(opendir(base.c_str()), closedir);
+  if (!handle) throw std::runtime_error("Failed to open directory: " + base);
+
+  while (struct dirent *ent = readdir(handle.get()))
+  {
+    const char *entry_name = ent->d_name;
+    if (entry_name[0] == '.' && (entry_name[1] == '\0' || (entry_name[1] == '.' && entry_name[2] == '\0'))) continue;
+
+    const std::string path = base + "/" + entry_name;
+    const std::string name = dir.empty() ? std::string(entry_name) : dir + "/" + entry_name;
+
+    // 多数文件系统在 d_type 中给出类型, 只有未知类型和符号链接才需要 stat
+    unsigned char type = ent->d_type;
+    struct stat st;
+    if (type == DT_UNKNOWN)
+    {
+      if (lstat(path.c_str(), &st) != 0) continue;
+      type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+    }
+
+    if (type == DT_DIR)
+    {
+      if (accepts(name, true)) push_directory(id, name);
+    }
+    else if ((type == DT_REG || (type == DT_LNK && stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))) &&
+             accepts(name, false))
+    {
+      found.push_back(ScannedFile{path, name});
+    }
+  }
+#endif
+
+  // 队列满时等调用方取走; 调用方与扫描线程共用 files_cv_, 因此都用 notify_all
+  for (size_t i = 0; i < found.size();)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      files_cv_.wait(lock, [this]() { return files_.size() < kMaxQueuedFiles || stop_; });
+      if (stop_) return;
+      const size_t room = std::min(found.size() - i, kMaxQueuedFiles - files_.size());
+      for (const size_t end = i + room; i < end; ++i) files_.push_back(std::move(found[i]));
+    }
+    files_cv_.notify_all();
+  }
+}
+
+}  // namespace zip_compress
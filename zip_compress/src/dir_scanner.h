@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file dir_scanner.h
+ * @brief 并行目录遍历: 多线程按子目录窃取任务, 用 readdir 的 d_type 判断类型, 发现的文件即时交给调用方
+ * @author abin
+ * @date 2025-12-17
+ */
+
+#ifndef __GUARD_DIR_SCANNER_H_INCLUDE_GUARD__
+#define __GUARD_DIR_SCANNER_H_INCLUDE_GUARD__
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zip_compress
+{
+
+// 扫描到的普通文件
+struct ScannedFile
+{
+  std::string path;  // 可直接打开的路径
+  std::string name;  // 相对根目录的路径, 即 ZIP 内条目名
+};
+
+// 遍历过滤: name 为相对根目录的路径, 返回 false 时跳过该文件或不进入该目录. 会在扫描线程中并发调用
+using ScanFilter = std::function<bool(const std::string &name, bool is_directory)>;
+
+class DirScanner
+{
+ public:
+  // 构造后立即开始在后台线程遍历 root; 与 recursive_directory_iterator 一致, 不进入符号链接目录,
+  // 指向普通文件的符号链接视为普通文件; filter 为空时接受全部.
+  // 已发现未取走的文件最多缓存 4096 个, 调用方处理得慢时扫描线程等待, 内存不随目录树大小增长
+  DirScanner(const std::string &root, size_t threads, const ScanFilter &filter = nullptr);
+  ~DirScanner();
+
+  DirScanner(const DirScanner &) = delete;
+  DirScanner &operator=(const DirScanner &) = delete;
+
+  // 按发现顺序取出下一个文件, 遍历结束返回 false; 遍历出错(如目录无法打开)时抛出异常
+  bool next(ScannedFile &file);
+
+  // 自动选择的线程数: 硬件线程数, 最多 8
+  static size_t default_threads();
+
+ private:
+  struct WorkQueue
+  {
+    std::mutex mutex;
+    std::deque<std::string> dirs;  // 相对根目录的子目录
+  };
+
+  void worker(size_t id);
+  bool take_directory(size_t id, std::string &dir);
+  void push_directory(size_t id, const std::string &dir);
+  void scan_directory(size_t id, const std::string &dir);
+
+  bool accepts(const std::string &name, bool is_directory) const
+  {
+    return !filter_ || filter_(name, is_directory);
+  }
+
+  std::string root_;
+  ScanFilter filter_;
+  std::vector<std::unique_ptr<WorkQueue>> queues_;  // 每个线程一个, 自己从尾部取, 窃取从头部取
+
+  std::mutex mutex_;                  // 保护以下成员
+  std::condition_variable work_cv_;   // 有新目录或遍历结束
+  std::condition_variable files_cv_;  // 文件队列有变化(新文件或被取走)或遍历结束, 调用方与扫描线程都在此等待
+  size_t pending_;                    // 已入队或正在扫描的目录数, 为 0 表示遍历结束
+  size_t queued_;                     // 已入队尚未被取走的目录数
+  bool stop_;
+  std::deque<ScannedFile> files_;     // 已发现未被取走的文件, 有上限
+  std::exception_ptr error_;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_DIR_SCANNER_H_INCLUDE_GUARD__
@@ -0,0 +1,72 @@
+// 避免 Windows min/max 宏污染
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "entry_cache.h"
+
+namespace zip_compress
+{
+
+EntryCache::EntryCache(size_t capacity_bytes, size_t shards)
+    : shard_capacity_(capacity_bytes / shards), shards_(shards)
+{
+}
+
+EntryCache::Buffer EntryCache::get(uint32_t file_index)
+{
+  Shard &shard = shard_of(file_index);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.map.find(file_index);
+  if (it == shard.map.end())
+  {
+    ++shard.misses;
+    return Buffer();
+  }
+  ++shard.hits;
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  return it->second->second;
+}
+
+void EntryCache::put(uint32_t file_index, const Buffer &data)
+{
+  const size_t size = data->size();
+  if (size > shard_capacity_) return;
+
+  Shard &shard = shard_of(file_index);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.map.find(file_index);
+  if (it != shard.map.end())  // 并发未命中时可能已被其他线程放入
+  {
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return;
+  }
+
+  while (shard.bytes + size > shard_capacity_)
+  {
+    shard.bytes -= shard.lru.back().second->size();
+    shard.map.erase(shard.lru.back().first);
+    shard.lru.pop_back();
+    ++shard.evictions;
+  }
+  shard.lru.emplace_front(file_index, data);
+  shard.map.emplace(file_index, shard.lru.begin());
+  shard.bytes += size;
+}
+
+CacheStats EntryCache::stats() const
+{
+  CacheStats stats;
+  for (const auto &shard : shards_)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stats.hits += shard.hits;
+    stats.misses += shard.misses;
+    stats.evictions += shard.evictions;
+    stats.entries += shard.map.size();
+    stats.bytes += shard.bytes;
+  }
+  return stats;
+}
+
+}  // namespace zip_compress
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file entry_cache.h
+ * @brief 解压结果缓存: 按条目序号索引, 按字节数限制容量的分片 LRU, 各分片独立加锁
+ * @author abin
+ * @date 2025-12-16
+ */
+
+#ifndef __GUARD_ENTRY_CACHE_H_INCLUDE_GUARD__
+#define __GUARD_ENTRY_CACHE_H_INCLUDE_GUARD__
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "zip_compress/zip_reader.h"
+
+namespace zip_compress
+{
+
+class EntryCache
+{
+ public:
+  typedef std::shared_ptr<const std::vector<uint8_t>> Buffer;
+
+  // 总容量平均分给各分片, 单个条目超过分片容量时不缓存
+  EntryCache(size_t capacity_bytes, size_t shards);
+
+  // 命中时移到 LRU 头部并返回缓冲, 未命中返回空指针
+  Buffer get(uint32_t file_index);
+
+  // 放入缓存, 超出分片容量时淘汰最久未使用的条目
+  void put(uint32_t file_index, const Buffer &data);
+
+  CacheStats stats() const;
+
+ private:
+  struct Shard
+  {
+    mutable std::mutex mutex;
+    std::list<std::pair<uint32_t, Buffer>> lru;  // 头部为最近使用
+    std::unordered_map<uint32_t, std::list<std::pair<uint32_t, Buffer>>::iterator> map;
+    size_t bytes = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+  };
+
+  Shard &shard_of(uint32_t file_index)
+  {
+    return shards_[file_index % shards_.size()];
+  }
+
+  size_t shard_capacity_;
+  std::vector<Shard> shards_;
+};
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_ENTRY_CACHE_H_INCLUDE_GUARD__
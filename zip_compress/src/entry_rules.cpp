@@ -0,0 +1,255 @@
+// 避免 Windows min/max 宏污染
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "zip_compress/entry_rules.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "zip_compress/zip_writer.h"
+
+namespace zip_compress
+{
+
+namespace
+{
+
+// 规则统一按 '/' 分隔的条目名匹配
+#ifdef _WIN32
+std::string generic_name(std::string name)
+{
+  std::replace(name.begin(), name.end(), '\\', '/');
+  return name;
+}
+#else
+const std::string &generic_name(const std::string &name)
+{
+  return name;
+}
+#endif
+
+// 匹配 [...] 字符类, 成功时 p 指向 ']' 之后; 没有闭合的 '[' 返回 false 且不移动 p, 由调用方按字面字符处理
+bool match_class(const char *&p, const char *pe, unsigned char c, bool &matched)
+{
+  const char *q = p + 1;
+  const bool negate = q != pe && (*q == '!' || *q == '^');
+  if (negate) ++q;
+
+  bool hit = false;
+  for (bool first = true; q != pe && (*q != ']' || first); first = false)
+  {
+    const unsigned char lo = static_cast<unsigned char>(*q);
+    if (pe - q > 2 && q[1] == '-' && q[2] != ']')
+    {
+      hit = hit || (c >= lo && c <= static_cast<unsigned char>(q[2]));
+      q += 3;
+    }
+    else
+    {
+      hit = hit || c == lo;
+      ++q;
+    }
+  }
+  if (q == pe) return false;
+
+  p = q + 1;
+  matched = hit != negate && c != '/';
+  return true;
+}
+
+bool glob_match(const char *p, const char *pe, const char *s, const char *se)
+{
+  while (p != pe)
+  {
+    if (*p == '*')
+    {
+      const bool any_depth = pe - p > 1 && p[1] == '*';
+      p += any_depth ? 2 : 1;
+      // "**/" 也可以匹配零级目录
+      if (any_depth && p != pe && *p == '/' && glob_match(p + 1, pe, s, se)) return true;
+      for (;; ++s)
+      {
+        if (glob_match(p, pe, s, se)) return true;
+        if (s == se || (!any_depth && *s == '/')) return false;
+      }
+    }
+
+    if (s == se) return false;
+    if (*p == '?')
+    {
+      if (*s == '/') return false;
+      ++p;
+      ++s;
+      continue;
+    }
+    if (*p == '[')
+    {
+      bool matched;
+      if (match_class(p, pe, static_cast<unsigned char>(*s), matched))
+      {
+        if (!matched) return false;
+        ++s;
+        continue;
+      }
+    }
+    if (*p != *s) return false;
+    ++p;
+    ++s;
+  }
+  return s == se;
+}
+
+}  // namespace
+
+bool EntryRules::Pattern::matches(const std::string &name) const
+{
+  if (regex) return std::regex_search(name, *regex);
+
+  size_t start = 0;
+  if (basename_only)
+  {
+    const size_t slash = name.rfind('/');
+    if (slash != std::string::npos) start = slash + 1;
+  }
+  return glob_match(glob.data(), glob.data() + glob.size(), name.data() + start, name.data() + name.size());
+}
+
+EntryRules::Pattern EntryRules::make_glob(const std::string &glob)
+{
+  if (glob.empty()) throw std::invalid_argument("EntryRules: empty glob pattern");
+  Pattern pattern;
+  pattern.glob = glob;
+  pattern.basename_only = glob.find('/') == std::string::npos;
+  return pattern;
+}
+
+EntryRules::Pattern EntryRules::make_regex(const std::string &regex)
+{
+  Pattern pattern;
+  pattern.basename_only = false;
+  try
+  {
+    pattern.regex = std::make_shared<const std::regex>(regex, std::regex::ECMAScript | std::regex::optimize);
+  }
+  catch (const std::regex_error &e)
+  {
+    throw std::invalid_argument("EntryRules: invalid regex '" + regex + "': " + e.what());
+  }
+  return pattern;
+}
+
+bool EntryRules::any_matches(const std::vector<Pattern> &patterns, const std::string &name)
+{
+  for (const auto &pattern : patterns)
+  {
+    if (pattern.matches(name)) return true;
+  }
+  return false;
+}
+
+void EntryRules::check_level(int level)
+{
+  if (level < MZ_NO_COMPRESSION || level > kArchiveLevel)
+    throw std::invalid_argument("EntryRules: level must be in [0, " + std::to_string(kArchiveLevel) + "]");
+}
+
+EntryRules &EntryRules::include(const std::string &glob)
+{
+  includes_.push_back(make_glob(glob));
+  return *this;
+}
+
+EntryRules &EntryRules::include_regex(const std::string &regex)
+{
+  includes_.push_back(make_regex(regex));
+  return *this;
+}
+
+EntryRules &EntryRules::exclude(const std::string &glob)
+{
+  excludes_.push_back(make_glob(glob));
+  return *this;
+}
+
+EntryRules &EntryRules::exclude_regex(const std::string &regex)
+{
+  excludes_.push_back(make_regex(regex));
+  return *this;
+}
+
+EntryRules &EntryRules::level(const std::string &glob, int level)
+{
+  check_level(level);
+  levels_.push_back(LevelRule{std::make_shared<const Pattern>(make_glob(glob)), 0, 0, level});
+  return *this;
+}
+
+EntryRules &EntryRules::level_regex(const std::string &regex, int level)
+{
+  check_level(level);
+  levels_.push_back(LevelRule{std::make_shared<const Pattern>(make_regex(regex)), 0, 0, level});
+  return *this;
+}
+
+EntryRules &EntryRules::level_by_size(uint64_t min_size, uint64_t max_size, int level)
+{
+  check_level(level);
+  if (min_size >= max_size) throw std::invalid_argument("EntryRules: min_size must be less than max_size");
+  levels_.push_back(LevelRule{nullptr, min_size, max_size, level});
+  return *this;
+}
+
+bool EntryRules::accepts_directory(const std::string &name) const
+{
+  return !any_matches(excludes_, generic_name(name));
+}
+
+bool EntryRules::accepts_file(const std::string &name) const
+{
+  const std::string &generic = generic_name(name);
+  if (any_matches(excludes_, generic)) return false;
+  return includes_.empty() || any_matches(includes_, generic);
+}
+
+bool EntryRules::accepts_entry(const std::string &name, bool is_directory) const
+{
+  std::string generic = generic_name(name);
+  while (!generic.empty() && generic.back() == '/') generic.pop_back();  // 目录条目以 '/' 结尾
+  if (is_directory && !includes_.empty()) return false;
+
+  if (!excludes_.empty())
+  {
+    for (size_t slash = generic.find('/'); slash != std::string::npos; slash = generic.find('/', slash + 1))
+    {
+      if (any_matches(excludes_, generic.substr(0, slash))) return false;
+    }
+  }
+  return is_directory ? accepts_directory(generic) : accepts_file(generic);
+}
+
+int EntryRules::level_for(const std::string &name, const std::function<uint64_t()> &file_size) const
+{
+  const std::string &generic = generic_name(name);
+  bool size_known = false;
+  uint64_t size = 0;
+  for (const auto &rule : levels_)
+  {
+    if (rule.pattern)
+    {
+      if (rule.pattern->matches(generic)) return rule.level;
+      continue;
+    }
+
+    if (!size_known)
+    {
+      size = file_size();
+      size_known = true;
+    }
+    if (size >= rule.min_size && size < rule.max_size) return rule.level;
+  }
+  return -1;
+}
+
+}  // namespace zip_compress
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file file_advice.h
+ * @brief 向内核发出文件访问模式提示(posix_fadvise / fcntl), 不支持的平台为空操作
+ * @author abin
+ * @date 2025-12-14
+ */
+
+#ifndef __GUARD_FILE_ADVICE_H_INCLUDE_GUARD__
+#define __GUARD_FILE_ADVICE_H_INCLUDE_GUARD__
+
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace zip_compress
+{
+
+// 整个文件将被顺序读取, 内核可加大预读窗口
+inline void advise_sequential(FILE *fp)
+{
+  if (fp == nullptr) return;
+#if defined(POSIX_FADV_SEQUENTIAL)
+  posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(__APPLE__)
+  fcntl(fileno(fp), F_RDAHEAD, 1);
+#endif
+}
+
+// [offset, offset + len) 即将被读取, 内核可提前异步读入页缓存; len 为 0 表示到文件末尾
+inline void advise_willneed(FILE *fp, uint64_t offset, uint64_t len)
+{
+  if (fp == nullptr) return;
+#if defined(POSIX_FADV_WILLNEED)
+  posix_fadvise(fileno(fp), static_cast<off_t>(offset), static_cast<off_t>(len), POSIX_FADV_WILLNEED);
+#elif defined(__APPLE__)
+  struct radvisory advisory;
+  advisory.ra_offset = static_cast<off_t>(offset);
+  advisory.ra_count = len == 0 || len > INT_MAX ? INT_MAX : static_cast<int>(len);
+  fcntl(fileno(fp), F_RDADVISE, &advisory);
+#else
+  (void)offset;
+  (void)len;
+#endif
+}
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_FILE_ADVICE_H_INCLUDE_GUARD__
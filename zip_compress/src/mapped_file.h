@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file mapped_file.h
+ * @brief 只读内存映射文件(POSIX mmap / Windows MapViewOfFile)
+ * @author abin
+ * @date 2025-12-15
+ */
+
+#ifndef __GUARD_MAPPED_FILE_H_INCLUDE_GUARD__
+#define __GUARD_MAPPED_FILE_H_INCLUDE_GUARD__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace zip_compress
+{
+
+class MappedFile
+{
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // 映射整个文件, 失败(不存在、为空或映射失败)返回 false
+  bool open(const std::string &path);
+  void close();
+
+  const uint8_t *data() const
+  {
+    return data_;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+#ifdef _WIN32
+  void *file_;
+  void *mapping_;
+#endif
+};
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_MAPPED_FILE_H_INCLUDE_GUARD__
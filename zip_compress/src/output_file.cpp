@@ -0,0 +1,346 @@
+// 避免 Windows min/max 宏污染
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "output_file.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+namespace zip_compress
+{
+
+#ifdef _WIN32
+
+// Windows 没有对应的预分配/稀疏/直接 IO 路径, 使用 stdio 写出
+OutputFile::OutputFile() : fp_(nullptr) {}
+
+OutputFile::~OutputFile()
+{
+  if (fp_ != nullptr) std::fclose(fp_);
+}
+
+bool OutputFile::open(const std::string &path, uint64_t expected_size, const IoOptions &io)
+{
+  (void)expected_size;
+  if (fp_ != nullptr) std::fclose(fp_);
+  fp_ = std::fopen(path.c_str(), "wb");
+  if (fp_ == nullptr) return false;
+  if (io.buffer_size != 0) std::setvbuf(fp_, nullptr, _IOFBF, io.buffer_size);
+  return true;
+}
+
+bool OutputFile::write(const void *data, size_t size)
+{
+  return std::fwrite(data, 1, size, fp_) == size;
+}
+
+bool OutputFile::copy_from(int in_fd, uint64_t in_offset, uint64_t size)
+{
+  (void)in_fd;
+  (void)in_offset;
+  (void)size;
+  return false;
+}
+
+bool OutputFile::close()
+{
+  if (fp_ == nullptr) return false;
+  const bool ok = std::fclose(fp_) == 0;
+  fp_ = nullptr;
+  return ok;
+}
+
+#else
+
+namespace
+{
+
+const size_t kBlockSize = 4096;          // 稀疏检测与 O_DIRECT 的对齐粒度
+const size_t kMaxBufferSize = 1 << 20;  // 未指定 buffer_size 时的写出缓冲上限
+
+size_t round_up(uint64_t size)
+{
+  return static_cast<size_t>((size + kBlockSize - 1) & ~static_cast<uint64_t>(kBlockSize - 1));
+}
+
+bool is_zero(const uint8_t *p, size_t size)
+{
+  return size == 0 || (p[0] == 0 && std::memcmp(p, p + 1, size - 1) == 0);
+}
+
+bool pwrite_all(int fd, const uint8_t *data, size_t size, uint64_t offset)
+{
+  while (size > 0)
+  {
+    const ssize_t n = pwrite(fd, data, size, static_cast<off_t>(offset));
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+    offset += static_cast<uint64_t>(n);
+  }
+  return true;
+}
+
+// 预留 size 字节的磁盘空间但不改变文件长度, 成功返回 true.
+// Linux 直接调用 fallocate, 不支持的文件系统返回 EOPNOTSUPP, 不会像 posix_fallocate 那样退化为逐块写零
+bool preallocate(int fd, uint64_t size)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+  return fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) == 0;
+#elif defined(__APPLE__)
+  fstore_t store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(size), 0};
+  if (fcntl(fd, F_PREALLOCATE, &store) == 0) return true;
+  store.fst_flags = F_ALLOCATEALL;  // 没有足够的连续空间时退而求其次
+  return fcntl(fd, F_PREALLOCATE, &store) == 0;
+#else
+  (void)fd;
+  (void)size;
+  return false;
+#endif
+}
+
+#ifdef __linux__
+// 在内核内把 in_fd 的 [in_offset, in_offset + size) 拷贝到 out_fd 的 out_offset, 返回拷贝成功的字节数.
+// copy_file_range 在 btrfs/xfs 上共享数据块(reflink), 在 NFS 4.2/SMB 上由服务端拷贝; 旧内核或跨文件系统(EXDEV)时退回 sendfile
+uint64_t kernel_copy(int in_fd, uint64_t in_offset, int out_fd, uint64_t out_offset, uint64_t size)
+{
+  const uint64_t max_chunk = 1 << 30;
+  uint64_t copied = 0;
+#ifdef SYS_copy_file_range
+  while (copied < size)
+  {
+    loff_t in_pos = static_cast<loff_t>(in_offset + copied);
+    loff_t out_pos = static_cast<loff_t>(out_offset + copied);
+    const size_t n = static_cast<size_t>(std::min(max_chunk, size - copied));
+    const long r = syscall(SYS_copy_file_range, in_fd, &in_pos, out_fd, &out_pos, n, 0U);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) break;
+    copied += static_cast<uint64_t>(r);
+  }
+#endif
+
+  // sendfile 写在 out_fd 的当前位置; OutputFile 只用 pwrite, 不依赖该位置
+  if (copied < size && lseek(out_fd, static_cast<off_t>(out_offset + copied), SEEK_SET) >= 0)
+  {
+    while (copied < size)
+    {
+      off_t in_pos = static_cast<off_t>(in_offset + copied);
+      const ssize_t r = sendfile(out_fd, in_fd, &in_pos, static_cast<size_t>(std::min(max_chunk, size - copied)));
+      if (r < 0 && errno == EINTR) continue;
+      if (r <= 0) break;
+      copied += static_cast<uint64_t>(r);
+    }
+  }
+  return copied;
+}
+#endif
+
+}  // namespace
+
+OutputFile::OutputFile()
+    : fd_(-1),
+      buf_(nullptr),
+      capacity_(0),
+      len_(0),
+      offset_(0),
+      end_(0),
+      reserved_(0),
+      sparse_(false),
+      direct_(false),
+      failed_(false)
+{
+}
+
+OutputFile::~OutputFile()
+{
+  if (fd_ >= 0) ::close(fd_);
+  std::free(buf_);
+}
+
+bool OutputFile::open(const std::string &path, uint64_t expected_size, const IoOptions &io)
+{
+  if (fd_ >= 0) ::close(fd_);
+  len_ = 0;
+  offset_ = 0;
+  end_ = 0;
+  reserved_ = 0;
+  sparse_ = io.sparse;
+  direct_ = false;
+  failed_ = false;
+
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  const bool want_direct = io.direct_io_threshold != 0 && expected_size >= io.direct_io_threshold;
+  fd_ = -1;
+#ifdef O_DIRECT
+  if (want_direct)
+  {
+    // 文件系统不支持(如 tmpfs 返回 EINVAL)时退回普通写入
+    fd_ = ::open(path.c_str(), flags | O_DIRECT, 0666);
+    direct_ = fd_ >= 0;
+  }
+#endif
+  if (fd_ < 0) fd_ = ::open(path.c_str(), flags, 0666);
+  if (fd_ < 0) return false;
+#if defined(__APPLE__)
+  if (want_direct) fcntl(fd_, F_NOCACHE, 1);  // macOS 没有 O_DIRECT, 改为绕过统一缓冲缓存
+#endif
+
+  // 稀疏文件要保留空洞, 不做预分配
+  if (io.preallocate && !sparse_ && expected_size > 0 && preallocate(fd_, expected_size)) reserved_ = expected_size;
+
+  // 缓冲按条目大小裁剪, 小文件不必分配整块大缓冲
+  const size_t limit = io.buffer_size != 0 ? round_up(io.buffer_size) : kMaxBufferSize;
+  const size_t want = std::max(kBlockSize, std::min(limit, round_up(expected_size)));
+  if (capacity_ < want)
+  {
+    std::free(buf_);
+    void *p = nullptr;
+    buf_ = posix_memalign(&p, kBlockSize, want) == 0 ? static_cast<uint8_t *>(p) : nullptr;
+    capacity_ = buf_ != nullptr ? want : 0;
+    if (buf_ == nullptr)
+    {
+      ::close(fd_);
+      fd_ = -1;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool OutputFile::write(const void *data, size_t size)
+{
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  while (size > 0 && !failed_)
+  {
+    const size_t n = std::min(size, capacity_ - len_);
+    std::memcpy(buf_ + len_, p, n);
+    len_ += n;
+    p += n;
+    size -= n;
+    if (len_ == capacity_ && !flush(false)) failed_ = true;
+  }
+  return !failed_;
+}
+
+bool OutputFile::copy_from(int in_fd, uint64_t in_offset, uint64_t size)
+{
+#ifdef __linux__
+  // 稀疏模式要逐块检查全零, 直接 IO 要求对齐, 都只能经过缓冲
+  if (!failed_ && !sparse_ && !direct_ && len_ == 0)
+  {
+    const uint64_t copied = kernel_copy(in_fd, in_offset, fd_, offset_, size);
+    offset_ += copied;
+    end_ = offset_;
+    in_offset += copied;
+    size -= copied;
+  }
+#endif
+
+  // 剩余部分(内核拷贝不可用或中途失败)读入缓冲写出
+  while (size > 0 && !failed_)
+  {
+    const size_t want = static_cast<size_t>(std::min<uint64_t>(size, capacity_ - len_));
+    const ssize_t n = pread(in_fd, buf_ + len_, want, static_cast<off_t>(in_offset));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0)
+    {
+      failed_ = true;
+      break;
+    }
+    len_ += static_cast<size_t>(n);
+    in_offset += static_cast<uint64_t>(n);
+    size -= static_cast<uint64_t>(n);
+    if (len_ == capacity_ && !flush(false)) failed_ = true;
+  }
+  return !failed_;
+}
+
+bool OutputFile::flush(bool final)
+{
+  size_t aligned = len_;
+  if (direct_ && final) aligned = len_ & ~(kBlockSize - 1);
+  if (aligned > 0 && !write_out(buf_, aligned)) return false;
+
+  if (aligned < len_)
+  {
+#ifdef O_DIRECT
+    // O_DIRECT 要求长度按块对齐, 不足一块的尾部关闭 O_DIRECT 后写出
+    const int flags = fcntl(fd_, F_GETFL);
+    if (flags < 0 || fcntl(fd_, F_SETFL, flags & ~O_DIRECT) != 0) return false;
+#endif
+    direct_ = false;
+    if (!write_out(buf_ + aligned, len_ - aligned)) return false;
+  }
+  len_ = 0;
+  return true;
+}
+
+bool OutputFile::write_out(const uint8_t *data, size_t size)
+{
+  if (!sparse_)
+  {
+    if (!pwrite_all(fd_, data, size, offset_)) return false;
+    offset_ += size;
+    end_ = offset_;
+    return true;
+  }
+
+  // offset_ 在写出之间总是块对齐的(只有最后一次写出可能不足一块), 按块检测全零并跳过
+  size_t pos = 0;
+  while (pos < size)
+  {
+    size_t n = std::min(kBlockSize, size - pos);
+    if (is_zero(data + pos, n))
+    {
+      pos += n;
+      continue;
+    }
+
+    // 合并连续的非零块, 一次写出
+    size_t run = n;
+    while (pos + run < size)
+    {
+      n = std::min(kBlockSize, size - pos - run);
+      if (is_zero(data + pos + run, n)) break;
+      run += n;
+    }
+    if (!pwrite_all(fd_, data + pos, run, offset_ + pos)) return false;
+    end_ = offset_ + pos + run;
+    pos += run;
+  }
+  offset_ += size;
+  return true;
+}
+
+bool OutputFile::close()
+{
+  if (fd_ < 0) return false;
+  bool ok = !failed_ && flush(true);
+
+  // 末尾是空洞或写入少于预分配大小时, 设置长度并释放多余的预留空间
+  if (ok && (end_ != offset_ || reserved_ > offset_)) ok = ftruncate(fd_, static_cast<off_t>(offset_)) == 0;
+  ok = ::close(fd_) == 0 && ok;
+  fd_ = -1;
+  return ok;
+}
+
+#endif
+
+}  // namespace zip_compress
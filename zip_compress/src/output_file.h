@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file output_file.h
+ * @brief 解压输出文件: 按条目大小预分配、跳过全零块生成稀疏文件、大条目以 O_DIRECT 和对齐缓冲写出
+ * @author abin
+ * @date 2025-12-19
+ */
+
+#ifndef __GUARD_OUTPUT_FILE_H_INCLUDE_GUARD__
+#define __GUARD_OUTPUT_FILE_H_INCLUDE_GUARD__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "zip_compress/io_options.h"
+
+namespace zip_compress
+{
+
+class OutputFile
+{
+ public:
+  OutputFile();
+  ~OutputFile();
+
+  OutputFile(const OutputFile &) = delete;
+  OutputFile &operator=(const OutputFile &) = delete;
+
+  // 创建(截断)输出文件, expected_size 为条目解压后的大小, 用于预分配、选择缓冲大小与是否直接 IO
+  bool open(const std::string &path, uint64_t expected_size, const IoOptions &io);
+
+  // 顺序追加数据
+  bool write(const void *data, size_t size);
+
+  // 顺序追加 in_fd 中 [in_offset, in_offset + size) 的内容, 不移动 in_fd 的文件位置. Linux 上优先在内核内拷贝
+  // (copy_file_range, 其次 sendfile), 稀疏/直接 IO 模式或内核拷贝不可用时读入缓冲写出. Windows 不支持, 返回 false
+  bool copy_from(int in_fd, uint64_t in_offset, uint64_t size);
+
+  // 写出剩余数据并关闭, 文件长度等于实际写入的字节数
+  bool close();
+
+ private:
+#ifdef _WIN32
+  FILE *fp_;
+#else
+  // 写出缓冲中的数据; final 为 false 时只在缓冲写满时调用
+  bool flush(bool final);
+
+  // 从 offset_ 开始写出 data, 稀疏模式下跳过全零块
+  bool write_out(const uint8_t *data, size_t size);
+
+  int fd_;
+  uint8_t *buf_;       // 按块大小对齐, 满足 O_DIRECT 的要求
+  size_t capacity_;    // 块大小的整数倍
+  size_t len_;         // 缓冲中待写出的字节数
+  uint64_t offset_;    // 下一次写出的文件偏移
+  uint64_t end_;       // 文件当前长度(实际写入的最远位置)
+  uint64_t reserved_;  // 预分配的字节数, 写入不足时需要截断释放
+  bool sparse_;
+  bool direct_;
+  bool failed_;
+#endif
+};
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_OUTPUT_FILE_H_INCLUDE_GUARD__
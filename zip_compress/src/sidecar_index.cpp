@@ -0,0 +1,395 @@
+// 避免 Windows min/max 宏污染
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "sidecar_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+// 引入 filesystem 库, 优先使用标准库, 其次使用 ghc::filesystem 作为替代
+#if defined(_MSC_VER)
+#if _MSVC_LANG >= 201703L && __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include "ghc/filesystem.hpp"
+namespace fs = ghc::filesystem;
+#endif
+#else
+#if __cplusplus >= 201703L && __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include "ghc/filesystem.hpp"
+namespace fs = ghc::filesystem;
+#endif
+#endif
+
+namespace zip_compress
+{
+
+namespace
+{
+
+const uint32_t kMagic = 0x5849435A;  // "ZCIX"
+const uint32_t kVersion = 1;
+const uint32_t kTailSize = 4096;
+const uint32_t kLocalHeaderSize = 30;
+const uint32_t kLocalHeaderSig = 0x04034b50;
+
+static_assert(sizeof(IndexHeader) == 72, "IndexHeader layout");
+static_assert(sizeof(IndexEntry) == 56, "IndexEntry layout");
+
+inline unsigned char to_lower(unsigned char c)
+{
+  return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+}
+
+// 忽略 ASCII 大小写的 FNV-1a
+uint64_t name_hash(const char *name, size_t len)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; ++i)
+  {
+    h ^= to_lower(static_cast<unsigned char>(name[i]));
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+bool name_equal(const char *a, const char *b, size_t len)
+{
+  for (size_t i = 0; i < len; ++i)
+    if (to_lower(static_cast<unsigned char>(a[i])) != to_lower(static_cast<unsigned char>(b[i]))) return false;
+  return true;
+}
+
+bool seek_to(FILE *fp, uint64_t ofs)
+{
+#ifdef _WIN32
+  return _fseeki64(fp, static_cast<__int64>(ofs), SEEK_SET) == 0;
+#else
+  return fseeko(fp, static_cast<off_t>(ofs), SEEK_SET) == 0;
+#endif
+}
+
+bool read_at(FILE *fp, uint64_t ofs, void *buf, size_t len)
+{
+  return seek_to(fp, ofs) && std::fread(buf, 1, len, fp) == len;
+}
+
+uint32_t read_le16(const uint8_t *p)
+{
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8);
+}
+
+uint32_t read_le32(const uint8_t *p)
+{
+  return read_le16(p) | (read_le16(p + 2) << 16);
+}
+
+}  // namespace
+
+SidecarIndex::SidecarIndex()
+    : header_(nullptr), entries_(nullptr), slots_(nullptr), names_(nullptr), fp_(nullptr), io_()
+{
+}
+
+SidecarIndex::~SidecarIndex()
+{
+  if (fp_ != nullptr) std::fclose(fp_);
+}
+
+void SidecarIndex::write(mz_zip_archive *zip, const std::string &index_path)
+{
+  const mz_uint count = mz_zip_reader_get_num_files(zip);
+  const uint64_t start = mz_zip_get_archive_file_start_offset(zip);
+  const uint64_t archive_size = mz_zip_get_archive_size(zip);
+
+  IndexHeader header = IndexHeader();
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.archive_size = start + archive_size;
+  header.central_dir_ofs = start + zip->m_central_directory_file_ofs;
+  header.central_dir_size = mz_zip_get_central_dir_size(zip);
+  header.entry_count = count;
+
+  // 中央目录与文件末尾的校验和
+  std::vector<uint8_t> buf(static_cast<size_t>(header.central_dir_size));
+  if (mz_zip_read_archive_data(zip, zip->m_central_directory_file_ofs, buf.data(), buf.size()) != buf.size())
+    throw std::runtime_error("Failed to read central directory for index: " + index_path);
+  header.central_dir_crc32 = static_cast<uint32_t>(mz_crc32(MZ_CRC32_INIT, buf.data(), buf.size()));
+  header.tail_size = static_cast<uint32_t>(std::min<uint64_t>(archive_size, kTailSize));
+  buf.resize(header.tail_size);
+  if (mz_zip_read_archive_data(zip, archive_size - header.tail_size, buf.data(), buf.size()) != buf.size())
+    throw std::runtime_error("Failed to read archive tail for index: " + index_path);
+  header.tail_crc32 = static_cast<uint32_t>(mz_crc32(MZ_CRC32_INIT, buf.data(), buf.size()));
+
+  std::vector<IndexEntry> entries(count);
+  std::string names;
+  char name_buf[MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE];
+  for (mz_uint i = 0; i < count; ++i)
+  {
+    mz_zip_archive_file_stat st;
+    mz_uint len = mz_zip_reader_get_filename(zip, i, name_buf, sizeof(name_buf));
+    if (len == 0 || mz_zip_reader_file_stat(zip, i, &st) == 0)
+      throw std::runtime_error("Failed to get file info at index: " + std::to_string(i));
+
+    IndexEntry &e = entries[i];
+    e.local_header_ofs = start + st.m_local_header_ofs;
+    e.comp_size = st.m_comp_size;
+    e.uncomp_size = st.m_uncomp_size;
+    e.name_ofs = names.size();
+    e.mtime = static_cast<int64_t>(st.m_time);
+    e.crc32 = st.m_crc32;
+    e.name_len = static_cast<uint16_t>(len - 1);
+    e.method = static_cast<uint16_t>(st.m_method);
+    e.flags = st.m_is_directory ? static_cast<uint32_t>(kIndexEntryDirectory) : 0U;
+    if (st.m_is_encrypted || !st.m_is_supported || (e.method != 0 && e.method != MZ_DEFLATED) ||
+        (e.method == 0 && e.comp_size != e.uncomp_size))
+      e.flags |= kIndexEntryFallback;
+    names.append(name_buf, len - 1);
+  }
+  header.names_size = names.size();
+
+  // 开放寻址哈希表, 负载不超过 1/2; 重名时保留第一个, 与 miniz 线性查找一致
+  uint64_t slot_count = 8;
+  while (slot_count < static_cast<uint64_t>(count) * 2) slot_count <<= 1;
+  header.slot_count = slot_count;
+  std::vector<uint32_t> slots(static_cast<size_t>(slot_count), 0);
+  for (mz_uint i = 0; i < count; ++i)
+  {
+    const IndexEntry &e = entries[i];
+    const char *name = names.data() + e.name_ofs;
+    size_t slot = static_cast<size_t>(name_hash(name, e.name_len) & (slot_count - 1));
+    for (;; slot = (slot + 1) & (slot_count - 1))
+    {
+      if (slots[slot] == 0)
+      {
+        slots[slot] = i + 1;
+        break;
+      }
+      const IndexEntry &other = entries[slots[slot] - 1];
+      if (other.name_len == e.name_len && name_equal(names.data() + other.name_ofs, name, e.name_len)) break;
+    }
+  }
+
+  const std::string tmp_path = index_path + ".tmp";
+  FILE *fp = std::fopen(tmp_path.c_str(), "wb");
+  if (fp == nullptr) throw std::runtime_error("Failed to create index file: " + index_path);
+  bool ok = std::fwrite(&header, sizeof(header), 1, fp) == 1;
+  ok = ok && (entries.empty() || std::fwrite(entries.data(), sizeof(IndexEntry), entries.size(), fp) == entries.size());
+  ok = ok && std::fwrite(slots.data(), sizeof(uint32_t), slots.size(), fp) == slots.size();
+  ok = ok && (names.empty() || std::fwrite(names.data(), 1, names.size(), fp) == names.size());
+  ok = std::fclose(fp) == 0 && ok;
+
+  std::error_code ec;
+  if (ok) fs::rename(tmp_path, index_path, ec);
+  if (!ok || ec)
+  {
+    std::remove(tmp_path.c_str());
+    throw std::runtime_error("Failed to write index file: " + index_path);
+  }
+}
+
+bool SidecarIndex::verify(const std::string &zip_path, const std::string &index_path)
+{
+  SidecarIndex index;
+  if (!index.open(zip_path, index_path, IoOptions())) return false;
+
+  std::vector<uint8_t> buf(static_cast<size_t>(index.header_->central_dir_size));
+  if (!read_at(index.fp_, index.header_->central_dir_ofs, buf.data(), buf.size())) return false;
+  return mz_crc32(MZ_CRC32_INIT, buf.data(), buf.size()) == index.header_->central_dir_crc32;
+}
+
+bool SidecarIndex::open(const std::string &zip_path, const std::string &index_path, const IoOptions &io)
+{
+  io_ = io;
+  if (!map_.open(index_path) || map_.size() < sizeof(IndexHeader)) return false;
+
+  const IndexHeader *header = reinterpret_cast<const IndexHeader *>(map_.data());
+  const uint64_t body = map_.size() - sizeof(IndexHeader);
+  if (header->magic != kMagic || header->version != kVersion || header->slot_count == 0 ||
+      (header->slot_count & (header->slot_count - 1)) != 0 || header->entry_count > body / sizeof(IndexEntry) ||
+      header->slot_count > body / sizeof(uint32_t) || header->names_size > body ||
+      header->entry_count * sizeof(IndexEntry) + header->slot_count * sizeof(uint32_t) + header->names_size != body)
+  {
+    map_.close();
+    return false;
+  }
+
+  // 大小与末尾(EOCD 所在处)不变即认为 ZIP 未被修改
+  std::error_code ec;
+  const uint64_t archive_size = fs::file_size(zip_path, ec);
+  fp_ = ec || archive_size != header->archive_size ? nullptr : std::fopen(zip_path.c_str(), "rb");
+  std::vector<uint8_t> tail(header->tail_size);
+  if (fp_ == nullptr || header->tail_size > archive_size ||
+      !read_at(fp_, archive_size - header->tail_size, tail.data(), tail.size()) ||
+      mz_crc32(MZ_CRC32_INIT, tail.data(), tail.size()) != header->tail_crc32)
+  {
+    if (fp_ != nullptr) std::fclose(fp_);
+    fp_ = nullptr;
+    map_.close();
+    return false;
+  }
+  if (io_.buffer_size != 0) std::setvbuf(fp_, nullptr, _IOFBF, io_.buffer_size);
+
+  header_ = header;
+  entries_ = reinterpret_cast<const IndexEntry *>(map_.data() + sizeof(IndexHeader));
+  slots_ = reinterpret_cast<const uint32_t *>(entries_ + header->entry_count);
+  names_ = reinterpret_cast<const char *>(slots_ + header->slot_count);
+  return true;
+}
+
+std::string SidecarIndex::name(size_t index) const
+{
+  const IndexEntry &e = entries_[index];
+  if (e.name_ofs > header_->names_size || e.name_len > header_->names_size - e.name_ofs) return std::string();
+  return std::string(names_ + e.name_ofs, e.name_len);
+}
+
+long long SidecarIndex::find(const std::string &name) const
+{
+  const uint64_t mask = header_->slot_count - 1;
+  uint64_t slot = name_hash(name.data(), name.size()) & mask;
+  for (uint64_t probes = 0; probes <= mask; ++probes, slot = (slot + 1) & mask)
+  {
+    const uint32_t value = slots_[slot];
+    if (value == 0 || value > header_->entry_count) return -1;
+
+    const IndexEntry &e = entries_[value - 1];
+    if (e.name_len == name.size() && e.name_ofs <= header_->names_size &&
+        e.name_len <= header_->names_size - e.name_ofs && name_equal(names_ + e.name_ofs, name.data(), name.size()))
+      return static_cast<long long>(value - 1);
+  }
+  return -1;
+}
+
+bool SidecarIndex::seek_to_data(const IndexEntry &e)
+{
+  // 本地头的文件名/扩展字段长度可能与中央目录不同, 以本地头为准
+  uint8_t local[kLocalHeaderSize];
+  if (!read_at(fp_, e.local_header_ofs, local, sizeof(local)) || read_le32(local) != kLocalHeaderSig) return false;
+  const uint64_t data_ofs = e.local_header_ofs + kLocalHeaderSize + read_le16(local + 26) + read_le16(local + 28);
+  if (data_ofs > header_->archive_size || e.comp_size > header_->archive_size - data_ofs) return false;
+  return seek_to(fp_, data_ofs);
+}
+
+bool SidecarIndex::extract(size_t index, const std::function<bool(const uint8_t *, size_t)> &sink)
+{
+  const IndexEntry &e = entries_[index];
+  if (!seek_to_data(e)) return false;
+
+  std::vector<uint8_t> in(static_cast<size_t>(
+      std::min<uint64_t>(std::max<uint64_t>(e.comp_size, 1), io_.buffer_size != 0 ? io_.buffer_size : 64 * 1024)));
+  uint64_t remaining = e.comp_size;
+  uint64_t out_total = 0;
+  mz_uint32 crc = MZ_CRC32_INIT;
+
+  if (e.method == 0)
+  {
+    while (remaining > 0)
+    {
+      const size_t n = static_cast<size_t>(std::min<uint64_t>(remaining, in.size()));
+      if (std::fread(in.data(), 1, n, fp_) != n) return false;
+      crc = static_cast<mz_uint32>(mz_crc32(crc, in.data(), n));
+      if (!sink(in.data(), n)) return false;
+      remaining -= n;
+      out_total += n;
+    }
+    return out_total == e.uncomp_size && crc == e.crc32;
+  }
+
+  // 原始 deflate 流, 输出到 32 KB 环形字典
+  tinfl_decompressor inflator;
+  tinfl_init(&inflator);
+  std::vector<uint8_t> dict(TINFL_LZ_DICT_SIZE);
+  size_t dict_ofs = 0;
+  size_t in_ofs = 0;
+  size_t in_avail = 0;
+  tinfl_status status;
+  for (;;)
+  {
+    if (in_avail == 0 && remaining > 0)
+    {
+      in_avail = static_cast<size_t>(std::min<uint64_t>(remaining, in.size()));
+      if (std::fread(in.data(), 1, in_avail, fp_) != in_avail) return false;
+      remaining -= in_avail;
+      in_ofs = 0;
+    }
+
+    size_t in_bytes = in_avail;
+    size_t out_bytes = dict.size() - dict_ofs;
+    status = tinfl_decompress(&inflator, in.data() + in_ofs, &in_bytes, dict.data(), dict.data() + dict_ofs, &out_bytes,
+                              remaining > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+    in_ofs += in_bytes;
+    in_avail -= in_bytes;
+
+    if (out_bytes != 0)
+    {
+      crc = static_cast<mz_uint32>(mz_crc32(crc, dict.data() + dict_ofs, out_bytes));
+      if (!sink(dict.data() + dict_ofs, out_bytes)) return false;
+      out_total += out_bytes;
+      dict_ofs = (dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+    if (status <= TINFL_STATUS_DONE) break;
+  }
+  return status == TINFL_STATUS_DONE && out_total == e.uncomp_size && crc == e.crc32;
+}
+
+bool SidecarIndex::extract_to_buffer(size_t index, uint8_t *out, size_t capacity, uint8_t *scratch, size_t scratch_size)
+{
+  const IndexEntry &e = entries_[index];
+  if (e.uncomp_size > capacity || !seek_to_data(e)) return false;
+  const size_t out_size = static_cast<size_t>(e.uncomp_size);
+
+  if (e.method == 0)
+  {
+    if (out_size != 0 && std::fread(out, 1, out_size, fp_) != out_size) return false;
+    return mz_crc32(MZ_CRC32_INIT, out, out_size) == e.crc32;
+  }
+
+  std::vector<uint8_t> owned;
+  if (scratch == nullptr || scratch_size == 0)
+  {
+    owned.resize(static_cast<size_t>(std::min<uint64_t>(std::max<uint64_t>(e.comp_size, 1), 64 * 1024)));
+    scratch = owned.data();
+    scratch_size = owned.size();
+  }
+
+  // 输出大小已知, 直接解压到调用方缓冲, 不经过环形字典
+  tinfl_decompressor inflator;
+  tinfl_init(&inflator);
+  uint64_t remaining = e.comp_size;
+  size_t out_ofs = 0;
+  size_t in_ofs = 0;
+  size_t in_avail = 0;
+  tinfl_status status;
+  for (;;)
+  {
+    if (in_avail == 0 && remaining > 0)
+    {
+      in_avail = static_cast<size_t>(std::min<uint64_t>(remaining, scratch_size));
+      if (std::fread(scratch, 1, in_avail, fp_) != in_avail) return false;
+      remaining -= in_avail;
+      in_ofs = 0;
+    }
+
+    size_t in_bytes = in_avail;
+    size_t out_bytes = out_size - out_ofs;
+    status = tinfl_decompress(&inflator, scratch + in_ofs, &in_bytes, out, out + out_ofs, &out_bytes,
+                              TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF | (remaining > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0));
+    in_ofs += in_bytes;
+    in_avail -= in_bytes;
+    out_ofs += out_bytes;
+    if (status != TINFL_STATUS_NEEDS_MORE_INPUT) break;
+  }
+  return status == TINFL_STATUS_DONE && out_ofs == out_size && mz_crc32(MZ_CRC32_INIT, out, out_size) == e.crc32;
+}
+
+}  // namespace zip_compress
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Abin
+/**
+ * @file sidecar_index.h
+ * @brief ZIP 的边车索引: 名称哈希表 + 条目偏移/大小/CRC, 映射后即可按名查找与解压, 打开开销与条目数无关
+ * @author abin
+ * @date 2025-12-15
+ */
+
+#ifndef __GUARD_SIDECAR_INDEX_H_INCLUDE_GUARD__
+#define __GUARD_SIDECAR_INDEX_H_INCLUDE_GUARD__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+#include "mapped_file.h"
+#include "miniz.h"
+#include "zip_compress/io_options.h"
+
+namespace zip_compress
+{
+
+// 索引文件布局(主机字节序, 字节序不同时 magic 不匹配):
+// IndexHeader | IndexEntry[entry_count] | uint32_t 哈希槽[slot_count] | 文件名区
+struct IndexHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t archive_size;       // ZIP 文件大小
+  uint64_t central_dir_ofs;    // 中央目录的绝对文件偏移
+  uint64_t central_dir_size;   // 中央目录字节数
+  uint64_t entry_count;
+  uint64_t slot_count;  // 2 的幂, 槽位存放条目序号 + 1, 0 为空
+  uint64_t names_size;
+  uint32_t central_dir_crc32;  // 中央目录原始字节的 CRC-32, verify 时校验
+  uint32_t tail_size;          // ZIP 文件末尾参与校验的字节数(含 EOCD)
+  uint32_t tail_crc32;         // 末尾字节的 CRC-32, 打开时校验
+  uint32_t reserved;
+};
+
+// 条目标志
+enum : uint32_t
+{
+  kIndexEntryDirectory = 1,  // 目录条目
+  kIndexEntryFallback = 2    // 加密/不支持的压缩方法等, 需交给 miniz 处理
+};
+
+struct IndexEntry
+{
+  uint64_t local_header_ofs;  // 本地头的绝对文件偏移
+  uint64_t comp_size;
+  uint64_t uncomp_size;
+  uint64_t name_ofs;  // 文件名在文件名区中的偏移
+  int64_t mtime;
+  uint32_t crc32;
+  uint16_t name_len;
+  uint16_t method;
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+class SidecarIndex
+{
+ public:
+  SidecarIndex();
+  ~SidecarIndex();
+
+  SidecarIndex(const SidecarIndex &) = delete;
+  SidecarIndex &operator=(const SidecarIndex &) = delete;
+
+  // 为已打开(读模式)的 ZIP 写出索引, 先写临时文件再改名, 不会留下半个索引
+  static void write(mz_zip_archive *zip, const std::string &index_path);
+
+  // 完整校验索引与 ZIP 是否匹配, 包括中央目录 CRC-32
+  static bool verify(const std::string &zip_path, const std::string &index_path);
+
+  // 映射索引并打开 ZIP, 只比对文件大小与末尾校验和; 索引缺失、损坏或过期返回 false
+  bool open(const std::string &zip_path, const std::string &index_path, const IoOptions &io);
+
+  size_t size() const
+  {
+    return static_cast<size_t>(header_->entry_count);
+  }
+
+  const IndexEntry &entry(size_t index) const
+  {
+    return entries_[index];
+  }
+
+  std::string name(size_t index) const;
+
+  // 按名查找, 与 miniz 一致忽略 ASCII 大小写; 找不到返回 -1
+  long long find(const std::string &name) const;
+
+  // 解压条目数据并按块交给 sink(返回 false 表示中止), 校验大小与 CRC-32
+  bool extract(size_t index, const std::function<bool(const uint8_t *, size_t)> &sink);
+
+  // 解压条目到调用方缓冲(容量不小于 uncomp_size), scratch 用于读取压缩数据, 为空时临时分配
+  bool extract_to_buffer(size_t index, uint8_t *out, size_t capacity, uint8_t *scratch, size_t scratch_size);
+
+  FILE *archive_file() const
+  {
+    return fp_;
+  }
+
+ private:
+  // 读取本地头并定位到条目数据的起始位置
+  bool seek_to_data(const IndexEntry &e);
+
+  MappedFile map_;
+  const IndexHeader *header_;
+  const IndexEntry *entries_;
+  const uint32_t *slots_;
+  const char *names_;
+  FILE *fp_;
+  IoOptions io_;
+};
+
+}  // namespace zip_compress
+
+#endif  // __GUARD_SIDECAR_INDEX_H_INCLUDE_GUARD__
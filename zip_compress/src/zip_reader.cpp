@@ -5,7 +5,30 @@
 
 #include "zip_compress/zip_reader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <set>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include "dir_scanner.h"
+#include "entry_cache.h"
+#include "file_advice.h"
+#include "output_file.h"
+#include "sidecar_index.h"
+#include "zip_compress/cpu_dispatch.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
 
 // 引入 filesystem 库, 优先使用标准库, 其次使用 ghc::filesystem 作为替代
 #if defined(_MSC_VER)
@@ -29,13 +52,33 @@ namespace fs = ghc::filesystem;
 namespace zip_compress
 {
 
-ZipReader::ZipReader(const std::string &zip_path) : zip_{}, opened_(false)
+namespace
 {
-  if (mz_zip_reader_init_file(&zip_, zip_path.c_str(), 0) == 0)
-  {
-    throw std::runtime_error("Failed to open ZIP file: " + zip_path);
-  }
-  opened_ = true;
+
+// 预设字典条目(ZipWriter::set_dictionary 写入)是其他条目解压所需的数据, 不作为文件列出或解压
+bool is_dictionary_entry(const std::string &name)
+{
+  return name == MZ_ZIP_PRESET_DICT_NAME;
+}
+
+}  // namespace
+
+ZipReader::ZipReader(const std::string &zip_path, const IoOptions &io, ReadMode mode)
+    : zip_{}, opened_(false), zip_path_(zip_path), io_(io)
+{
+  cpu_dispatch();
+  open_archive(mode);
+}
+
+ZipReader::ZipReader(const std::string &zip_path, const std::string &index_path, const IoOptions &io)
+    : zip_{}, opened_(false), zip_path_(zip_path), index_path_(index_path), io_(io)
+{
+  cpu_dispatch();
+  std::unique_ptr<SidecarIndex> index(new SidecarIndex());
+  if (index->open(zip_path, index_path, io_))
+    index_ = std::move(index);
+  else
+    open_archive(ReadMode::lazy);
 }
 
 ZipReader::~ZipReader()
@@ -47,12 +90,39 @@ ZipReader::~ZipReader()
   }
 }
 
+void ZipReader::open_archive(ReadMode mode)
+{
+  zip_.m_io_buf_size = io_.buffer_size;  // 必须在 init 之前设置, 打开文件时据此设置 stdio 缓冲
+  const mz_uint flags = mode == ReadMode::lazy ? MZ_ZIP_FLAG_DEFER_SORT_CENTRAL_DIRECTORY : 0;
+  if (mz_zip_reader_init_file(&zip_, zip_path_.c_str(), flags) == 0)
+  {
+    throw std::runtime_error("Failed to open ZIP file: " + zip_path_);
+  }
+  opened_ = true;
+  if (io_.read_ahead) advise_sequential(mz_zip_get_cfile(&zip_));
+}
+
+mz_zip_archive *ZipReader::archive()
+{
+  if (!opened_) open_archive(ReadMode::lazy);
+  return &zip_;
+}
+
 std::vector<std::string> ZipReader::file_list()
 {
-  if (!opened_) throw std::runtime_error("ZIP file not opened");
+  std::vector<std::string> files;
+  if (index_)
+  {
+    files.reserve(index_->size());
+    for (size_t i = 0; i < index_->size(); ++i)
+    {
+      const std::string name = index_->name(i);
+      if (!is_dictionary_entry(name)) files.emplace_back(fs::path(name).make_preferred().string());
+    }
+    return files;
+  }
 
   mz_uint num_files = mz_zip_reader_get_num_files((&zip_));
-  std::vector<std::string> files;
   files.reserve(num_files);
 
   for (mz_uint i = 0; i < num_files; ++i)
@@ -62,75 +132,448 @@ std::vector<std::string> ZipReader::file_list()
       throw std::runtime_error("Failed to get file info at index: " + std::to_string(i));
 
     // 直接使用 ZIP 内路径，转换为本地分隔符
-    files.emplace_back(fs::path(stat.m_filename).make_preferred().string());
+    if (!is_dictionary_entry(stat.m_filename)) files.emplace_back(fs::path(stat.m_filename).make_preferred().string());
   }
 
   return files;
 }
 
+namespace
+{
+
+// 将目录及其所有祖先目录加入集合, 遇到已存在的祖先即停止
+void add_directory_chain(std::set<std::string> &dirs, std::string dir)
+{
+  while (!dir.empty() && dir.back() == '/') dir.pop_back();
+  while (!dir.empty() && dirs.insert(dir).second)
+  {
+    size_t pos = dir.find_last_of('/');
+    if (pos == std::string::npos) break;
+    dir.resize(pos);
+  }
+}
+
+// 判断目标文件是否已与条目一致: 大小相同且修改时间一致(DOS 时间精度 2 秒).
+// verify_crc 时改为比较 CRC-32(mz_crc32 已由 cpu_dispatch 绑定最快的内核), 内容一致而时间不同时把修改时间改回条目时间,
+// 下次同步只需比较时间
+bool file_up_to_date(const std::string &path, const EntryInfo &info, bool verify_crc, const IoOptions &io)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG) return false;
+  if (static_cast<uint64_t>(st.st_size) != info.uncomp_size) return false;
+  if (!verify_crc)
+  {
+    const auto diff = st.st_mtime - info.mtime;
+    return diff == 0 || diff == 1;
+  }
+
+  FILE *fp = std::fopen(path.c_str(), "rb");
+  if (fp == nullptr) return false;
+  if (io.buffer_size != 0) std::setvbuf(fp, nullptr, _IOFBF, io.buffer_size);
+  if (io.read_ahead) advise_sequential(fp);
+  std::vector<uint8_t> buf(io.buffer_size != 0 ? io.buffer_size : 64 * 1024);
+  mz_ulong crc = MZ_CRC32_INIT;
+  size_t n;
+  while ((n = std::fread(buf.data(), 1, buf.size(), fp)) > 0) crc = mz_crc32(crc, buf.data(), n);
+  const bool ok = std::ferror(fp) == 0;
+  std::fclose(fp);
+  if (!ok || static_cast<uint32_t>(crc) != info.crc32) return false;
+
+  if (st.st_mtime != info.mtime)
+  {
+    struct utimbuf times;
+    times.actime = info.mtime;
+    times.modtime = info.mtime;
+    utime(path.c_str(), &times);
+  }
+  return true;
+}
+
+// extract_all 的工作线程数, 0 为自动(硬件线程数, 最多 8)
+size_t extract_threads(size_t threads)
+{
+  if (threads != 0) return threads;
+  const size_t n = std::thread::hardware_concurrency();
+  return n == 0 ? 1 : std::min<size_t>(n, 8);
+}
+
+}  // namespace
+
 void ZipReader::extract_all(const std::string &output_folder)
 {
-  if (!opened_) throw std::runtime_error("ZIP file not opened");
+  // 第一遍只读中央目录(或边车索引)收集条目名
+  const mz_uint num_files = entry_count();
+  std::vector<SelectedEntry> entries;
+  entries.reserve(num_files);
+  for (mz_uint i = 0; i < num_files; ++i)
+  {
+    bool is_directory;
+    std::string name = entry_name(i, is_directory);
+    if (!is_dictionary_entry(name)) entries.push_back(SelectedEntry{i, std::move(name), is_directory});
+  }
+  extract_entries(output_folder, entries, 1);
+}
 
-  fs::create_directories(output_folder);
-  mz_uint num_files = mz_zip_reader_get_num_files(&zip_);
+void ZipReader::extract_all(const std::string &output_folder, const EntryRules &rules, size_t threads)
+{
+  const mz_uint num_files = entry_count();
+  std::vector<SelectedEntry> selected;
   for (mz_uint i = 0; i < num_files; ++i)
   {
-    mz_zip_archive_file_stat stat;
-    if (mz_zip_reader_file_stat(&zip_, i, &stat) == 0)
-      throw std::runtime_error("Failed to get file info at index: " + std::to_string(i));
+    bool is_directory;
+    std::string name = entry_name(i, is_directory);
+    if (!is_dictionary_entry(name) && rules.accepts_entry(name, is_directory))
+      selected.push_back(SelectedEntry{i, std::move(name), is_directory});
+  }
+  extract_entries(output_folder, selected, extract_threads(threads));
+}
+
+void ZipReader::extract_all(const std::string &output_folder, const EntrySelector &selector, size_t threads)
+{
+  if (!selector) throw std::invalid_argument("extract_all: selector is empty");
+
+  const mz_uint num_files = entry_count();
+  std::vector<SelectedEntry> selected;
+  for (mz_uint i = 0; i < num_files; ++i)
+  {
+    EntryInfo info = entry_info(i);
+    if (!is_dictionary_entry(info.name) && selector(info))
+      selected.push_back(SelectedEntry{i, std::move(info.name), info.is_directory});
+  }
+  extract_entries(output_folder, selected, extract_threads(threads));
+}
+
+SyncManifest ZipReader::extract_sync(const std::string &output_folder, const SyncOptions &options)
+{
+  // 第一遍只读中央目录(或边车索引): 条目名与比较所需的大小、修改时间、CRC-32
+  const mz_uint num_files = entry_count();
+  std::vector<SelectedEntry> entries;
+  std::vector<EntryInfo> infos;
+  std::unordered_set<std::string> names;  // ZIP 中的文件, 用于找出目标目录中多余的文件
+  entries.reserve(num_files);
+  infos.reserve(num_files);
+  for (mz_uint i = 0; i < num_files; ++i)
+  {
+    EntryInfo info = entry_info(i);
+    if (is_dictionary_entry(info.name)) continue;
+    entries.push_back(SelectedEntry{i, info.name, info.is_directory});
+    if (!info.is_directory) names.insert(info.name);
+    infos.push_back(std::move(info));
+  }
+
+  // 比较在工作线程中进行, 每个位置只由领取它的线程写入
+  std::vector<char> fresh(entries.size(), 0);
+  extract_entries(output_folder, entries, extract_threads(options.threads),
+                  [this, &infos, &fresh, &options](size_t position, const std::string &output_path) {
+                    fresh[position] = file_up_to_date(output_path, infos[position], options.verify_crc, io_) ? 1 : 0;
+                    return fresh[position] != 0;
+                  });
 
-    fs::path out_path = fs::path(output_folder) / stat.m_filename;
-    if (stat.m_is_directory != 0)  // 是目录则创建目录
+  SyncManifest manifest;
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    if (entries[i].is_directory) continue;
+    if (fresh[i] != 0)
+      ++manifest.unchanged;
+    else
+      manifest.updated.push_back(entries[i].name);
+  }
+
+  // 并行遍历目标目录, 找出 ZIP 中没有的文件
+  DirScanner scanner(output_folder, extract_threads(options.threads));
+  ScannedFile file;
+  while (scanner.next(file))
+  {
+    std::string name = fs::path(file.name).generic_string();
+    if (names.count(name) != 0) continue;
+    if (options.delete_extras)
+    {
+      std::error_code ec;
+      fs::remove(file.path, ec);
+      if (ec) throw std::runtime_error("Failed to delete file: " + file.path);
+    }
+    manifest.extras.push_back(std::move(name));
+  }
+  std::sort(manifest.extras.begin(), manifest.extras.end());
+  return manifest;
+}
+
+void ZipReader::extract_entries(const std::string &output_folder, const std::vector<SelectedEntry> &entries,
+                                size_t threads, const SkipCheck &skip)
+{
+  stats_ = ExtractStats();
+  const fs::path root(output_folder);
+  created_dirs_.erase(root.string());  // 输出目录可能已被外部删除, 重新确认
+  ensure_directory(root.string());
+
+  // 预先计算需要的唯一目录集合
+  std::set<std::string> dirs;  // 字典序即拓扑序: 父目录总是排在子目录之前
+  std::vector<const SelectedEntry *> files;
+  for (const auto &entry : entries)
+  {
+    if (entry.is_directory)  // 是目录则目录本身需要存在
     {
-      fs::create_directories(out_path);
+      add_directory_chain(dirs, entry.name);
       continue;
     }
-    fs::create_directories(out_path.parent_path());
+    size_t pos = entry.name.find_last_of('/');
+    if (pos != std::string::npos) add_directory_chain(dirs, entry.name.substr(0, pos));
+    files.push_back(&entry);
+  }
+
+  // 按拓扑序逐个 mkdir, 父目录已存在, 每个目录只需一次调用
+  for (const auto &dir : dirs)
+  {
+    fs::path dir_path = root / dir;
+    std::error_code ec;
+    fs::create_directory(dir_path, ec);
+    ++stats_.directory_syscalls;
+    if (ec) throw std::runtime_error("Failed to create directory: " + dir_path.string());
+    created_dirs_.insert(dir_path.string());
+  }
+
+  // 全部解压时条目数据位于中央目录之前且按偏移顺序存放, 一次性提示预读整段数据区;
+  // 部分解压或可能跳过条目时只提示实际解压的条目, 不读取其余条目的数据
+  const mz_uint num_files = entry_count();
+  const bool whole = entries.size() == num_files && !skip;
+  if (io_.read_ahead && whole)
+  {
+    if (index_)
+      advise_willneed(index_->archive_file(), 0, 0);
+    else
+      advise_willneed(mz_zip_get_cfile(&zip_), 0, zip_.m_central_directory_file_ofs);
+  }
 
-    if (mz_zip_reader_extract_to_file(&zip_, i, out_path.string().c_str(), 0) == 0)
+  // 第二遍解压文件, 不再做逐条目的目录检查
+  std::atomic<size_t> extracted(0);
+  auto extract_with = [&root, whole, &entries, &skip, &extracted](ZipReader &reader, const SelectedEntry &entry) {
+    const fs::path out_path = root / entry.name;
+    if (skip && skip(static_cast<size_t>(&entry - entries.data()), out_path.string())) return;
+    if (!whole) reader.advise_entry(entry.index);
+    bool open_failed = false;
+    if (!reader.extract_to_path(entry.index, out_path.string(), open_failed))
     {
       throw std::runtime_error("Failed to extract file: " + out_path.string());
     }
+    ++extracted;
+  };
+
+  threads = std::min(threads, files.size());
+  if (threads <= 1)
+  {
+    for (const SelectedEntry *entry : files) extract_with(*this, *entry);
   }
+  else
+  {
+    // miniz 的读取句柄不能跨线程共享: 工作线程各自打开 ZIP(边车索引或 lazy 模式, 都不排序中央目录),
+    // 当前线程使用本对象. 条目按原子计数逐个领取, 大小不均时自动均衡
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto work = [&](ZipReader *reader) {
+      try
+      {
+        std::unique_ptr<ZipReader> own;
+        if (reader == nullptr)
+        {
+          own.reset(index_ ? new ZipReader(zip_path_, index_path_, io_)
+                           : new ZipReader(zip_path_, io_, ReadMode::lazy));
+          reader = own.get();
+        }
+        for (size_t k = next++; k < files.size() && !failed; k = next++) extract_with(*reader, *files[k]);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+        failed = true;
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t) workers.emplace_back(work, nullptr);
+    work(this);
+    for (auto &worker : workers) worker.join();
+    if (error) std::rethrow_exception(error);
+  }
+
+  stats_.entries = num_files;
+  stats_.files_extracted = extracted;
+  stats_.entries_skipped = num_files - entries.size();
+  stats_.directories = dirs.size();
 }
 
 void ZipReader::extract_file(const std::string &file_name_in_zip, const std::string &output_path)
 {
-  if (!opened_) throw std::runtime_error("ZIP file not opened");
-
-  int file_index = mz_zip_reader_locate_file(&zip_, file_name_in_zip.c_str(), nullptr, 0);
+  long long file_index = locate(file_name_in_zip);
   if (file_index < 0)
   {
     throw std::runtime_error("File not found in ZIP: " + file_name_in_zip);
   }
 
-  fs::create_directories(fs::path(output_path).parent_path());
+  stats_ = ExtractStats();
+  stats_.entries = 1;
+  const std::string parent = fs::path(output_path).parent_path().string();
+  if (!parent.empty())
+  {
+    stats_.directories = 1;
+    ensure_directory(parent);
+  }
 
-  if (mz_zip_reader_extract_to_file(&zip_, file_index, output_path.c_str(), 0) == 0)
+  advise_entry(static_cast<mz_uint>(file_index));
+  bool open_failed = false;
+  if (!extract_to_path(static_cast<mz_uint>(file_index), output_path, open_failed))
   {
-    throw std::runtime_error("Failed to extract file: " + output_path);
+    // 缓存的目录可能已被外部删除, 重新创建后重试一次
+    bool retried = false;
+    if (!parent.empty() && open_failed)
+    {
+      created_dirs_.erase(parent);
+      ensure_directory(parent);
+      retried = extract_to_path(static_cast<mz_uint>(file_index), output_path, open_failed);
+    }
+    if (!retried) throw std::runtime_error("Failed to extract file: " + output_path);
   }
+  stats_.files_extracted = 1;
 }
 
 std::vector<uint8_t> ZipReader::extract_file_to_memory(const std::string &file_name_in_zip)
 {
-  if (!opened_) throw std::runtime_error("ZIP file not opened");
+  if (cache_) return *extract_file_shared(file_name_in_zip);
+
+  long long file_index = locate(file_name_in_zip);
+  if (file_index < 0)
+  {
+    throw std::runtime_error("File not found in ZIP: " + file_name_in_zip);
+  }
+  return extract_index_to_memory(static_cast<mz_uint>(file_index), file_name_in_zip);
+}
 
-  int file_index = mz_zip_reader_locate_file(&zip_, file_name_in_zip.c_str(), nullptr, 0);
+size_t ZipReader::entry_size(const std::string &file_name_in_zip)
+{
+  long long file_index = locate(file_name_in_zip);
   if (file_index < 0)
   {
     throw std::runtime_error("File not found in ZIP: " + file_name_in_zip);
   }
+  return static_cast<size_t>(entry_size_at(static_cast<mz_uint>(file_index), file_name_in_zip));
+}
+
+size_t ZipReader::extract_file_to_buffer(const std::string &file_name_in_zip, void *buffer, size_t capacity,
+                                         void *scratch, size_t scratch_size)
+{
+  long long file_index = locate(file_name_in_zip);
+  if (file_index < 0)
+  {
+    throw std::runtime_error("File not found in ZIP: " + file_name_in_zip);
+  }
+  const mz_uint index = static_cast<mz_uint>(file_index);
+  const uint64_t size = entry_size_at(index, file_name_in_zip);
+  if (size > capacity) throw std::invalid_argument("extract_file_to_buffer: buffer too small for " + file_name_in_zip);
+  if (buffer == nullptr && size != 0) throw std::invalid_argument("extract_file_to_buffer: buffer is null");
+
+  if (cache_)
+  {
+    EntryCache::Buffer hit = cache_->get(index);
+    if (hit)
+    {
+      if (!hit->empty()) std::memcpy(buffer, hit->data(), hit->size());
+      return hit->size();
+    }
+  }
+
+  advise_entry(index);
+  bool ok;
+  if (index_ && (index_->entry(index).flags & kIndexEntryFallback) == 0)
+    ok = index_->extract_to_buffer(index, static_cast<uint8_t *>(buffer), capacity, static_cast<uint8_t *>(scratch),
+                                   scratch_size);
+  else
+    ok = mz_zip_reader_extract_to_mem_no_alloc(archive(), index, buffer, capacity, 0, scratch, scratch_size) != 0;
+  if (!ok) throw std::runtime_error("Failed to extract file to buffer: " + file_name_in_zip);
+  return static_cast<size_t>(size);
+}
+
+uint64_t ZipReader::entry_size_at(mz_uint file_index, const std::string &file_name_in_zip)
+{
+  if (index_) return index_->entry(file_index).uncomp_size;
 
   mz_zip_archive_file_stat stat;
   if (mz_zip_reader_file_stat(&zip_, file_index, &stat) == 0)
   {
     throw std::runtime_error("Failed to get file info: " + file_name_in_zip);
   }
+  return stat.m_uncomp_size;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> ZipReader::extract_file_shared(const std::string &file_name_in_zip)
+{
+  long long file_index;
+  {
+    std::lock_guard<std::mutex> lock(read_mutex_);
+    file_index = locate(file_name_in_zip);
+  }
+  if (file_index < 0)
+  {
+    throw std::runtime_error("File not found in ZIP: " + file_name_in_zip);
+  }
+
+  const mz_uint index = static_cast<mz_uint>(file_index);
+  if (cache_)
+  {
+    EntryCache::Buffer hit = cache_->get(index);
+    if (hit) return hit;
+  }
+
+  EntryCache::Buffer data;
+  {
+    std::lock_guard<std::mutex> lock(read_mutex_);
+    data = std::make_shared<const std::vector<uint8_t>>(extract_index_to_memory(index, file_name_in_zip));
+  }
+  if (cache_) cache_->put(index, data);
+  return data;
+}
+
+void ZipReader::set_cache(size_t capacity_bytes, size_t shards)
+{
+  if (capacity_bytes == 0)
+  {
+    cache_.reset();
+    return;
+  }
+  if (shards == 0) throw std::invalid_argument("set_cache: shards must be positive");
+  cache_.reset(new EntryCache(capacity_bytes, shards));
+}
+
+CacheStats ZipReader::cache_stats() const
+{
+  return cache_ ? cache_->stats() : CacheStats();
+}
+
+std::vector<uint8_t> ZipReader::extract_index_to_memory(mz_uint file_index, const std::string &file_name_in_zip)
+{
+  advise_entry(file_index);
+  std::vector<uint8_t> buffer;
+  if (index_ && (index_->entry(file_index).flags & kIndexEntryFallback) == 0)
+  {
+    buffer.reserve(static_cast<size_t>(index_->entry(file_index).uncomp_size));
+    if (!index_->extract(file_index, [&buffer](const uint8_t *data, size_t size) {
+          buffer.insert(buffer.end(), data, data + size);
+          return true;
+        }))
+      throw std::runtime_error("Failed to extract file to memory: " + file_name_in_zip);
+    return buffer;
+  }
+
+  mz_zip_archive *zip = archive();
+  mz_zip_archive_file_stat stat;
+  if (mz_zip_reader_file_stat(zip, file_index, &stat) == 0)
+  {
+    throw std::runtime_error("Failed to get file info: " + file_name_in_zip);
+  }
 
-  std::vector<uint8_t> buffer(stat.m_uncomp_size);
-  if (mz_zip_reader_extract_to_mem(&zip_, file_index, buffer.data(), buffer.size(), 0) == 0)
+  buffer.resize(stat.m_uncomp_size);
+  if (mz_zip_reader_extract_to_mem(zip, file_index, buffer.data(), buffer.size(), 0) == 0)
   {
     throw std::runtime_error("Failed to extract file to memory: " + file_name_in_zip);
   }
@@ -138,4 +581,219 @@ std::vector<uint8_t> ZipReader::extract_file_to_memory(const std::string &file_n
   return buffer;
 }
 
+void ZipReader::write_index(const std::string &index_path)
+{
+  SidecarIndex::write(archive(), index_path);
+}
+
+bool ZipReader::verify_index(const std::string &zip_path, const std::string &index_path)
+{
+  return SidecarIndex::verify(zip_path, index_path);
+}
+
+EntryInfo ZipReader::entry_info(mz_uint file_index)
+{
+  EntryInfo info;
+  if (index_)
+  {
+    const IndexEntry &e = index_->entry(file_index);
+    info.name = index_->name(file_index);
+    info.comp_size = e.comp_size;
+    info.uncomp_size = e.uncomp_size;
+    info.crc32 = e.crc32;
+    info.mtime = static_cast<time_t>(e.mtime);
+    info.is_directory = (e.flags & kIndexEntryDirectory) != 0;
+    return info;
+  }
+
+  mz_zip_archive_file_stat stat;
+  if (mz_zip_reader_file_stat(&zip_, file_index, &stat) == 0)
+    throw std::runtime_error("Failed to get file info at index: " + std::to_string(file_index));
+  info.name = stat.m_filename;
+  info.comp_size = stat.m_comp_size;
+  info.uncomp_size = stat.m_uncomp_size;
+  info.crc32 = stat.m_crc32;
+  info.mtime = stat.m_time;
+  info.is_directory = stat.m_is_directory != 0;
+  return info;
+}
+
+mz_uint ZipReader::entry_count()
+{
+  return index_ ? static_cast<mz_uint>(index_->size()) : mz_zip_reader_get_num_files(&zip_);
+}
+
+std::string ZipReader::entry_name(mz_uint file_index, bool &is_directory)
+{
+  if (index_)
+  {
+    is_directory = (index_->entry(file_index).flags & kIndexEntryDirectory) != 0;
+    return index_->name(file_index);
+  }
+
+  char name_buf[MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE];
+  mz_uint len = mz_zip_reader_get_filename(&zip_, file_index, name_buf, sizeof(name_buf));
+  if (len == 0) throw std::runtime_error("Failed to get file info at index: " + std::to_string(file_index));
+  is_directory = mz_zip_reader_is_file_a_directory(&zip_, file_index) != 0;
+  return std::string(name_buf, len - 1);
+}
+
+long long ZipReader::locate(const std::string &file_name_in_zip)
+{
+  if (index_) return index_->find(file_name_in_zip);
+  return mz_zip_reader_locate_file(&zip_, file_name_in_zip.c_str(), nullptr, 0);
+}
+
+namespace
+{
+
+// miniz 的写出回调, 数据按偏移顺序到达
+size_t write_output(void *opaque, mz_uint64 file_ofs, const void *buf, size_t n)
+{
+  (void)file_ofs;
+  return static_cast<OutputFile *>(opaque)->write(buf, n) ? n : 0;
+}
+
+const size_t kLocalHeaderSize = 30;
+const uint32_t kLocalHeaderSig = 0x04034b50;
+
+// 读取本地头, 得到条目数据在 ZIP 文件中的绝对偏移; 本地头的文件名/扩展字段长度可能与中央目录不同, 以本地头为准
+bool local_data_offset(FILE *fp, uint64_t header_ofs, uint64_t &data_ofs)
+{
+#ifdef _WIN32
+  (void)fp;
+  (void)header_ofs;
+  (void)data_ofs;
+  return false;
+#else
+  uint8_t h[kLocalHeaderSize];
+  if (pread(fileno(fp), h, sizeof(h), static_cast<off_t>(header_ofs)) != static_cast<ssize_t>(sizeof(h))) return false;
+  const uint32_t sig = h[0] | (h[1] << 8) | (h[2] << 16) | (static_cast<uint32_t>(h[3]) << 24);
+  if (sig != kLocalHeaderSig) return false;
+  data_ofs = header_ofs + kLocalHeaderSize + (h[26] | (h[27] << 8)) + (h[28] | (h[29] << 8));
+  return true;
+#endif
+}
+
+// 内核拷贝不经过用户态, 拷贝后从 ZIP 文件再读一遍数据区计算 CRC-32, 与 miniz 解压路径一样校验完整性
+bool stored_crc_matches(FILE *fp, uint64_t data_ofs, uint64_t size, uint32_t expected, size_t buffer_size)
+{
+#ifdef _WIN32
+  (void)fp;
+  (void)data_ofs;
+  (void)size;
+  (void)expected;
+  (void)buffer_size;
+  return false;
+#else
+  std::vector<uint8_t> buf(std::max<size_t>(buffer_size, 64 * 1024));
+  mz_ulong crc = MZ_CRC32_INIT;
+  while (size > 0)
+  {
+    const size_t want = static_cast<size_t>(std::min<uint64_t>(size, buf.size()));
+    const ssize_t n = pread(fileno(fp), buf.data(), want, static_cast<off_t>(data_ofs));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    crc = mz_crc32(crc, buf.data(), static_cast<size_t>(n));
+    data_ofs += static_cast<uint64_t>(n);
+    size -= static_cast<uint64_t>(n);
+  }
+  return static_cast<uint32_t>(crc) == expected;
+#endif
+}
+
+}  // namespace
+
+bool ZipReader::extract_to_path(mz_uint file_index, const std::string &output_path, bool &open_failed)
+{
+  open_failed = false;
+  const bool use_index = index_ && (index_->entry(file_index).flags & kIndexEntryFallback) == 0;
+  uint64_t size;
+  uint32_t crc32;
+  time_t mtime;
+  mz_zip_archive *zip = nullptr;
+  FILE *stored_fp = nullptr;  // 非空表示 STORED 条目, 数据从 header_ofs 处的本地头之后开始
+  uint64_t header_ofs = 0;
+  if (use_index)
+  {
+    const IndexEntry &e = index_->entry(file_index);
+    size = e.uncomp_size;
+    crc32 = e.crc32;
+    mtime = static_cast<time_t>(e.mtime);
+    if (e.method == 0)
+    {
+      stored_fp = index_->archive_file();
+      header_ofs = e.local_header_ofs;
+    }
+  }
+  else
+  {
+    zip = archive();
+    mz_zip_archive_file_stat stat;
+    if (mz_zip_reader_file_stat(zip, file_index, &stat) == 0) return false;
+    size = stat.m_uncomp_size;
+    crc32 = stat.m_crc32;
+    mtime = stat.m_time;
+    if (stat.m_method == 0 && !stat.m_is_encrypted && stat.m_is_supported && stat.m_comp_size == size)
+    {
+      stored_fp = mz_zip_get_cfile(zip);
+      header_ofs = mz_zip_get_archive_file_start_offset(zip) + stat.m_local_header_ofs;
+    }
+  }
+
+  // STORED 条目的数据就是文件内容, 跳过 miniz 直接从 ZIP 文件拷贝
+  uint64_t data_ofs = 0;
+  const bool copy_stored = io_.kernel_copy && stored_fp != nullptr && size > 0 &&
+                           local_data_offset(stored_fp, header_ofs, data_ofs);
+
+  // 解压后大小已知, 输出文件据此预分配并选择写入方式
+  OutputFile out;
+  if (!out.open(output_path, size, io_))
+  {
+    open_failed = true;
+    return false;
+  }
+  bool ok;
+  if (copy_stored)
+    ok = out.copy_from(fileno(stored_fp), data_ofs, size) &&
+         stored_crc_matches(stored_fp, data_ofs, size, crc32, io_.buffer_size);
+  else if (use_index)
+    ok = index_->extract(file_index, [&out](const uint8_t *data, size_t n) { return out.write(data, n); });
+  else
+    ok = mz_zip_reader_extract_to_callback(zip, file_index, write_output, &out, 0) != 0;
+  ok = out.close() && ok;
+  if (!ok) return false;
+
+  // 与 miniz 一致, 恢复条目的修改时间
+  struct utimbuf times;
+  times.actime = mtime;
+  times.modtime = mtime;
+  utime(output_path.c_str(), &times);
+  return true;
+}
+
+void ZipReader::advise_entry(mz_uint file_index)
+{
+  if (!io_.read_ahead) return;
+  // 本地头变长部分(文件名 + 扩展字段)未知, 多预读一段余量
+  const uint64_t header_slack = 64 * 1024;
+  if (index_)
+  {
+    const IndexEntry &e = index_->entry(file_index);
+    advise_willneed(index_->archive_file(), e.local_header_ofs, e.comp_size + header_slack);
+    return;
+  }
+  mz_zip_archive_file_stat stat;
+  if (mz_zip_reader_file_stat(&zip_, file_index, &stat) == 0) return;
+  advise_willneed(mz_zip_get_cfile(&zip_), stat.m_local_header_ofs, stat.m_comp_size + header_slack);
+}
+
+void ZipReader::ensure_directory(const std::string &dir)
+{
+  if (created_dirs_.count(dir) != 0) return;
+  fs::create_directories(dir);
+  ++stats_.directory_syscalls;
+  created_dirs_.insert(dir);
+}
+
 }  // namespace zip_compress
\ No newline at end of file
@@ -5,7 +5,32 @@
 
 #include "zip_compress/zip_writer.h"
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <mutex>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "archive_deflate.h"
+#include "content_hash.h"
+#include "dictionary_trainer.h"
+#include "dir_scanner.h"
+#include "file_advice.h"
+#include "zip_compress/cpu_dispatch.h"
+#include "zip_compress/zip_reader.h"
 
 // 引入 filesystem 库, 优先使用标准库, 其次使用 ghc::filesystem 作为替代
 #if defined(_MSC_VER)
@@ -29,9 +54,298 @@ namespace fs = ghc::filesystem;
 namespace zip_compress
 {
 
-ZipWriter::ZipWriter(const std::string &zip_path) : zip_{}, finished_(false)
+namespace
+{
+
+// 开启去重时不超过该大小的文件只读一次: 整体读入内存后计算指纹并从内存压缩; 更大的文件先流式计算指纹,
+// 未命中再读第二遍压缩
+const uint64_t kDedupReadOnceLimit = 4 * 1024 * 1024;
+
+// 打开源文件用于顺序读取, 按 io 设置 stdio 缓冲与预读提示
+FILE *open_source(const std::string &path, const IoOptions &io)
+{
+  FILE *fp = std::fopen(path.c_str(), "rb");
+  if (fp == nullptr) return nullptr;
+  if (io.buffer_size != 0) std::setvbuf(fp, nullptr, _IOFBF, io.buffer_size);
+  if (io.read_ahead) advise_sequential(fp);
+  return fp;
+}
+
+// 源文件的读取块大小
+size_t read_chunk_size(const IoOptions &io)
+{
+  return io.buffer_size != 0 ? io.buffer_size : 64 * 1024;
+}
+
+// 流式计算磁盘文件的内容指纹, 打不开时返回 false
+bool hash_file(const std::string &path, const IoOptions &io, ContentKey &key)
+{
+  FILE *fp = open_source(path, io);
+  if (fp == nullptr) return false;
+
+  ContentHasher hasher;
+  std::vector<char> buf(read_chunk_size(io));
+  size_t n;
+  while ((n = std::fread(buf.data(), 1, buf.size(), fp)) > 0) hasher.update(buf.data(), n);
+  const bool ok = std::ferror(fp) == 0;
+  std::fclose(fp);
+
+  key = hasher.digest();
+  return ok;
+}
+
+// 读取整个文件到内存, 失败返回 false
+bool read_file(const std::string &path, const IoOptions &io, std::vector<uint8_t> &content)
+{
+  FILE *fp = open_source(path, io);
+  if (fp == nullptr) return false;
+
+  content.clear();
+  std::vector<uint8_t> buf(read_chunk_size(io));
+  size_t n;
+  while ((n = std::fread(buf.data(), 1, buf.size(), fp)) > 0) content.insert(content.end(), buf.data(), buf.data() + n);
+  const bool ok = std::ferror(fp) == 0;
+  std::fclose(fp);
+  return ok;
+}
+
+// 判断磁盘文件与旧条目内容是否相同: 大小一致时, 修改时间一致(DOS 时间精度 2 秒)即视为未变,
+// 时间不一致(如仅被 touch)再读文件比较 CRC-32
+bool same_as_entry(mz_zip_archive *zip, mz_uint file_index, const std::string &path, const IoOptions &io)
+{
+  mz_zip_archive_file_stat st;
+  if (!mz_zip_reader_file_stat(zip, file_index, &st)) return false;
+  if (st.m_method == MZ_DEFLATED_PRESET_DICT) return false;  // 依赖旧 ZIP 的字典, 不能原样复制, 重新压缩
+
+  std::error_code ec;
+  const auto size = fs::file_size(path, ec);
+  if (ec || size != st.m_uncomp_size) return false;
+
+  struct stat file_st;
+  if (stat(path.c_str(), &file_st) != 0) return false;
+  const auto diff = file_st.st_mtime - st.m_time;
+  if (diff == 0 || diff == 1) return true;
+
+  ContentKey key;
+  return hash_file(path, io, key) && key.crc32 == st.m_crc32;
+}
+
+// 解压第 file_index 个条目的全部内容
+bool extract_entry(mz_zip_archive *zip, mz_uint file_index, std::vector<uint8_t> &content)
+{
+  mz_zip_archive_file_stat st;
+  if (!mz_zip_reader_file_stat(zip, file_index, &st)) return false;
+  content.resize(static_cast<size_t>(st.m_uncomp_size));
+  return mz_zip_reader_extract_to_mem(zip, file_index, content.data(), content.size(), 0) != 0;
+}
+
+// mz_zip_reader_extract_to_callback 的回调: 解压出的数据交给 ContentHasher
+size_t hash_output(void *opaque, mz_uint64 ofs, const void *buf, size_t n)
+{
+  (void)ofs;
+  static_cast<ContentHasher *>(opaque)->update(buf, n);
+  return n;
+}
+
+// 读取 ZIP 中字典条目的内容, 没有字典条目时返回空
+std::vector<uint8_t> read_preset_dictionary(mz_zip_archive *zip)
+{
+  std::vector<uint8_t> dict;
+  const int index = mz_zip_reader_locate_file(zip, MZ_ZIP_PRESET_DICT_NAME, nullptr, MZ_ZIP_FLAG_CASE_SENSITIVE);
+  if (index >= 0 && !extract_entry(zip, static_cast<mz_uint>(index), dict))
+    throw std::runtime_error("Failed to read preset dictionary from ZIP");
+  return dict;
+}
+
+// 1980-01-01 00:00:00 UTC, DOS 时间能表示的最早时刻
+const long long kDosEpoch = 315532800LL;
+
+// 可复现模式的固定修改时间. miniz 按本地时区把 time_t 转为 DOS 时间, 因此先求出目标时刻的 UTC 日历字段,
+// 再用 mktime 按本地时区反推, 写入的 DOS 字段便与时区无关(目标时刻恰好落在本地夏令时跳变的空缺小时内除外)
+MZ_TIME_T reproducible_time()
+{
+  std::tm tm = std::tm();
+  const char *epoch = std::getenv("SOURCE_DATE_EPOCH");
+  if (epoch != nullptr && *epoch != '\0')
+  {
+    char *end = nullptr;
+    errno = 0;
+    const long long seconds = std::strtoll(epoch, &end, 10);
+    if (*end != '\0' || errno == ERANGE || seconds < 0)
+      throw std::invalid_argument(std::string("set_reproducible: invalid SOURCE_DATE_EPOCH: ") + epoch);
+
+    const std::time_t t = static_cast<std::time_t>(std::max(seconds, kDosEpoch));
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+  }
+  else
+  {
+    tm.tm_year = 80;
+    tm.tm_mday = 1;
+  }
+  tm.tm_isdst = -1;
+  return std::mktime(&tm);
+}
+
+const size_t kBatchBytes = 32 << 20;     // add_data_batch 每批压缩的数据量, 压缩输出共用一块同样大小的内存
+const size_t kBatchWriteSize = 1 << 20;  // add_data_batch 合并写出的块大小下限
+
+// 批量写入期间接管 miniz 的写出回调: 偏移连续的小块写出先合并到缓冲, 攒满或不连续时一次写入 ZIP 文件.
+// 读取回调一并接管, 读取前先写出缓冲(去重复制条目时会读回已写入的数据). 析构时恢复原回调
+class CoalescingWriter
+{
+ public:
+  CoalescingWriter(mz_zip_archive *zip, size_t capacity)
+      : zip_(zip),
+        write_(zip->m_pWrite),
+        read_(zip->m_pRead),
+        opaque_(zip->m_pIO_opaque),
+        base_(0),
+        capacity_(capacity)
+  {
+    buf_.reserve(capacity);
+    zip->m_pWrite = &CoalescingWriter::write_func;
+    zip->m_pRead = read_ != nullptr ? &CoalescingWriter::read_func : nullptr;
+    zip->m_pIO_opaque = this;
+  }
+
+  ~CoalescingWriter()
+  {
+    flush();
+    zip_->m_pWrite = write_;
+    zip_->m_pRead = read_;
+    zip_->m_pIO_opaque = opaque_;
+  }
+
+  CoalescingWriter(const CoalescingWriter &) = delete;
+  CoalescingWriter &operator=(const CoalescingWriter &) = delete;
+
+  // 写出缓冲中剩余的数据
+  bool flush()
+  {
+    if (buf_.empty()) return true;
+    const bool ok = write_(opaque_, base_, buf_.data(), buf_.size()) == buf_.size();
+    base_ += buf_.size();
+    buf_.clear();
+    return ok;
+  }
+
+ private:
+  static size_t write_func(void *opaque, mz_uint64 file_ofs, const void *data, size_t n)
+  {
+    return static_cast<CoalescingWriter *>(opaque)->write(file_ofs, data, n) ? n : 0;
+  }
+
+  static size_t read_func(void *opaque, mz_uint64 file_ofs, void *data, size_t n)
+  {
+    CoalescingWriter *self = static_cast<CoalescingWriter *>(opaque);
+    return self->flush() ? self->read_(self->opaque_, file_ofs, data, n) : 0;
+  }
+
+  bool write(mz_uint64 file_ofs, const void *data, size_t n)
+  {
+    if (file_ofs != base_ + buf_.size() || buf_.size() + n > capacity_)
+    {
+      if (!flush()) return false;
+      base_ = file_ofs;
+    }
+    if (n >= capacity_)
+    {
+      base_ = file_ofs + n;
+      return write_(opaque_, file_ofs, data, n) == n;
+    }
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    buf_.insert(buf_.end(), p, p + n);
+    return true;
+  }
+
+  mz_zip_archive *zip_;
+  mz_file_write_func write_;
+  mz_file_read_func read_;
+  void *opaque_;
+  mz_uint64 base_;  // 缓冲首字节在 ZIP 文件中的偏移
+  size_t capacity_;
+  std::vector<uint8_t> buf_;
+};
+
+// 把 size 字节的数据压缩到 out(容量为 size), 返回压缩后的大小; 不压缩或压缩没有收益时返回 0, 由调用方存储.
+// dict 不为空时以预设字典预热压缩窗口, 归档级别改用 MZ_UBER_COMPRESSION
+size_t compress_to(tdefl_compressor *comp, int level, const uint8_t *data, size_t size, uint8_t *out,
+                   const std::vector<uint8_t> *dict)
+{
+  if (level == MZ_NO_COMPRESSION || size <= 3) return 0;
+  if (level == kArchiveLevel && dict == nullptr)
+  {
+    const std::vector<uint8_t> deflated = archive_deflate(data, size);
+    if (deflated.size() >= size) return 0;
+    std::memcpy(out, deflated.data(), deflated.size());
+    return deflated.size();
+  }
+
+  const mz_uint flags = tdefl_create_comp_flags_from_zip_params(std::min<int>(level, MZ_UBER_COMPRESSION),
+                                                                -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+  if (tdefl_init(comp, nullptr, nullptr, static_cast<int>(flags)) != TDEFL_STATUS_OKAY) return 0;
+  if (dict != nullptr && tdefl_set_dictionary(comp, dict->data(), dict->size()) != TDEFL_STATUS_OKAY) return 0;
+  size_t in_size = size;
+  size_t out_size = size;
+  // 输出缓冲只有原大小, 写不下说明压缩没有收益
+  const tdefl_status status = tdefl_compress(comp, data, &in_size, out, &out_size, TDEFL_FINISH);
+  return status == TDEFL_STATUS_DONE && out_size < size ? out_size : 0;
+}
+
+}  // namespace
+
+// 内容指纹 -> 已写入条目的索引
+struct ZipWriter::DedupIndex
+{
+  std::unordered_map<ContentKey, mz_uint, ContentKeyHash> entries;
+
+  // 原样复制来的条目只知道大小与 CRC-32(hash 为 0). 新内容的大小与 CRC-32 都相同时才读回条目计算完整指纹
+  // 并移入 entries, 未变化的文件不必为去重而读取
+  std::unordered_multimap<ContentKey, mz_uint, ContentKeyHash> copied;
+};
+
+ZipWriter::ZipWriter(const std::string &zip_path, WriteMode mode, const IoOptions &io)
+    : zip_{},
+      finished_(false),
+      level_(MZ_DEFAULT_LEVEL),
+      deduplicated_(0),
+      io_(io),
+      reproducible_(false),
+      fixed_time_(0)
 {
-  if (mz_zip_writer_init_file(&zip_, zip_path.c_str(), 0) == 0) throw std::runtime_error("Failed to create ZIP file");
+  cpu_dispatch();
+  zip_.m_io_buf_size = io_.buffer_size;  // 必须在 init 之前设置, 打开文件时据此设置 stdio 缓冲
+  if (mode == WriteMode::append && fs::exists(zip_path))
+  {
+    // 写入模式下不会再用到排序索引, 打开时跳过排序
+    if (mz_zip_reader_init_file(&zip_, zip_path.c_str(), MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY) == 0)
+      throw std::runtime_error("Failed to open ZIP file for append: " + zip_path);
+    try
+    {
+      archive_dictionary_ = read_preset_dictionary(&zip_);
+    }
+    catch (...)
+    {
+      mz_zip_end(&zip_);
+      throw;
+    }
+
+    // 转为写入模式, 新条目从旧中央目录的位置开始写
+    if (mz_zip_writer_init_from_reader(&zip_, zip_path.c_str()) == 0)
+    {
+      mz_zip_end(&zip_);
+      throw std::runtime_error("Failed to open ZIP file for append: " + zip_path);
+    }
+    return;
+  }
+
+  // 以可读写方式打开, 去重时需要读回已写入条目的压缩数据
+  if (mz_zip_writer_init_file_v2(&zip_, zip_path.c_str(), 0, MZ_ZIP_FLAG_WRITE_ALLOW_READING) == 0)
+    throw std::runtime_error("Failed to create ZIP file");
 }
 
 ZipWriter::~ZipWriter()
@@ -50,11 +364,65 @@ void ZipWriter::add_file(const std::string &file_path_str, const std::string &ba
   else
     rel_path = file_path.lexically_relative(base_path_str);
 
-  if (mz_zip_writer_add_file(&zip_, rel_path.string().c_str(), file_path_str.c_str(), nullptr, 0, MZ_DEFAULT_LEVEL) ==
-      0)
+  add_file_entry(file_path_str, rel_path.string(), level_);
+}
+
+void ZipWriter::add_file_entry(const std::string &file_path_str, const std::string &name, int level)
+{
+  ContentKey key = ContentKey();
+  bool dedup = false;
+  if (dedup_)
+  {
+    // 复用的条目记录本文件的修改时间, 与直接添加时一致
+    struct stat file_st;
+    if (stat(file_path_str.c_str(), &file_st) != 0) throw std::runtime_error("Failed to read file: " + file_path_str);
+    MZ_TIME_T mtime = reproducible_ ? fixed_time_ : file_st.st_mtime;
+    if (static_cast<uint64_t>(file_st.st_size) <= kDedupReadOnceLimit)
+    {
+      std::vector<uint8_t> content;
+      if (!read_file(file_path_str, io_, content)) throw std::runtime_error("Failed to read file: " + file_path_str);
+      add_data_entry(name, content.data(), content.size(), &mtime, level);
+      return;
+    }
+    dedup = hash_file(file_path_str, io_, key) && key.size > 0;
+    if (dedup && reuse_entry(key, name, &mtime)) return;
+  }
+
+  mz_uint dict_flags = 0;
+  if (!dictionary_.empty())
+  {
+    std::error_code ec;
+    const auto size = fs::file_size(file_path_str, ec);
+    if (!ec) dict_flags = dictionary_flags(level, size);
+  }
+  const mz_uint flags = dict_flags != 0 ? dict_flags : static_cast<mz_uint>(level);
+
+  if (level == kArchiveLevel && dict_flags == 0)
+  {
+    std::vector<uint8_t> content;
+    struct stat file_st;
+    if (!read_file(file_path_str, io_, content) || stat(file_path_str.c_str(), &file_st) != 0)
+      throw std::runtime_error("Failed to read file: " + file_path_str);
+    MZ_TIME_T mtime = reproducible_ ? fixed_time_ : file_st.st_mtime;
+    add_archive_entry(name, content.data(), content.size(), &mtime);
+  }
+  else if (reproducible_)
+  {
+    // mz_zip_writer_add_file 总是记录磁盘上的修改时间, 这里自行打开文件并指定固定时间
+    std::error_code ec;
+    const auto size = fs::file_size(file_path_str, ec);
+    FILE *fp = ec ? nullptr : open_source(file_path_str, io_);
+    if (fp == nullptr) throw std::runtime_error("Failed to read file: " + file_path_str);
+    const mz_bool ok =
+        mz_zip_writer_add_cfile(&zip_, name.c_str(), fp, size, &fixed_time_, nullptr, 0, flags, nullptr, 0, nullptr, 0);
+    std::fclose(fp);
+    if (!ok) throw std::runtime_error("Failed to add file to ZIP: " + file_path_str);
+  }
+  else if (mz_zip_writer_add_file(&zip_, name.c_str(), file_path_str.c_str(), nullptr, 0, flags) == 0)
   {
     throw std::runtime_error("Failed to add file to ZIP: " + file_path_str);
   }
+  if (dedup) dedup_->entries.emplace(key, zip_.m_total_files - 1);
 }
 
 void ZipWriter::add_data(const std::string &filename_in_zip, const void *data, size_t size)
@@ -63,25 +431,498 @@ void ZipWriter::add_data(const std::string &filename_in_zip, const void *data, s
   {
     throw std::invalid_argument("add_data: data is null");
   }
+  add_data_entry(filename_in_zip, data, size, entry_time(), level_);
+}
 
-  if (mz_zip_writer_add_mem(&zip_, filename_in_zip.c_str(), data, size, MZ_DEFAULT_LEVEL) == 0)
+void ZipWriter::add_data_entry(const std::string &filename_in_zip, const void *data, size_t size,
+                               MZ_TIME_T *last_modified, int level)
+{
+  ContentKey key = ContentKey();
+  const bool dedup = dedup_ && size > 0;
+  if (dedup)
+  {
+    key = ContentHasher::of(data, size);
+    if (reuse_entry(key, filename_in_zip, last_modified)) return;
+  }
+
+  const mz_uint dict_flags = dictionary_flags(level, size);
+  if (level == kArchiveLevel && dict_flags == 0)
+  {
+    add_archive_entry(filename_in_zip, data, size, last_modified);
+  }
+  else if (mz_zip_writer_add_mem_ex_v2(&zip_, filename_in_zip.c_str(), data, size, nullptr, 0,
+                                       dict_flags != 0 ? dict_flags : static_cast<mz_uint>(level), 0, 0,
+                                       last_modified, nullptr, 0, nullptr, 0) == 0)
   {
     throw std::runtime_error("Failed to add data to ZIP: " + filename_in_zip);
   }
+  if (dedup) dedup_->entries.emplace(key, zip_.m_total_files - 1);
 }
 
-void ZipWriter::add_folder(const std::string &folder_path_str)
+void ZipWriter::add_data_batch(const DataEntry *entries, size_t count, size_t threads)
+{
+  uint64_t name_bytes = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (entries[i].name == nullptr || entries[i].data == nullptr)
+    {
+      throw std::invalid_argument("add_data_batch: name or data is null at record " + std::to_string(i));
+    }
+    name_bytes += std::strlen(entries[i].name);
+  }
+  if (count == 0) return;
+
+  // 中央目录按整批一次预留, 之后逐条追加不再扩容
+  if (mz_zip_writer_reserve_entries(&zip_, static_cast<mz_uint>(std::min<size_t>(count, MZ_UINT32_MAX)), name_bytes) == 0)
+  {
+    throw std::runtime_error("Failed to reserve ZIP central directory");
+  }
+
+  struct Slot
+  {
+    size_t offset;     // 压缩输出在 arena 中的偏移
+    size_t comp_size;  // 为 0 表示存储
+    mz_uint32 crc32;
+    bool primed;  // 以预设字典压缩
+    bool reuse;   // 与已写入的条目或本批之前的记录内容相同, 不压缩, 写入时复制
+    ContentKey key;
+  };
+
+  const int level = level_;
+  const bool dedup = dedup_ != nullptr;
+  MZ_TIME_T batch_time = reproducible_ ? fixed_time_ : std::time(nullptr);  // 整批共用一个修改时间
+  if (threads == 0) threads = DirScanner::default_threads();
+
+  std::vector<std::unique_ptr<tdefl_compressor, void (*)(tdefl_compressor *)>> compressors;
+  std::vector<Slot> slots;
+  std::unordered_set<ContentKey, ContentKeyHash> seen;
+  std::vector<uint8_t> arena;
+  CoalescingWriter writer(&zip_, std::max(io_.buffer_size, kBatchWriteSize));
+
+  for (size_t begin = 0; begin < count;)
+  {
+    // 超过一批大小的条目单独流式压缩, 不占用整块内存
+    if (entries[begin].size > kBatchBytes)
+    {
+      add_data(entries[begin].name, entries[begin].data, entries[begin].size);
+      ++begin;
+      continue;
+    }
+
+    // 压缩输出不会超过原大小, 按原大小的前缀和给每条记录划出输出区
+    size_t end = begin;
+    size_t bytes = 0;
+    slots.clear();
+    while (end < count && entries[end].size <= kBatchBytes - bytes)
+    {
+      slots.push_back(Slot{bytes, 0, 0, dictionary_flags(level, entries[end].size) != 0, false, ContentKey()});
+      bytes += entries[end++].size;
+    }
+    arena.resize(bytes);
+    const size_t n = end - begin;
+
+    const size_t workers = std::min(threads, n);
+    const bool deflate = level != MZ_NO_COMPRESSION && (level != kArchiveLevel || !dictionary_.empty());
+    while (deflate && compressors.size() < workers)
+    {
+      compressors.emplace_back(tdefl_compressor_alloc(), &tdefl_compressor_free);
+      if (!compressors.back()) throw std::bad_alloc();
+    }
+
+    // 在 workers 个线程上对本批每条记录调用 fn(序号, 压缩器), 全部结束后重新抛出第一个异常
+    auto for_each_slot = [&](const std::function<void(size_t, tdefl_compressor *)> &fn) {
+      std::atomic<size_t> next(0);
+      std::atomic<bool> failed(false);
+      std::mutex error_mutex;
+      std::exception_ptr error;
+      auto work = [&](tdefl_compressor *comp) {
+        try
+        {
+          for (size_t k = next++; k < n && !failed; k = next++) fn(k, comp);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) error = std::current_exception();
+          failed = true;
+        }
+      };
+
+      std::vector<std::thread> pool;
+      for (size_t t = 1; t < workers; ++t) pool.emplace_back(work, deflate ? compressors[t].get() : nullptr);
+      work(deflate ? compressors[0].get() : nullptr);
+      for (auto &worker : pool) worker.join();
+      if (error) std::rethrow_exception(error);
+    };
+
+    if (dedup)
+    {
+      // 先并行计算指纹, 再按输入顺序判断重复: 与已写入的条目或本批之前的记录相同的只在写入时复制, 不压缩
+      for_each_slot([&](size_t k, tdefl_compressor *) {
+        const DataEntry &e = entries[begin + k];
+        if (e.size > 0) slots[k].key = ContentHasher::of(e.data, e.size);
+      });
+      seen.clear();
+      for (size_t k = 0; k < n; ++k)
+      {
+        mz_uint file_index;
+        Slot &slot = slots[k];
+        slot.reuse = entries[begin + k].size > 0 && (find_entry(slot.key, file_index) || !seen.insert(slot.key).second);
+      }
+    }
+
+    for_each_slot([&](size_t k, tdefl_compressor *comp) {
+      const DataEntry &e = entries[begin + k];
+      const uint8_t *data = static_cast<const uint8_t *>(e.data);
+      Slot &slot = slots[k];
+      if (slot.reuse) return;
+      slot.comp_size =
+          compress_to(comp, level, data, e.size, arena.data() + slot.offset, slot.primed ? &dictionary_ : nullptr);
+      if (slot.comp_size == 0) return;
+      slot.crc32 = dedup ? slot.key.crc32 : static_cast<mz_uint32>(mz_crc32(MZ_CRC32_INIT, data, e.size));
+    });
+
+    // 按输入顺序写入, 重复的记录此时其内容的第一份已经写入
+    for (size_t k = 0; k < n; ++k)
+    {
+      const DataEntry &e = entries[begin + k];
+      const Slot &slot = slots[k];
+      if (slot.reuse)
+      {
+        if (!reuse_entry(slot.key, e.name, &batch_time))
+          throw std::runtime_error(std::string("Failed to copy duplicate entry: ") + e.name);
+        continue;
+      }
+
+      mz_bool ok;
+      if (slot.comp_size == 0)
+      {
+        ok = mz_zip_writer_add_mem_ex_v2(&zip_, e.name, e.data, e.size, nullptr, 0, MZ_NO_COMPRESSION, 0, 0,
+                                         &batch_time, nullptr, 0, nullptr, 0);
+      }
+      else
+      {
+        const mz_uint flags = MZ_ZIP_FLAG_COMPRESSED_DATA | (slot.primed ? MZ_ZIP_FLAG_PRESET_DICT : 0);
+        ok = mz_zip_writer_add_mem_ex_v2(&zip_, e.name, arena.data() + slot.offset, slot.comp_size, nullptr, 0, flags,
+                                         e.size, slot.crc32, &batch_time, nullptr, 0, nullptr, 0);
+      }
+      if (!ok) throw std::runtime_error(std::string("Failed to add data to ZIP: ") + e.name);
+      if (dedup && e.size > 0) dedup_->entries.emplace(slot.key, zip_.m_total_files - 1);
+    }
+    begin = end;
+  }
+
+  if (!writer.flush()) throw std::runtime_error("Failed to write ZIP data");
+}
+
+void ZipWriter::add_precompressed(const std::string &filename_in_zip, const void *deflate_data, size_t deflate_size,
+                                  uint64_t uncomp_size, uint32_t crc32)
+{
+  if (deflate_data == nullptr || deflate_size == 0)
+  {
+    throw std::invalid_argument("add_precompressed: deflate data is empty");
+  }
+
+  const mz_bool ok = mz_zip_writer_add_mem_ex_v2(&zip_, filename_in_zip.c_str(), deflate_data, deflate_size, nullptr, 0,
+                                                 MZ_ZIP_FLAG_COMPRESSED_DATA, uncomp_size, crc32, entry_time(), nullptr,
+                                                 0, nullptr, 0);
+  if (!ok) throw std::runtime_error("Failed to add precompressed data to ZIP: " + filename_in_zip);
+}
+
+void ZipWriter::add_folder(const std::string &folder_path_str, const EntryRules &rules)
+{
+  scan_folder(folder_path_str, rules,
+              [this](const ScannedFile &f, int level) { add_file_entry(f.path, f.name, level); });
+}
+
+void ZipWriter::scan_folder(const std::string &folder_path_str, const EntryRules &rules,
+                            const std::function<void(const ScannedFile &, int)> &visit)
 {
   fs::path folder_path(folder_path_str);
   if (!fs::exists(folder_path)) throw std::runtime_error("Folder not exist: " + folder_path_str);
 
-  for (const auto &entry : fs::recursive_directory_iterator(folder_path))
+  // 包含/排除规则在扫描线程中生效, 被排除的目录整棵子树都不会读取
+  ScanFilter filter;
+  if (!rules.empty())
+  {
+    filter = [&rules](const std::string &name, bool is_directory) {
+      return is_directory ? rules.accepts_directory(name) : rules.accepts_file(name);
+    };
+  }
+
+  // 级别规则未命中时使用 set_level 的级别; 只有检查到大小规则时才取文件大小
+  auto add = [this, &rules, &visit](const ScannedFile &f) {
+    const int level = rules.level_for(f.name, [&f]() {
+      std::error_code ec;
+      const auto size = fs::file_size(f.path, ec);
+      return ec ? uint64_t(0) : static_cast<uint64_t>(size);
+    });
+    visit(f, level < 0 ? level_ : level);
+  };
+
+  // 扫描线程并行遍历目录, 当前线程边接收边压缩, 不必等待整个遍历结束
+  const size_t threads = io_.scan_threads != 0 ? io_.scan_threads : DirScanner::default_threads();
+  DirScanner scanner(folder_path_str, threads, filter);
+  ScannedFile file;
+  if (!reproducible_)
+  {
+    while (scanner.next(file)) add(file);
+    return;
+  }
+
+  // 可复现模式需要与线程调度无关的顺序, 先收集完整的遍历结果再按条目名排序
+  std::vector<ScannedFile> files;
+  while (scanner.next(file)) files.push_back(file);
+  std::sort(files.begin(), files.end(), [](const ScannedFile &a, const ScannedFile &b) { return a.name < b.name; });
+  for (const auto &f : files) add(f);
+}
+
+RebuildManifest ZipWriter::add_folder_incremental(const std::string &folder_path_str, ZipReader &previous,
+                                                  const EntryRules &rules)
+{
+  mz_zip_archive *previous_zip = previous.archive();
+
+  // 旧 ZIP 中的文件条目: 名称 -> 索引
+  std::unordered_map<std::string, mz_uint> old_entries;
+  mz_uint num_files = mz_zip_reader_get_num_files(previous_zip);
+  char name_buf[MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE];
+  for (mz_uint i = 0; i < num_files; ++i)
   {
-    if (fs::is_regular_file(entry))
+    if (mz_zip_reader_is_file_a_directory(previous_zip, i)) continue;
+    mz_uint len = mz_zip_reader_get_filename(previous_zip, i, name_buf, sizeof(name_buf));
+    if (len == 0) throw std::runtime_error("Failed to get file info at index: " + std::to_string(i));
+    if (std::strcmp(name_buf, MZ_ZIP_PRESET_DICT_NAME) == 0) continue;  // 旧字典不复制, 条目按本 ZIP 的设置重新压缩
+    old_entries.emplace(std::string(name_buf, len - 1), i);
+  }
+
+  // 与 add_folder 相同的遍历与规则; 被排除的文件不会写入, 在清单中记为已删除
+  RebuildManifest manifest;
+  scan_folder(folder_path_str, rules, [&](const ScannedFile &f, int level) {
+    auto it = old_entries.find(f.name);
+    if (it != old_entries.end())
     {
-      add_file(entry.path().string(), folder_path_str);
+      const mz_uint old_index = it->second;
+      old_entries.erase(it);
+      if (same_as_entry(previous_zip, old_index, f.path, io_))
+      {
+        if (mz_zip_writer_add_from_zip_reader_v2(&zip_, previous_zip, old_index, nullptr) == 0)
+        {
+          throw std::runtime_error("Failed to copy entry to ZIP: " + f.name);
+        }
+        remember_copied_entry();
+        ++manifest.unchanged;
+        return;
+      }
     }
+
+    add_file_entry(f.path, f.name, level);
+    manifest.changed.push_back(f.name);
+  });
+
+  for (const auto &kv : old_entries) manifest.removed.push_back(kv.first);
+  std::sort(manifest.removed.begin(), manifest.removed.end());
+  return manifest;
+}
+
+void ZipWriter::add_from_reader(ZipReader &reader, const std::string &name_in_zip, const std::string &new_name)
+{
+  mz_zip_archive *source = reader.archive();
+  int file_index = mz_zip_reader_locate_file(source, name_in_zip.c_str(), nullptr, 0);
+  if (file_index < 0)
+  {
+    throw std::runtime_error("File not found in ZIP: " + name_in_zip);
   }
+
+  // 只有依赖字典的条目需要来源的字典
+  mz_zip_archive_file_stat st;
+  const bool primed = mz_zip_reader_file_stat(source, static_cast<mz_uint>(file_index), &st) &&
+                      st.m_method == MZ_DEFLATED_PRESET_DICT;
+  copy_entry(source, static_cast<mz_uint>(file_index), new_name.empty() ? name_in_zip : new_name,
+             primed ? read_preset_dictionary(source) : std::vector<uint8_t>());
+}
+
+void ZipWriter::merge(ZipReader &reader, const EntryFilter &filter)
+{
+  mz_zip_archive *source = reader.archive();
+  const std::vector<uint8_t> source_dict = read_preset_dictionary(source);
+  mz_uint num_files = mz_zip_reader_get_num_files(source);
+  char name_buf[MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE];
+  for (mz_uint i = 0; i < num_files; ++i)
+  {
+    mz_uint len = mz_zip_reader_get_filename(source, i, name_buf, sizeof(name_buf));
+    if (len == 0) throw std::runtime_error("Failed to get file info at index: " + std::to_string(i));
+
+    const std::string src_name(name_buf, len - 1);
+    std::string dst_name = src_name;
+    if (filter && !filter(dst_name)) continue;
+    if (dst_name.empty()) throw std::invalid_argument("merge: empty entry name for " + src_name);
+    copy_entry(source, i, dst_name, source_dict);
+  }
+}
+
+std::vector<uint8_t> ZipWriter::train_dictionary(const std::vector<std::string> &samples, size_t dict_size)
+{
+  if (dict_size == 0 || dict_size > MZ_ZIP_PRESET_DICT_MAX_SIZE)
+  {
+    throw std::invalid_argument("train_dictionary: dict_size must be in [1, " +
+                                std::to_string(MZ_ZIP_PRESET_DICT_MAX_SIZE) + "]");
+  }
+  return zip_compress::train_dictionary(samples, dict_size);
+}
+
+void ZipWriter::set_dictionary(const void *dict, size_t size)
+{
+  if (dict == nullptr || size == 0 || size > MZ_ZIP_PRESET_DICT_MAX_SIZE)
+  {
+    throw std::invalid_argument("set_dictionary: size must be in [1, " + std::to_string(MZ_ZIP_PRESET_DICT_MAX_SIZE) +
+                                "]");
+  }
+  if (!archive_dictionary_.empty()) throw std::runtime_error("set_dictionary: ZIP already has a preset dictionary");
+
+  if (mz_zip_writer_add_preset_dict(&zip_, dict, size, entry_time()) == 0)
+  {
+    throw std::runtime_error("Failed to add preset dictionary to ZIP");
+  }
+  const uint8_t *bytes = static_cast<const uint8_t *>(dict);
+  dictionary_.assign(bytes, bytes + size);
+  archive_dictionary_ = dictionary_;
+}
+
+void ZipWriter::set_level(int level)
+{
+  if (level < MZ_NO_COMPRESSION || level > kArchiveLevel)
+    throw std::invalid_argument("set_level: level must be in [0, " + std::to_string(kArchiveLevel) + "]");
+  level_ = level;
+}
+
+void ZipWriter::set_reproducible(bool enable)
+{
+  if (enable) fixed_time_ = reproducible_time();
+  reproducible_ = enable;
+}
+
+void ZipWriter::set_deduplicate(bool enable)
+{
+  if (!enable)
+    dedup_.reset();
+  else if (!dedup_)
+    dedup_.reset(new DedupIndex());
+}
+
+bool ZipWriter::find_entry(const ContentKey &key, mz_uint &file_index)
+{
+  auto it = dedup_->entries.find(key);
+  if (it == dedup_->entries.end() && !dedup_->copied.empty())
+  {
+    ContentKey partial = key;
+    partial.hash = 0;
+    auto range = dedup_->copied.equal_range(partial);
+    std::vector<mz_uint> candidates;
+    for (auto c = range.first; c != range.second; ++c) candidates.push_back(c->second);
+    dedup_->copied.erase(range.first, range.second);
+    for (const mz_uint index : candidates)
+    {
+      ContentHasher hasher;
+      if (mz_zip_reader_extract_to_callback(&zip_, index, hash_output, &hasher, 0) != 0)
+        dedup_->entries.emplace(hasher.digest(), index);
+    }
+    it = dedup_->entries.find(key);
+  }
+  if (it == dedup_->entries.end()) return false;
+  file_index = it->second;
+  return true;
+}
+
+bool ZipWriter::reuse_entry(const ContentKey &key, const std::string &filename_in_zip, const MZ_TIME_T *last_modified)
+{
+  mz_uint file_index;
+  if (!find_entry(key, file_index)) return false;
+
+  // ZIP 格式下多个条目共享同一份本地数据会被很多解压工具视为重叠条目, 因此复制而不是引用.
+  // 副本记录自己的修改时间, 属性与新添加的条目一样为 0, 而不是沿用被复用条目的
+  if (mz_zip_writer_add_from_zip_reader_v3(&zip_, &zip_, file_index, filename_in_zip.c_str(), last_modified, 0) == 0)
+  {
+    throw std::runtime_error("Failed to copy duplicate entry: " + filename_in_zip);
+  }
+  ++deduplicated_;
+  return true;
+}
+
+void ZipWriter::remember_copied_entry()
+{
+  if (!dedup_) return;
+  mz_zip_archive_file_stat st;
+  if (!mz_zip_reader_file_stat(&zip_, zip_.m_total_files - 1, &st) || st.m_is_directory || st.m_uncomp_size == 0)
+    return;
+  dedup_->copied.emplace(ContentKey{st.m_uncomp_size, st.m_crc32, 0}, zip_.m_total_files - 1);
+}
+
+void ZipWriter::add_archive_entry(const std::string &filename_in_zip, const void *data, size_t size,
+                                  MZ_TIME_T *last_modified)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  std::vector<uint8_t> deflated = archive_deflate(bytes, size);
+
+  mz_bool ok;
+  if (deflated.size() >= size)
+  {
+    // 压缩没有收益时直接存储
+    ok = mz_zip_writer_add_mem_ex_v2(&zip_, filename_in_zip.c_str(), data, size, nullptr, 0, MZ_NO_COMPRESSION, 0, 0,
+                                     last_modified, nullptr, 0, nullptr, 0);
+  }
+  else
+  {
+    const mz_uint32 crc32 = static_cast<mz_uint32>(mz_crc32(MZ_CRC32_INIT, bytes, size));
+    ok = mz_zip_writer_add_mem_ex_v2(&zip_, filename_in_zip.c_str(), deflated.data(), deflated.size(), nullptr, 0,
+                                     MZ_ZIP_FLAG_COMPRESSED_DATA, size, crc32, last_modified, nullptr, 0, nullptr, 0);
+  }
+  if (!ok) throw std::runtime_error("Failed to add data to ZIP: " + filename_in_zip);
+}
+
+mz_uint ZipWriter::dictionary_flags(int level, uint64_t size) const
+{
+  if (dictionary_.empty() || level == MZ_NO_COMPRESSION || size > kDictionaryEntryLimit) return 0;
+  return static_cast<mz_uint>(std::min<int>(level, MZ_UBER_COMPRESSION)) | MZ_ZIP_FLAG_PRESET_DICT;
+}
+
+void ZipWriter::copy_entry(mz_zip_archive *source, mz_uint file_index, const std::string &dst_name,
+                           const std::vector<uint8_t> &source_dict)
+{
+  mz_zip_archive_file_stat st;
+  if (!mz_zip_reader_file_stat(source, file_index, &st))
+    throw std::runtime_error("Failed to get file info at index: " + std::to_string(file_index));
+  const char *new_name = dst_name == st.m_filename ? nullptr : dst_name.c_str();
+
+  std::vector<uint8_t> copied_dict;
+  if (dst_name == MZ_ZIP_PRESET_DICT_NAME)
+  {
+    if (!extract_entry(source, file_index, copied_dict))
+      throw std::runtime_error("Failed to read preset dictionary: " + std::string(st.m_filename));
+    if (!archive_dictionary_.empty())
+    {
+      if (copied_dict == archive_dictionary_) return;  // 同一份字典, 已经在本 ZIP 中
+      throw std::runtime_error("ZIP already has a different preset dictionary, cannot copy another one");
+    }
+  }
+  else if (st.m_method == MZ_DEFLATED_PRESET_DICT && (source_dict.empty() || source_dict != archive_dictionary_))
+  {
+    // 压缩数据只能配合来源的字典解压, 解压后按本 ZIP 的设置重新压缩, 与原样复制一样保留修改时间
+    std::vector<uint8_t> content;
+    if (!extract_entry(source, file_index, content))
+      throw std::runtime_error("Failed to extract entry for recompression: " + std::string(st.m_filename));
+    MZ_TIME_T mtime = st.m_time;
+    add_data_entry(dst_name, content.data(), content.size(), &mtime, level_);
+    return;
+  }
+
+  if (mz_zip_writer_add_from_zip_reader_v2(&zip_, source, file_index, new_name) == 0)
+  {
+    throw std::runtime_error("Failed to copy entry to ZIP: " + std::string(st.m_filename));
+  }
+  if (!copied_dict.empty())
+    archive_dictionary_.swap(copied_dict);
+  else
+    remember_copied_entry();
 }
 
 void ZipWriter::finish()